@@ -0,0 +1,300 @@
+// Benchmark de E/S UDP do laço do servidor: um recvfrom/sendto por datagrama
+// (o laço antigo) vs. epoll + recvmmsg +
+// sendmmsg em lote (o watchServerSocket) vs. io_uring (recepção multishot e
+// ACKs numa submissão só; só com make IO_URING=1).
+// Clientes em loopback mantêm REQUESTS_IN_FLIGHT pedidos pendentes cada e o
+// "servidor" responde cada um com um ACK. Mede vazão, syscalls do servidor por
+// requisição e a latência (ida e volta) p50/p99 vista pelos clientes.
+// Uso: ./io_bench.exe [SEGUNDOS] [CLIENTES] [LOTE ...]   (LOTE 0 = laço clássico)
+
+#include "server/batch_io.h"
+#include "server/uring_io.h"
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+#define REQUESTS_IN_FLIGHT 32
+#define SOCKET_BUFFER (4 * 1024 * 1024)
+// Instantes de envio guardados por cliente (indexados pelo seqn)
+#define SEND_TIMES 4096
+#define POLL_TIMEOUT_MS 20
+
+enum BenchLoop { LOOP_CLASSIC, LOOP_BATCHED, LOOP_URING };
+
+static const char* loopName(BenchLoop loop) {
+    switch (loop) {
+        case LOOP_CLASSIC: return "recvfrom";
+        case LOOP_BATCHED: return "recvmmsg";
+        default: return "io_uring";
+    }
+}
+
+static int openSocket(struct sockaddr_in& addr) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    int buffer_size = SOCKET_BUFFER;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+    // Sem bloquear para sempre: as threads olham a flag de parada
+    struct timeval tv = {0, 20000};
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sockfd, (struct sockaddr*)&addr, sizeof(addr));
+
+    socklen_t len = sizeof(addr);
+    getsockname(sockfd, (struct sockaddr*)&addr, &len);
+    return sockfd;
+}
+
+static void fillAck(const Packet& request, Packet& ack) {
+    memset(&ack, 0, sizeof(Packet));
+    ack.type = PKT_REQUEST_ACK;
+    ack.seqn = request.seqn;
+    ack.ack.value = request.req.value;
+}
+
+static void decodeRequest(const uint8_t* data, size_t len, Packet& request) {
+    decodePacket(WireView(data, len), request);
+}
+
+// O laço de antes: um recvfrom, um sendto
+static void classicLoop(int sockfd, atomic<bool>& running, atomic<uint64_t>& received, uint64_t& syscalls) {
+    WireDatagram buffer;
+    struct sockaddr_in client_addr;
+    Packet request, ack;
+
+    while (running) {
+        socklen_t clilen = sizeof(client_addr);
+        ssize_t n = recvfrom(sockfd, buffer.bytes, sizeof(buffer.bytes), 0, (struct sockaddr*)&client_addr, &clilen);
+        syscalls++;
+        if (n < 0) continue;
+
+        received++;
+        decodeRequest(buffer.bytes, (size_t)n, request);
+        fillAck(request, ack);
+        sendPacket(sockfd, ack, (struct sockaddr*)&client_addr, clilen);
+        syscalls++;
+    }
+}
+
+// Como o watchServerSocket: epoll_wait, um recvmmsg sem bloquear e os ACKs do
+// lote num sendmmsg (contado como um: o socket é um só e cabe no lote)
+static void batchedLoop(int sockfd, size_t batch, atomic<bool>& running, atomic<uint64_t>& received,
+                        uint64_t& syscalls) {
+    DatagramReceiver receiver(batch);
+    Packet request, ack;
+
+    int epfd = epoll_create1(0);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &ev);
+
+    while (running) {
+        syscalls++;
+        if (epoll_wait(epfd, &ev, 1, POLL_TIMEOUT_MS) <= 0) continue;
+
+        int n = receiver.receive(sockfd, MSG_DONTWAIT);
+        syscalls++;
+        if (n <= 0) continue;
+
+        received += n;
+        OutboxScope outbox;
+        for (int i = 0; i < n; ++i) {
+            decodeRequest(receiver.data(i), receiver.length(i), request);
+            fillAck(request, ack);
+            sendDatagram(sockfd, ack, receiver.sender(i), receiver.senderLen(i));
+        }
+        syscalls++;
+    }
+    close(epfd);
+}
+
+// epoll_wait no fd do anel e drain; os io_uring_enter vêm do contador do backend
+static void uringLoop(int sockfd, atomic<bool>& running, atomic<uint64_t>& received, uint64_t& syscalls) {
+    UringReceiver ring;
+    if (!ring.open(sockfd)) {
+        fprintf(stderr, "io_uring receive unavailable\n");
+        return;
+    }
+
+    int epfd = epoll_create1(0);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, ring.ringFd(), &ev);
+
+    uint64_t enter_before = uringEnterCalls();
+    Packet request, ack;
+    while (running) {
+        syscalls++;
+        if (epoll_wait(epfd, &ev, 1, POLL_TIMEOUT_MS) <= 0) continue;
+
+        OutboxScope outbox;
+        received += ring.drain([&](const uint8_t* data, size_t len, const struct sockaddr_in& sender,
+                                   socklen_t senderlen) {
+            decodeRequest(data, len, request);
+            fillAck(request, ack);
+            sendDatagram(sockfd, ack, sender, senderlen);
+        });
+    }
+    syscalls += uringEnterCalls() - enter_before;
+    close(epfd);
+}
+
+// Os clientes usam sempre recvmmsg/sendmmsg direto, igual em todos os modos,
+// para gastar pouca CPU (a máquina pode ter um núcleo só) e medir o servidor
+static void clientLoop(const struct sockaddr_in& server, atomic<bool>& running, atomic<uint64_t>& acked,
+                       mutex& samples_mutex, vector<uint32_t>& samples) {
+    struct sockaddr_in my_addr;
+    int sockfd = openSocket(my_addr);
+    DatagramReceiver receiver(REQUESTS_IN_FLIGHT);
+
+    Packet request;
+    memset(&request, 0, sizeof(Packet));
+    request.type = PKT_REQUEST;
+    request.req.value = 1;
+
+    uint8_t requests[REQUESTS_IN_FLIGHT][WIRE_MAX_PACKET];
+    struct iovec iovecs[REQUESTS_IN_FLIGHT];
+    struct mmsghdr msgs[REQUESTS_IN_FLIGHT];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < REQUESTS_IN_FLIGHT; ++i) {
+        iovecs[i].iov_base = requests[i];
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = (void*)&server;
+        msgs[i].msg_hdr.msg_namelen = sizeof(server);
+    }
+
+    vector<chrono::steady_clock::time_point> sent_at(SEND_TIMES);
+    vector<uint32_t> local_samples;
+    uint32_t seqn = 0;
+    uint64_t local_acked = 0;
+    int to_send = REQUESTS_IN_FLIGHT;
+
+    while (running) {
+        auto now = chrono::steady_clock::now();
+        for (int i = 0; i < to_send; ++i) {
+            request.seqn = ++seqn;
+            iovecs[i].iov_len = encodePacket(request, requests[i], WIRE_MAX_PACKET);
+            sent_at[seqn % SEND_TIMES] = now;
+        }
+        sendmmsg(sockfd, msgs, to_send, 0);
+
+        // Um ACK libera um pedido novo; timeout = algo se perdeu, a janela recomeça
+        int n = receiver.receive(sockfd);
+        if (n <= 0) {
+            to_send = REQUESTS_IN_FLIGHT;
+            continue;
+        }
+
+        now = chrono::steady_clock::now();
+        Packet ack;
+        for (int i = 0; i < n; ++i) {
+            if (!decodePacket(WireView(receiver.data(i), receiver.length(i)), ack)) continue;
+            uint32_t acked_seqn = ack.seqn;
+            if (seqn - acked_seqn >= SEND_TIMES) continue;  // Instante já sobrescrito
+            auto rtt = chrono::duration_cast<chrono::microseconds>(now - sent_at[acked_seqn % SEND_TIMES]);
+            local_samples.push_back((uint32_t)rtt.count());
+        }
+        local_acked += n;
+        to_send = n;
+    }
+
+    acked += local_acked;
+    {
+        lock_guard<mutex> lk(samples_mutex);
+        samples.insert(samples.end(), local_samples.begin(), local_samples.end());
+    }
+    close(sockfd);
+}
+
+static uint32_t percentile(vector<uint32_t>& samples, double p) {
+    if (samples.empty()) return 0;
+    size_t k = (size_t)(p * (samples.size() - 1));
+    nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+static void benchMode(BenchLoop loop, size_t batch, double seconds, int clients) {
+    struct sockaddr_in server_addr;
+    int sockfd = openSocket(server_addr);
+    // A caixa de saída só esvazia no fim de cada lote; no modo recvmmsg ela usa sendmmsg
+    setBatchIo(loop == LOOP_CLASSIC ? BATCH_IO_MAX : batch);
+    setUringIo(loop == LOOP_URING);
+
+    atomic<bool> server_running(true), clients_running(true);
+    atomic<uint64_t> received(0), acked(0);
+    uint64_t syscalls = 0;
+    mutex samples_mutex;
+    vector<uint32_t> samples;
+
+    thread server([&] {
+        if (loop == LOOP_CLASSIC)
+            classicLoop(sockfd, server_running, received, syscalls);
+        else if (loop == LOOP_BATCHED)
+            batchedLoop(sockfd, batch, server_running, received, syscalls);
+        else
+            uringLoop(sockfd, server_running, received, syscalls);
+    });
+
+    vector<thread> client_threads;
+    for (int i = 0; i < clients; ++i) {
+        client_threads.emplace_back(clientLoop, server_addr, ref(clients_running), ref(acked), ref(samples_mutex),
+                                    ref(samples));
+    }
+
+    auto start = chrono::steady_clock::now();
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    clients_running = false;
+    for (auto& t : client_threads) t.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    server_running = false;
+    server.join();
+    close(sockfd);
+
+    double per_request = received > 0 ? (double)syscalls / received : 0.0;
+    printf("%10s %6zu %12.0f %12.0f %12.3f %8u %8u\n", loopName(loop), batch, received / elapsed, acked / elapsed,
+           per_request, percentile(samples, 0.50), percentile(samples, 0.99));
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+    int clients = (argc > 2) ? atoi(argv[2]) : 8;
+
+    vector<size_t> batches;
+    for (int i = 3; i < argc; ++i) batches.push_back(strtoull(argv[i], nullptr, 10));
+    if (batches.empty()) batches = {0, 8, 32, 64};
+
+    // Testado antes de setUringIo: diz se o build e o kernel suportam io_uring
+    bool uring = uringAvailable();
+
+    printf("%d clients, %d requests in flight each, %.1fs per mode%s\n", clients, REQUESTS_IN_FLIGHT, seconds,
+           uring ? "" : " (io_uring: build with IO_URING=1)");
+    printf("%10s %6s %12s %12s %12s %8s %8s\n", "loop", "batch", "requests/s", "acks/s", "syscalls/req", "p50_us",
+           "p99_us");
+    for (size_t batch : batches) {
+        if (batch == 0) {
+            benchMode(LOOP_CLASSIC, 0, seconds, clients);
+            continue;
+        }
+        benchMode(LOOP_BATCHED, batch, seconds, clients);
+        if (uring) benchMode(LOOP_URING, batch, seconds, clients);
+    }
+
+    return 0;
+}
@@ -0,0 +1,622 @@
+// Gerador de carga: N clientes virtuais num processo só, falando o protocolo
+// do servidor direto (sem cliente.exe). Cada cliente tem seu socket preso a um
+// endereço próprio de loopback (127.1.x.y), então o servidor vê N contas.
+//
+// Em laço aberto (--rate=R) as operações chegam num processo de Poisson de
+// taxa R, independentemente das respostas: uma operação que encontra a janela
+// do cliente cheia espera na fila dele, e a latência é medida a partir do
+// instante em que ela deveria ter saído (sem omissão coordenada). Com
+// --rate=0 o laço é fechado: cada cliente mantém a janela sempre cheia.
+//
+// Uso: ./loadgen.exe [--server=IP:PORTA] [--clients=N] [--threads=T]
+//        [--rate=OPS_POR_S] [--duration=S] [--window=W] [--queries=PCT]
+//        [--batches=PCT] [--batch-size=K] [--values=fixed:V|uniform:A-B|exp:MEDIA]
+//        [--zipf=S] [--timeout-ms=MS]
+
+#include "common/protocol.h"
+#include "common/wire.h"
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+#define SOCKET_BUFFER (256 * 1024)
+#define EPOLL_EVENTS 256
+// Intervalo da varredura de retransmissões e do agendamento em laço aberto
+#define TICK_US 1000
+// Depois do prazo, espera as respostas pendentes por no máximo esse tempo
+#define DRAIN_MS 2000
+#define DISCOVERY_TIMEOUT_MS 3000
+
+// Histograma log-linear em microssegundos: 32 faixas por potência de 2
+// (erro relativo < 3%), de 0 a 2^40 us
+#define HIST_SUB_BUCKETS 32
+#define HIST_OCTAVES 36
+#define HIST_BUCKETS (HIST_SUB_BUCKETS + HIST_OCTAVES * HIST_SUB_BUCKETS)
+
+struct Options {
+    string server_ip = "127.0.0.1";
+    int server_port = 4000;
+    int clients = 1000;
+    int threads = 1;
+    double rate = 10000;  // 0 = laço fechado
+    double duration = 10;
+    int window = 1;
+    int query_pct = 10;
+    int batch_pct = 0;
+    int batch_size = 16;
+    char value_dist = 'u';  // f = fixo, u = uniforme, e = exponencial
+    double value_a = 1, value_b = 10;
+    double zipf = 0;  // 0 = destinos uniformes
+    int timeout_ms = 200;
+};
+
+class Histogram {
+private:
+    vector<uint64_t> _counts;
+    uint64_t _total = 0;
+    uint64_t _max = 0;
+
+    static size_t bucketOf(uint64_t v) {
+        if (v < HIST_SUB_BUCKETS) return v;
+        int e = 63 - __builtin_clzll(v);  // e >= 5
+        size_t b = HIST_SUB_BUCKETS + (size_t)(e - 5) * HIST_SUB_BUCKETS + ((v >> (e - 5)) & (HIST_SUB_BUCKETS - 1));
+        return min(b, (size_t)HIST_BUCKETS - 1);
+    }
+
+public:
+    Histogram() : _counts(HIST_BUCKETS, 0) {}
+
+    static uint64_t bucketUpper(size_t b) {
+        if (b < HIST_SUB_BUCKETS) return b;
+        size_t e = (b - HIST_SUB_BUCKETS) / HIST_SUB_BUCKETS + 5;
+        size_t sub = (b - HIST_SUB_BUCKETS) % HIST_SUB_BUCKETS;
+        return ((HIST_SUB_BUCKETS + sub + 1) << (e - 5)) - 1;
+    }
+
+    void record(uint64_t us) {
+        _counts[bucketOf(us)]++;
+        _total++;
+        _max = std::max(_max, us);
+    }
+
+    void merge(const Histogram& other) {
+        for (size_t i = 0; i < HIST_BUCKETS; ++i) _counts[i] += other._counts[i];
+        _total += other._total;
+        _max = std::max(_max, other._max);
+    }
+
+    uint64_t total() const { return _total; }
+    uint64_t max() const { return _max; }
+
+    uint64_t percentile(double p) const {
+        if (_total == 0) return 0;
+        uint64_t rank = (uint64_t)ceil(p * _total);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < HIST_BUCKETS; ++i) {
+            seen += _counts[i];
+            if (seen >= rank) return std::min(bucketUpper(i), _max);
+        }
+        return _max;
+    }
+
+    // Uma linha por potência de 2 com amostras
+    void print() const {
+        uint64_t low = 0;
+        for (size_t octave = 0; octave <= HIST_OCTAVES; ++octave) {
+            size_t first = octave == 0 ? 0 : HIST_SUB_BUCKETS + (octave - 1) * HIST_SUB_BUCKETS;
+            size_t last = first + HIST_SUB_BUCKETS;
+            uint64_t count = 0;
+            for (size_t i = first; i < last; ++i) count += _counts[i];
+            uint64_t high = bucketUpper(last - 1);
+            if (count > 0) {
+                double pct = 100.0 * count / _total;
+                string bar((size_t)(pct / 2), '#');
+                printf("  %10lu - %-10lu us %10lu %6.2f%% %s\n", (unsigned long)low, (unsigned long)high,
+                       (unsigned long)count, pct, bar.c_str());
+            }
+            low = high + 1;
+        }
+    }
+};
+
+enum OpKind : uint8_t { OP_TRANSFER, OP_QUERY, OP_BATCH };
+
+// Operação gerada; o lote é refeito a partir da semente (retransmissão igual)
+struct Op {
+    OpKind kind;
+    uint32_t dest;
+    uint32_t value;
+    uint32_t seed;
+    Clock::time_point intended;
+};
+
+struct Outstanding {
+    Op op;
+    uint32_t first_seqn;
+    uint32_t last_seqn;
+    Clock::time_point sent;
+    int retries;
+};
+
+struct VirtualClient {
+    int sockfd;
+    uint32_t addr;
+    uint32_t next_seqn;
+    bool ready;
+    deque<Op> backlog;          // esperando espaço na janela
+    deque<Outstanding> window;  // em voo, em ordem de seqn
+};
+
+struct ThreadStats {
+    Histogram latency;
+    uint64_t ops_sent = 0;
+    uint64_t ops_done = 0;
+    uint64_t transfers_done = 0;  // itens de lote contam um a um
+    uint64_t queries_done = 0;
+    uint64_t batches_done = 0;
+    uint64_t retransmits = 0;
+    uint64_t unanswered = 0;
+    uint64_t backlog_left = 0;
+};
+
+/* === Configuração compartilhada (só leitura depois do início) === */
+
+static Options options;
+static struct sockaddr_in server_addr;
+static vector<uint32_t> client_addrs;
+static vector<double> zipf_cdf;
+
+static uint32_t clientAddr(int i) {
+    // 127.1.0.1, 127.1.0.2, ... sem .0 e .255 no último octeto
+    uint32_t host = (uint32_t)i / 254;
+    uint32_t last = (uint32_t)i % 254 + 1;
+    uint32_t ip = (127u << 24) | ((1 + host / 256) << 16) | ((host % 256) << 8) | last;
+    return htonl(ip);
+}
+
+static void buildZipf(int n, double s) {
+    zipf_cdf.resize(n);
+    double sum = 0;
+    for (int k = 0; k < n; ++k) {
+        sum += 1.0 / pow(k + 1, s);
+        zipf_cdf[k] = sum;
+    }
+    for (auto& c : zipf_cdf) c /= sum;
+}
+
+class LoadThread {
+private:
+    int _id;
+    vector<VirtualClient> _clients;
+    int _epfd;
+    minstd_rand _rng;
+    ThreadStats _stats;
+
+    static uint32_t pickDest(minstd_rand& rng) {
+        if (options.zipf <= 0) return client_addrs[rng() % client_addrs.size()];
+        double u = uniform_real_distribution<double>(0, 1)(rng);
+        size_t k = lower_bound(zipf_cdf.begin(), zipf_cdf.end(), u) - zipf_cdf.begin();
+        return client_addrs[min(k, client_addrs.size() - 1)];
+    }
+
+    static uint32_t pickValue(minstd_rand& rng) {
+        switch (options.value_dist) {
+            case 'f': return (uint32_t)options.value_a;
+            case 'e': return 1 + (uint32_t)exponential_distribution<double>(1.0 / options.value_a)(rng);
+            default: return (uint32_t)uniform_int_distribution<uint32_t>((uint32_t)options.value_a,
+                                                                         (uint32_t)options.value_b)(rng);
+        }
+    }
+
+    Op newOp(Clock::time_point intended) {
+        Op op;
+        int roll = _rng() % 100;
+        op.kind = roll < options.query_pct ? OP_QUERY : roll < options.query_pct + options.batch_pct ? OP_BATCH
+                                                                                                      : OP_TRANSFER;
+        op.dest = op.kind == OP_QUERY ? 0 : pickDest(_rng);
+        op.value = op.kind == OP_TRANSFER ? pickValue(_rng) : 0;
+        op.seed = (uint32_t)_rng();
+        op.intended = intended;
+        return op;
+    }
+
+    void transmit(VirtualClient& c, const Outstanding& out) {
+        uint8_t buf[WIRE_MAX_DATAGRAM];
+        size_t len;
+        if (out.op.kind == OP_BATCH) {
+            BatchRequest batch;
+            batch.seqn = out.first_seqn;
+            batch.count = (uint16_t)(out.last_seqn - out.first_seqn + 1);
+            batch.flags = 0;
+            minstd_rand rng(out.op.seed);
+            for (size_t i = 0; i < batch.count; ++i) {
+                batch.items[i].dest_addr = pickDest(rng);
+                batch.items[i].value = pickValue(rng);
+            }
+            len = encodeBatchRequest(batch, buf, sizeof(buf));
+        } else {
+            Packet packet;
+            packet.type = PKT_REQUEST;
+            packet.seqn = out.first_seqn;
+            packet.req.dest_addr = out.op.dest;
+            packet.req.value = out.op.value;
+            len = encodePacket(packet, buf, sizeof(buf));
+        }
+        sendto(c.sockfd, buf, len, 0, (const struct sockaddr*)&server_addr, sizeof(server_addr));
+    }
+
+    // Tira da fila o que cabe na janela
+    void pump(VirtualClient& c, Clock::time_point now) {
+        while (!c.backlog.empty() && (int)c.window.size() < options.window) {
+            Outstanding out;
+            out.op = c.backlog.front();
+            c.backlog.pop_front();
+            out.first_seqn = c.next_seqn;
+            out.last_seqn = c.next_seqn + (out.op.kind == OP_BATCH ? options.batch_size - 1 : 0);
+            c.next_seqn = out.last_seqn + 1;
+            out.sent = now;
+            out.retries = 0;
+            transmit(c, out);
+            c.window.push_back(out);
+            _stats.ops_sent++;
+        }
+    }
+
+    // ACK de N (ou do lote que termina em N): o servidor responde em ordem,
+    // então tudo até N está confirmado
+    void retire(VirtualClient& c, uint32_t acked_seqn, Clock::time_point now) {
+        while (!c.window.empty() && c.window.front().last_seqn <= acked_seqn) {
+            const Outstanding& out = c.window.front();
+            _stats.latency.record(chrono::duration_cast<chrono::microseconds>(now - out.op.intended).count());
+            _stats.ops_done++;
+            if (out.op.kind == OP_QUERY) _stats.queries_done++;
+            else if (out.op.kind == OP_BATCH) {
+                _stats.batches_done++;
+                _stats.transfers_done += out.last_seqn - out.first_seqn + 1;
+            } else _stats.transfers_done++;
+            c.window.pop_front();
+        }
+    }
+
+    void receive(VirtualClient& c, Clock::time_point now) {
+        WireDatagram buf;
+        for (;;) {
+            ssize_t n = recv(c.sockfd, buf.bytes, sizeof(buf.bytes), MSG_DONTWAIT);
+            if (n < 0) return;
+
+            WireView view(buf.bytes, (size_t)n);
+            if (!view.valid()) continue;
+
+            if (view.type() == PKT_BATCH_ACK) {
+                BatchAck ack;
+                if (decodeBatchAck(view, ack) && ack.count > 0) retire(c, ack.seqn + ack.count - 1, now);
+                continue;
+            }
+
+            Packet packet;
+            if (!decodePacket(view, packet)) continue;
+            if (packet.type == PKT_REQUEST_ACK) {
+                if (!c.ready) {
+                    // Sincronização: o servidor respondeu com o último ID que conhece
+                    c.next_seqn = packet.seqn + 1;
+                    c.ready = true;
+                } else {
+                    retire(c, packet.seqn, now);
+                }
+            } else if (packet.type == PKT_DISCOVER_ACK && !c.ready && c.next_seqn == 0) {
+                c.next_seqn = 1;
+            }
+        }
+    }
+
+    void retransmit(Clock::time_point now) {
+        auto timeout = chrono::milliseconds(options.timeout_ms);
+        for (auto& c : _clients) {
+            for (auto& out : c.window) {
+                if (now - out.sent < timeout) continue;
+                out.sent = now;
+                out.retries++;
+                _stats.retransmits++;
+                transmit(c, out);
+            }
+        }
+    }
+
+    void poll(int timeout_ms, Clock::time_point now) {
+        struct epoll_event events[EPOLL_EVENTS];
+        int n = epoll_wait(_epfd, events, EPOLL_EVENTS, timeout_ms);
+        if (n > 0) now = Clock::now();
+        for (int i = 0; i < n; ++i) receive(_clients[events[i].data.u32], now);
+    }
+
+public:
+    LoadThread(int id) : _id(id), _epfd(epoll_create1(0)), _rng(1000 + id) {}
+
+    ~LoadThread() {
+        for (auto& c : _clients) close(c.sockfd);
+        close(_epfd);
+    }
+
+    bool addClient(uint32_t addr) {
+        int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sockfd < 0) return false;
+
+        int buffer_size = SOCKET_BUFFER;
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = addr;
+        if (bind(sockfd, (struct sockaddr*)&local, sizeof(local)) < 0) {
+            close(sockfd);
+            return false;
+        }
+
+        VirtualClient c;
+        c.sockfd = sockfd;
+        c.addr = addr;
+        c.next_seqn = 0;
+        c.ready = false;
+        _clients.push_back(move(c));
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)_clients.size() - 1;
+        epoll_ctl(_epfd, EPOLL_CTL_ADD, sockfd, &ev);
+        return true;
+    }
+
+    // Registra cada cliente (PKT_DISCOVER) e descobre o próximo ID dele: uma
+    // consulta com ID 1 volta com o último ID que o servidor conhece
+    size_t prepare() {
+        auto deadline = Clock::now() + chrono::milliseconds(DISCOVERY_TIMEOUT_MS);
+        auto last_send = Clock::time_point();
+        while (Clock::now() < deadline) {
+            size_t ready = 0;
+            auto now = Clock::now();
+            bool resend = now - last_send > chrono::milliseconds(options.timeout_ms);
+            for (auto& c : _clients) {
+                if (c.ready) {
+                    ready++;
+                    continue;
+                }
+                if (!resend) continue;
+                Packet packet;
+                if (c.next_seqn == 0) {
+                    packet.type = PKT_DISCOVER;
+                } else {
+                    packet.type = PKT_REQUEST;
+                    packet.seqn = 1;
+                    packet.req.dest_addr = 0;
+                    packet.req.value = 0;
+                }
+                sendPacket(c.sockfd, packet, (const struct sockaddr*)&server_addr, sizeof(server_addr));
+            }
+            if (resend) last_send = now;
+            if (ready == _clients.size()) return ready;
+            poll(10, now);
+        }
+
+        size_t ready = 0;
+        for (auto& c : _clients) ready += c.ready;
+        return ready;
+    }
+
+    void run(Clock::time_point start, Clock::time_point end, double rate) {
+        exponential_distribution<double> gap(rate > 0 ? rate : 1);
+        auto next_arrival = start;
+        auto next_tick = start;
+
+        vector<size_t> ready;
+        for (size_t i = 0; i < _clients.size(); ++i)
+            if (_clients[i].ready) ready.push_back(i);
+        if (ready.empty()) return;
+
+        for (;;) {
+            auto now = Clock::now();
+            bool generating = now < end;
+
+            if (generating) {
+                if (rate > 0) {
+                    // Laço aberto: todas as chegadas vencidas, cada uma com o seu instante
+                    while (next_arrival <= now) {
+                        VirtualClient& c = _clients[ready[_rng() % ready.size()]];
+                        c.backlog.push_back(newOp(next_arrival));
+                        pump(c, now);
+                        next_arrival += chrono::duration_cast<Clock::duration>(chrono::duration<double>(gap(_rng)));
+                    }
+                } else {
+                    // Laço fechado: janela sempre cheia
+                    for (size_t i : ready) {
+                        VirtualClient& c = _clients[i];
+                        while ((int)(c.window.size() + c.backlog.size()) < options.window) c.backlog.push_back(newOp(now));
+                        pump(c, now);
+                    }
+                }
+            } else {
+                // Terminou o prazo: só espera o que está em voo
+                bool pending = false;
+                for (auto& c : _clients) pending |= !c.window.empty();
+                if (!pending || now > end + chrono::milliseconds(DRAIN_MS)) break;
+            }
+
+            if (now >= next_tick) {
+                retransmit(now);
+                for (size_t i : ready) pump(_clients[i], now);
+                next_tick = now + chrono::microseconds(TICK_US);
+            }
+
+            // Até a próxima chegada ou varredura (epoll tem resolução de 1ms)
+            auto wake = next_tick;
+            if (generating && rate > 0) wake = min(wake, next_arrival);
+            int timeout_ms = wake > now ? (int)chrono::duration_cast<chrono::milliseconds>(wake - now).count() : 0;
+            poll(timeout_ms, now);
+        }
+
+        for (auto& c : _clients) {
+            _stats.unanswered += c.window.size();
+            _stats.backlog_left += c.backlog.size();
+        }
+    }
+
+    const ThreadStats& stats() const { return _stats; }
+};
+
+/* === Opções === */
+
+static bool parseOption(const string& arg) {
+    auto value = [&](const char* name) -> const char* {
+        size_t n = strlen(name);
+        return arg.compare(0, n, name) == 0 ? arg.c_str() + n : nullptr;
+    };
+
+    const char* v;
+    if ((v = value("--server="))) {
+        string s(v);
+        size_t colon = s.find(':');
+        options.server_ip = s.substr(0, colon);
+        if (colon != string::npos) options.server_port = atoi(s.c_str() + colon + 1);
+    } else if ((v = value("--clients="))) options.clients = atoi(v);
+    else if ((v = value("--threads="))) options.threads = atoi(v);
+    else if ((v = value("--rate="))) options.rate = atof(v);
+    else if ((v = value("--duration="))) options.duration = atof(v);
+    else if ((v = value("--window="))) options.window = atoi(v);
+    else if ((v = value("--queries="))) options.query_pct = atoi(v);
+    else if ((v = value("--batches="))) options.batch_pct = atoi(v);
+    else if ((v = value("--batch-size="))) options.batch_size = atoi(v);
+    else if ((v = value("--zipf="))) options.zipf = atof(v);
+    else if ((v = value("--timeout-ms="))) options.timeout_ms = atoi(v);
+    else if ((v = value("--values="))) {
+        if (sscanf(v, "fixed:%lf", &options.value_a) == 1) options.value_dist = 'f';
+        else if (sscanf(v, "uniform:%lf-%lf", &options.value_a, &options.value_b) == 2) options.value_dist = 'u';
+        else if (sscanf(v, "exp:%lf", &options.value_a) == 1) options.value_dist = 'e';
+        else return false;
+        if (options.value_dist != 'u') options.value_b = options.value_a;
+    } else return false;
+    return true;
+}
+
+static bool validOptions() {
+    return options.clients > 0 && options.threads > 0 && options.threads <= options.clients && options.rate >= 0 &&
+           options.duration > 0 && options.window >= 1 && options.window <= REQUEST_WINDOW_MAX &&
+           options.query_pct >= 0 && options.batch_pct >= 0 && options.query_pct + options.batch_pct <= 100 &&
+           options.batch_size >= 1 && options.batch_size <= BATCH_REQUEST_MAX && options.value_a >= 0 &&
+           options.value_b >= options.value_a && options.timeout_ms > 0;
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (!parseOption(argv[i])) {
+            fprintf(stderr, "Opção inválida: %s (ver o cabeçalho de bench/loadgen.cpp)\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!validOptions()) {
+        fprintf(stderr, "Opções fora dos limites (janela 1-%d, lote 1-%d, queries + batches <= 100)\n",
+                REQUEST_WINDOW_MAX, BATCH_REQUEST_MAX);
+        return EXIT_FAILURE;
+    }
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(options.server_port);
+    if (inet_pton(AF_INET, options.server_ip.c_str(), &server_addr.sin_addr) != 1) {
+        fprintf(stderr, "Endereço do servidor inválido: %s\n", options.server_ip.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Um socket por cliente virtual
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    for (int i = 0; i < options.clients; ++i) client_addrs.push_back(clientAddr(i));
+    if (options.zipf > 0) buildZipf(options.clients, options.zipf);
+
+    vector<LoadThread*> threads;
+    for (int t = 0; t < options.threads; ++t) threads.push_back(new LoadThread(t));
+    for (int i = 0; i < options.clients; ++i) {
+        if (!threads[i % options.threads]->addClient(client_addrs[i])) {
+            fprintf(stderr, "Falha ao abrir o socket do cliente %d (limite de descritores?)\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Registro dos clientes no servidor, em paralelo
+    vector<size_t> prepared(options.threads);
+    {
+        vector<thread> workers;
+        for (int t = 0; t < options.threads; ++t)
+            workers.emplace_back([&, t] { prepared[t] = threads[t]->prepare(); });
+        for (auto& w : workers) w.join();
+    }
+    size_t ready = 0;
+    for (size_t p : prepared) ready += p;
+    printf("loadgen: %zu/%d clients registered at %s:%d\n", ready, options.clients, options.server_ip.c_str(),
+           options.server_port);
+    if (ready == 0) return EXIT_FAILURE;
+
+    auto start = Clock::now() + chrono::milliseconds(10);
+    auto end = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.duration));
+    {
+        vector<thread> workers;
+        for (int t = 0; t < options.threads; ++t)
+            workers.emplace_back([&, t] { threads[t]->run(start, end, options.rate / options.threads); });
+        for (auto& w : workers) w.join();
+    }
+
+    ThreadStats total;
+    for (auto* t : threads) {
+        const ThreadStats& s = t->stats();
+        total.latency.merge(s.latency);
+        total.ops_sent += s.ops_sent;
+        total.ops_done += s.ops_done;
+        total.transfers_done += s.transfers_done;
+        total.queries_done += s.queries_done;
+        total.batches_done += s.batches_done;
+        total.retransmits += s.retransmits;
+        total.unanswered += s.unanswered;
+        total.backlog_left += s.backlog_left;
+        delete t;
+    }
+
+    double secs = options.duration;
+    printf("mode: %s", options.rate > 0 ? "open loop" : "closed loop");
+    if (options.rate > 0) printf(" (target %.0f ops/s)", options.rate);
+    printf(", %d threads, window %d, duration %.1fs, timeout %dms\n", options.threads, options.window, secs,
+           options.timeout_ms);
+    printf("mix: %d%% queries, %d%% batches of %d, %d%% transfers; zipf %.2f\n", options.query_pct,
+           options.batch_pct, options.batch_size, 100 - options.query_pct - options.batch_pct, options.zipf);
+    printf("ops: sent %lu, done %lu (%lu transfers, %lu queries, %lu batches), retransmits %lu, "
+           "unanswered %lu, never sent %lu\n",
+           (unsigned long)total.ops_sent, (unsigned long)total.ops_done, (unsigned long)total.transfers_done,
+           (unsigned long)total.queries_done, (unsigned long)total.batches_done, (unsigned long)total.retransmits,
+           (unsigned long)total.unanswered, (unsigned long)total.backlog_left);
+    printf("throughput: %.0f ops/s, %.0f transfers/s\n", total.ops_done / secs, total.transfers_done / secs);
+    printf("latency_us (from scheduled send): p50 %lu  p90 %lu  p99 %lu  p999 %lu  max %lu\n",
+           (unsigned long)total.latency.percentile(0.50), (unsigned long)total.latency.percentile(0.90),
+           (unsigned long)total.latency.percentile(0.99), (unsigned long)total.latency.percentile(0.999),
+           (unsigned long)total.latency.max());
+    printf("histogram:\n");
+    total.latency.print();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,451 @@
+// Microbenchmarks do servidor: ServerDatabase::makeTransaction e as leituras
+// de conta sem lock (getClientSnapshot) de 1 a N threads, a família de locks
+// (condvar, shared_mutex, distribuído e seqlock) com leitura e escrita
+// dominantes e em contenção de 1 a 64 threads, BankSummary com o histórico
+// crescendo e as conversões de IP. A saída é
+// uma linha por medição, em CSV ou JSON, para comparar commits.
+//
+// Uso: ./micro_bench.exe [--format=csv|json] [--out=ARQUIVO] [--threads=N]
+//        [--seconds=S] [--only=NOME] [--commit=ID]
+
+#include "server/database.h"
+#include "server/locks.h"
+#include <arpa/inet.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+#define TRANSFER_ACCOUNTS 4096
+// Dados protegidos nos benchmarks de locks (duas linhas de cache)
+#define LOCKED_WORDS 16
+#define HISTORY_SIZES {1000, 10000, 100000, 1000000}
+#define IP_SAMPLES 1024
+#define CONTENTION_MAX_THREADS 64
+
+struct Options {
+    string format = "csv";
+    string out;
+    string only;
+    string commit = "unknown";
+    int threads = 0;  // 0 = max(4, núcleos)
+    double seconds = 0.5;
+};
+
+struct Result {
+    string bench;
+    string variant;
+    int threads;
+    uint64_t param;  // tamanho do histórico, % de leitura etc. (0 = não se aplica)
+    uint64_t ops;
+    double seconds;
+};
+
+static Options options;
+static vector<Result> results;
+
+static double elapsedSec(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+static bool selected(const char* bench) {
+    return options.only.empty() || options.only == bench;
+}
+
+static void report(const Result& r) {
+    results.push_back(r);
+    fprintf(stderr, "%-18s %-14s threads=%-3d param=%-8lu %12.0f ops/s %10.1f ns/op\n", r.bench.c_str(),
+            r.variant.c_str(), r.threads, (unsigned long)r.param, r.ops / r.seconds, r.seconds * 1e9 / r.ops);
+}
+
+// Roda 'body(thread, stop)' em 'threads' threads por options.seconds; cada
+// uma devolve quantas operações fez
+template <typename Body>
+static Result runThreads(int threads, Body body) {
+    atomic<bool> go{false}, stop{false};
+    vector<uint64_t> ops(threads, 0);
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            while (!go.load(memory_order_acquire)) this_thread::yield();
+            ops[t] = body(t, stop);
+        });
+    }
+
+    auto start = Clock::now();
+    go.store(true, memory_order_release);
+    this_thread::sleep_for(chrono::duration<double>(options.seconds));
+    stop.store(true, memory_order_release);
+    for (auto& w : workers) w.join();
+
+    Result r;
+    r.threads = threads;
+    r.param = 0;
+    r.ops = 0;
+    for (uint64_t n : ops) r.ops += n;
+    r.seconds = elapsedSec(start);
+    return r;
+}
+
+// 1, 2, 4, ... e o máximo pedido
+static vector<int> threadCounts(int max_threads) {
+    vector<int> counts;
+    for (int t = 1; t < max_threads; t *= 2) counts.push_back(t);
+    counts.push_back(max_threads);
+    return counts;
+}
+
+static uint32_t accountAddr(size_t i) {
+    return htonl(0x0A000000u + (uint32_t)i + 1);  // 10.x.y.z
+}
+
+/* === makeTransaction === */
+
+// Cada thread é dona de uma fatia das contas de origem (como as raias do
+// WorkerPool) e transfere para destinos aleatórios
+static void benchTransactions(int max_threads) {
+    for (int threads : threadCounts(max_threads)) {
+        unique_ptr<ServerDatabase> db(new ServerDatabase());
+        for (size_t i = 0; i < TRANSFER_ACCOUNTS; ++i) db->addClient(accountAddr(i));
+        vector<uint32_t> seqn(TRANSFER_ACCOUNTS, 0);
+
+        Result r = runThreads(threads, [&](int t, atomic<bool>& stop) {
+            minstd_rand rng(t + 1);
+            size_t slice = TRANSFER_ACCOUNTS / threads;
+            uint64_t n = 0;
+            Packet request;
+            memset(&request, 0, sizeof(request));
+            request.type = PKT_REQUEST;
+            request.req.value = 1;
+            while (!stop.load(memory_order_relaxed)) {
+                size_t origin = t * slice + rng() % slice;
+                request.seqn = ++seqn[origin];
+                TransferResult result;
+                db->makeTransaction(accountAddr(origin), accountAddr(rng() % TRANSFER_ACCOUNTS), request, result);
+                n++;
+            }
+            return n;
+        });
+        r.bench = "make_transaction";
+        r.variant = "shards" + to_string(CLIENT_TABLE_SHARDS);
+        r.param = TRANSFER_ACCOUNTS;
+        report(r);
+    }
+}
+
+// Leituras de saldo/last_req (consultas e checagem de duplicata) sem lock:
+// só leitores, mais um escritor contínuo na variante "with_writer"
+static void benchClientReads(int max_threads) {
+    unique_ptr<ServerDatabase> db(new ServerDatabase());
+    for (size_t i = 0; i < TRANSFER_ACCOUNTS; ++i) db->addClient(accountAddr(i));
+
+    for (bool with_writer : {false, true}) {
+        for (int threads : threadCounts(max_threads)) {
+            if (with_writer && threads < 2) continue;
+            int readers = with_writer ? threads - 1 : threads;
+            vector<uint32_t> seqn(TRANSFER_ACCOUNTS, 0);
+            Result r = runThreads(threads, [&](int t, atomic<bool>& stop) {
+                minstd_rand rng(t + 1);
+                uint64_t n = 0, sink = 0;
+                if (with_writer && t == readers) {
+                    // Escritor: transferências entre contas aleatórias (não conta nas operações)
+                    Packet request;
+                    memset(&request, 0, sizeof(request));
+                    request.type = PKT_REQUEST;
+                    request.req.value = 1;
+                    while (!stop.load(memory_order_relaxed)) {
+                        size_t origin = rng() % TRANSFER_ACCOUNTS;
+                        request.seqn = ++seqn[origin];
+                        TransferResult result;
+                        db->makeTransaction(accountAddr(origin), accountAddr(rng() % TRANSFER_ACCOUNTS), request,
+                                            result);
+                    }
+                    return (uint64_t)0;
+                }
+                while (!stop.load(memory_order_relaxed)) {
+                    ClientSnapshot snapshot;
+                    if (db->getClientSnapshot(accountAddr(rng() % TRANSFER_ACCOUNTS), snapshot))
+                        sink += snapshot.balance;
+                    n++;
+                }
+                asm volatile("" : : "r"(sink));
+                return n;
+            });
+            r.bench = "client_read";
+            r.variant = with_writer ? "with_writer" : "read_only";
+            r.param = TRANSFER_ACCOUNTS;
+            report(r);
+        }
+    }
+}
+
+/* === Família de locks === */
+
+// Leitura: soma os dados protegidos; escrita: incrementa todos
+template <typename Lock>
+static uint64_t lockWorkload(Lock& lock, uint64_t* data, int t, int read_pct, atomic<bool>& stop) {
+    minstd_rand rng(t + 1);
+    uint64_t n = 0, sink = 0;
+    while (!stop.load(memory_order_relaxed)) {
+        if ((int)(rng() % 100) < read_pct) {
+            ReadGuard guard(lock);
+            for (int i = 0; i < LOCKED_WORDS; ++i) sink += data[i];
+        } else {
+            WriteGuard guard(lock);
+            for (int i = 0; i < LOCKED_WORDS; ++i) data[i]++;
+        }
+        n++;
+    }
+    asm volatile("" : : "r"(sink));
+    return n;
+}
+
+// O leitor do seqlock não trava: copia e confere a sequência
+static uint64_t seqLockWorkload(SeqLock& lock, uint64_t* data, int t, int read_pct, atomic<bool>& stop) {
+    minstd_rand rng(t + 1);
+    uint64_t n = 0, sink = 0;
+    while (!stop.load(memory_order_relaxed)) {
+        if ((int)(rng() % 100) < read_pct) {
+            uint64_t sum;
+            uint32_t seq;
+            do {
+                seq = lock.read_begin();
+                sum = 0;
+                for (int i = 0; i < LOCKED_WORDS; ++i) sum += __atomic_load_n(&data[i], __ATOMIC_RELAXED);
+            } while (lock.read_retry(seq));
+            sink += sum;
+        } else {
+            WriteGuard guard(lock);
+            for (int i = 0; i < LOCKED_WORDS; ++i)
+                __atomic_store_n(&data[i], __atomic_load_n(&data[i], __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+        }
+        n++;
+    }
+    asm volatile("" : : "r"(sink));
+    return n;
+}
+
+template <typename Lock>
+static void benchLock(const char* bench, const char* variant, int threads, int read_pct) {
+    Lock lock;
+    alignas(64) uint64_t data[LOCKED_WORDS] = {0};
+    Result r = runThreads(threads, [&](int t, atomic<bool>& stop) {
+        return lockWorkload(lock, data, t, read_pct, stop);
+    });
+    r.bench = bench;
+    r.variant = variant;
+    r.param = read_pct;
+    report(r);
+}
+
+static void benchSeqLock(const char* bench, int threads, int read_pct) {
+    SeqLock lock;
+    alignas(64) uint64_t data[LOCKED_WORDS] = {0};
+    Result r = runThreads(threads, [&](int t, atomic<bool>& stop) {
+        return seqLockWorkload(lock, data, t, read_pct, stop);
+    });
+    r.bench = bench;
+    r.variant = "seqlock";
+    r.param = read_pct;
+    report(r);
+}
+
+static void benchLockFamily(const char* bench, int threads, int read_pct) {
+    benchLock<CondvarRWLock>(bench, "condvar", threads, read_pct);
+    benchLock<SharedMutexRWLock>(bench, "shared_mutex", threads, read_pct);
+    benchLock<DistributedRWLock>(bench, "distributed", threads, read_pct);
+    benchSeqLock(bench, threads, read_pct);
+}
+
+static void benchLocks(int max_threads) {
+    for (int threads : threadCounts(max_threads)) benchLockFamily("rwlock_read_heavy", threads, 95);
+    for (int threads : threadCounts(max_threads)) benchLockFamily("rwlock_write_heavy", threads, 20);
+}
+
+// Leituras como getClientBalance/getClientLastReq (quase só leitura), de 1 a
+// CONTENTION_MAX_THREADS threads independentemente do número de núcleos
+static void benchLockContention() {
+    for (int threads : threadCounts(CONTENTION_MAX_THREADS)) benchLockFamily("lock_contention", threads, 99);
+}
+
+/* === BankSummary === */
+
+// Mede uma chamada repetida até options.seconds (pelo menos uma vez)
+template <typename Call>
+static Result timeCalls(Call call) {
+    auto start = Clock::now();
+    uint64_t n = 0;
+    do {
+        call();
+        n++;
+    } while (elapsedSec(start) < options.seconds);
+
+    Result r;
+    r.threads = 1;
+    r.ops = n;
+    r.seconds = elapsedSec(start);
+    return r;
+}
+
+// getBankSummary soma as parciais das partições (não deve crescer com o
+// histórico); verifyBankSummary é a varredura completa, para comparação
+static void benchBankSummary() {
+    unique_ptr<ServerDatabase> db(new ServerDatabase());
+    for (size_t i = 0; i < TRANSFER_ACCOUNTS; ++i) db->addClient(accountAddr(i));
+    vector<uint32_t> seqn(TRANSFER_ACCOUNTS, 0);
+    minstd_rand rng(42);
+    Packet request;
+    memset(&request, 0, sizeof(request));
+    request.type = PKT_REQUEST;
+    request.req.value = 1;
+
+    size_t history = 0;
+    for (size_t target : HISTORY_SIZES) {
+        // Origem percorre as contas em ordem: saldos raramente zeram
+        for (; history < target; ++history) {
+            size_t origin = history % TRANSFER_ACCOUNTS;
+            request.seqn = ++seqn[origin];
+            TransferResult result;
+            db->makeTransaction(accountAddr(origin), accountAddr(rng() % TRANSFER_ACCOUNTS), request, result);
+        }
+
+        volatile uint32_t sink = 0;
+        Result r = timeCalls([&] { sink = db->getBankSummary().total_balance; });
+        r.bench = "bank_summary";
+        r.variant = "get";
+        r.param = target;
+        report(r);
+
+        r = timeCalls([&] { sink = db->verifyBankSummary(); });
+        r.bench = "bank_summary";
+        r.variant = "verify_scan";
+        r.param = target;
+        report(r);
+        (void)sink;
+    }
+}
+
+/* === Conversões de IP === */
+
+static void benchIpConversions() {
+    vector<string> texts;
+    vector<uint32_t> addrs;
+    minstd_rand rng(7);
+    for (int i = 0; i < IP_SAMPLES; ++i) {
+        uint32_t addr = (uint32_t)rng();
+        addrs.push_back(addr);
+        texts.push_back(uint32ToIp(addr));
+    }
+
+    volatile uint32_t sink = 0;
+    Result r = timeCalls([&] {
+        for (const auto& text : texts) sink = sink + ipToUint32(text);
+    });
+    r.ops *= IP_SAMPLES;
+    r.bench = "ip_conversion";
+    r.variant = "ipToUint32";
+    r.param = 0;
+    report(r);
+
+    r = timeCalls([&] {
+        for (uint32_t addr : addrs) sink = sink + (uint32_t)uint32ToIp(addr).size();
+    });
+    r.ops *= IP_SAMPLES;
+    r.bench = "ip_conversion";
+    r.variant = "uint32ToIp";
+    r.param = 0;
+    report(r);
+}
+
+/* === Saída === */
+
+static void writeResults(FILE* out) {
+    bool json = options.format == "json";
+    if (json) {
+        fprintf(out, "{\"commit\": \"%s\", \"seconds_per_case\": %.3f, \"results\": [\n", options.commit.c_str(),
+                options.seconds);
+    } else {
+        fprintf(out, "commit,bench,variant,threads,param,ops,seconds,ops_per_sec,ns_per_op\n");
+    }
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        double ops_per_sec = r.ops / r.seconds;
+        double ns_per_op = r.seconds * 1e9 / r.ops;
+        if (json) {
+            fprintf(out,
+                    "  {\"bench\": \"%s\", \"variant\": \"%s\", \"threads\": %d, \"param\": %lu, \"ops\": %lu, "
+                    "\"seconds\": %.6f, \"ops_per_sec\": %.1f, \"ns_per_op\": %.2f}%s\n",
+                    r.bench.c_str(), r.variant.c_str(), r.threads, (unsigned long)r.param, (unsigned long)r.ops,
+                    r.seconds, ops_per_sec, ns_per_op, i + 1 < results.size() ? "," : "");
+        } else {
+            fprintf(out, "%s,%s,%s,%d,%lu,%lu,%.6f,%.1f,%.2f\n", options.commit.c_str(), r.bench.c_str(),
+                    r.variant.c_str(), r.threads, (unsigned long)r.param, (unsigned long)r.ops, r.seconds, ops_per_sec,
+                    ns_per_op);
+        }
+    }
+
+    if (json) fprintf(out, "]}\n");
+}
+
+static bool parseOption(const string& arg) {
+    auto value = [&](const char* name) -> const char* {
+        size_t n = strlen(name);
+        return arg.compare(0, n, name) == 0 ? arg.c_str() + n : nullptr;
+    };
+
+    const char* v;
+    if ((v = value("--format="))) options.format = v;
+    else if ((v = value("--out="))) options.out = v;
+    else if ((v = value("--only="))) options.only = v;
+    else if ((v = value("--commit="))) options.commit = *v ? v : "unknown";
+    else if ((v = value("--threads="))) options.threads = atoi(v);
+    else if ((v = value("--seconds="))) options.seconds = atof(v);
+    else return false;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (!parseOption(argv[i])) {
+            fprintf(stderr, "Opção inválida: %s (ver o cabeçalho de bench/micro_bench.cpp)\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((options.format != "csv" && options.format != "json") || options.threads < 0 || options.seconds <= 0) {
+        fprintf(stderr, "Uso: --format=csv|json, --threads >= 1, --seconds > 0\n");
+        return EXIT_FAILURE;
+    }
+
+    int max_threads = options.threads;
+    if (max_threads == 0) max_threads = max(4, (int)thread::hardware_concurrency());
+
+    // Progresso legível no stderr; o resultado estruturado vai para stdout ou --out
+    if (selected("make_transaction")) benchTransactions(max_threads);
+    if (selected("client_read")) benchClientReads(max_threads);
+    if (selected("rwlock")) benchLocks(max_threads);
+    if (selected("lock_contention")) benchLockContention();
+    if (selected("bank_summary")) benchBankSummary();
+    if (selected("ip_conversion")) benchIpConversions();
+
+    FILE* out = stdout;
+    if (!options.out.empty()) {
+        out = fopen(options.out.c_str(), "w");
+        if (out == nullptr) {
+            perror("fopen");
+            return EXIT_FAILURE;
+        }
+    }
+    writeResults(out);
+    if (out != stdout) fclose(out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+// Benchmark de restart: reaplicar o log inteiro vs. carregar o snapshot (mmap)
+// e reaplicar só a cauda do log. Uso: ./restart_bench.exe [N_CONTAS ...]
+
+#include "server/database.h"
+#include "server/wal.h"
+#include "server/snapshot.h"
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+
+using namespace std;
+
+// Transferências por conta antes do snapshot e depois dele (cauda do log)
+#define TRANSFERS_PER_ACCOUNT 4
+#define TAIL_FRACTION 10  // cauda = 1/10 das transferências
+
+static uint32_t accountAddr(size_t i) {
+    return htonl(0x0A000000u + (uint32_t)i + 1);  // 10.x.y.z
+}
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static void runTransfers(ServerDatabase& db, size_t accounts, size_t count, mt19937& rng, vector<uint32_t>& seqn) {
+    uniform_int_distribution<size_t> pick(0, accounts - 1);
+    Packet request;
+    memset(&request, 0, sizeof(request));
+    request.type = PKT_REQUEST;
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t origin = pick(rng);
+        request.seqn = ++seqn[origin];
+        request.req.value = 1;
+
+        TransferResult result;
+        db.makeTransaction(accountAddr(origin), accountAddr(pick(rng)), request, result);
+    }
+}
+
+static void benchAccounts(size_t accounts, const string& dir) {
+    string wal_path = dir + "/bench_" + to_string(accounts) + ".wal";
+    string snapshot_path = wal_path + ".snap";
+    unlink(wal_path.c_str());
+    unlink(snapshot_path.c_str());
+
+    size_t transfers = accounts * TRANSFERS_PER_ACCOUNT;
+    size_t tail = transfers / TAIL_FRACTION;
+    uint64_t total_records = 0;
+    BankSummary expected;
+
+    // Estado original: contas + transferências, snapshot, e mais uma cauda no log
+    {
+        TransactionLog log;
+        log.open(wal_path);
+        log.start();
+
+        unique_ptr<ServerDatabase> db(new ServerDatabase());
+        db->attachLog(&log);
+
+        mt19937 rng(42);
+        vector<uint32_t> seqn(accounts, 0);
+        for (size_t i = 0; i < accounts; ++i) db->addClient(accountAddr(i));
+        runTransfers(*db, accounts, transfers - tail, rng, seqn);
+
+        SnapshotManager::write(snapshot_path, *db, &log);
+
+        runTransfers(*db, accounts, tail, rng, seqn);
+
+        total_records = log.lastLsn();
+        log.waitDurable(total_records);
+        log.stop();
+        expected = db->getBankSummary();
+    }
+
+    // Restart só com o log
+    double full_ms;
+    {
+        unique_ptr<ServerDatabase> db(new ServerDatabase());
+        TransactionLog log;
+        log.open(wal_path);
+
+        auto start = chrono::steady_clock::now();
+        log.replay(*db);
+        full_ms = elapsedMs(start);
+
+        BankSummary got = db->getBankSummary();
+        if (got.total_balance != expected.total_balance || got.num_transactions != expected.num_transactions) {
+            fprintf(stderr, "full replay diverged for %zu accounts\n", accounts);
+        }
+    }
+
+    // Restart com snapshot + cauda do log
+    double snapshot_ms;
+    size_t tail_records;
+    {
+        unique_ptr<ServerDatabase> db(new ServerDatabase());
+        TransactionLog log;
+        log.open(wal_path);
+
+        auto start = chrono::steady_clock::now();
+        SnapshotInfo info;
+        uint64_t after_lsn = SnapshotManager::load(snapshot_path, *db, info) ? info.start_lsn : 0;
+        tail_records = log.replay(*db, after_lsn);
+        snapshot_ms = elapsedMs(start);
+
+        BankSummary got = db->getBankSummary();
+        if (got.total_balance != expected.total_balance || got.num_transactions != expected.num_transactions ||
+            got.total_transferred != expected.total_transferred || !db->verifyBankSummary()) {
+            fprintf(stderr, "snapshot restart diverged for %zu accounts\n", accounts);
+        }
+    }
+
+    printf("%10zu %12llu %12zu %14.2f %16.2f %8.1fx\n", accounts, (unsigned long long)total_records,
+           tail_records, full_ms, snapshot_ms, full_ms / snapshot_ms);
+
+    unlink(wal_path.c_str());
+    unlink(snapshot_path.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) sizes.push_back(strtoull(argv[i], nullptr, 10));
+    if (sizes.empty()) sizes = {1000, 10000, 100000, 1000000};
+
+    const char* tmp = getenv("TMPDIR");
+    string dir = (tmp != nullptr) ? tmp : "/tmp";
+
+    printf("%10s %12s %12s %14s %16s %9s\n", "accounts", "log_records", "tail_applied", "full_replay_ms",
+           "snapshot_start_ms", "speedup");
+    for (size_t accounts : sizes) benchAccounts(accounts, dir);
+
+    return 0;
+}
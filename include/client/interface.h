@@ -18,6 +18,7 @@
 
 #include "common/utils.h"
 #include "common/protocol.h"
+#include "client/mpsc_ring.h"
 
 using namespace std;
 
@@ -43,9 +44,9 @@ private:
     ClientRequest& request_manager_;
 
     thread in_thread_, out_thread_;
-    mutex mutex_;
-    condition_variable cv_;
-    queue<AckData> acks_;
+    // ACKs a exibir: a thread de processamento publica sem lock e a de output
+    // dorme no eventfd da fila
+    MpscRing<AckData> acks_;
     atomic<bool> running_{false};
 
     void inputLoop();   // lê stdin
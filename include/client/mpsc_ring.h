@@ -0,0 +1,172 @@
+// mpsc_ring.h
+#ifndef CLIENT_MPSC_RING_H
+#define CLIENT_MPSC_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <climits>
+#include <ctime>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Espera máxima de um produtor com o anel cheio antes de olhar de novo a flag 'running'
+#define MPSC_RING_FULL_WAIT_MS 100
+
+// Fila limitada, sem lock, de vários produtores para um consumidor (anel com
+// número de sequência por célula, à la Vyukov). Push e pop não alocam nem
+// pegam mutex; só há syscall quando alguém de fato vai dormir:
+//  - o consumidor dorme no eventfd (eventFd() pode entrar num select/poll junto
+//    com um socket), e o produtor só escreve nele se o consumidor avisou que ia
+//    dormir (prepareWait);
+//  - um produtor com o anel cheio dorme num futex sobre o contador de pops.
+template <typename T>
+class MpscRing {
+private:
+    struct Cell {
+        atomic<size_t> sequence;
+        T data;
+    };
+
+    unique_ptr<Cell[]> _cells;
+    size_t _mask;
+    int _event_fd;
+
+    alignas(64) atomic<size_t> _tail;             // próxima posição a reservar (produtores)
+    alignas(64) atomic<size_t> _head;             // próxima posição a ler (só o consumidor escreve)
+    atomic<uint32_t> _pops;                       // futex dos produtores com o anel cheio
+    alignas(64) atomic<bool> _consumer_waiting;
+    atomic<uint32_t> _full_waiters;
+
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    void notifyConsumer() {
+        // Par do fence em prepareWait: ou o consumidor vê o item, ou nós vemos a flag
+        atomic_thread_fence(memory_order_seq_cst);
+        if (_consumer_waiting.load(memory_order_relaxed)) wake();
+    }
+
+public:
+    explicit MpscRing(size_t capacity)
+        : _cells(new Cell[roundUpPow2(capacity)]), _mask(roundUpPow2(capacity) - 1), _tail(0), _head(0), _pops(0),
+          _consumer_waiting(false), _full_waiters(0) {
+        for (size_t i = 0; i <= _mask; ++i) _cells[i].sequence.store(i, memory_order_relaxed);
+
+        _event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_event_fd < 0) throw runtime_error("Failed to create eventfd for the queue.");
+    }
+
+    ~MpscRing() { close(_event_fd); }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Não bloqueia: false com o anel cheio (e 'item' fica intacto)
+    bool tryPush(T& item) {
+        size_t pos = _tail.load(memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t sequence = cell->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _tail.load(memory_order_relaxed);
+            }
+        }
+
+        cell->data = move(item);
+        cell->sequence.store(pos + 1, memory_order_release);
+        notifyConsumer();
+        return true;
+    }
+
+    // Espera enquanto o anel estiver cheio. false se 'running' virar false antes
+    bool push(T item, const atomic<bool>& running) {
+        while (!tryPush(item)) {
+            if (!running.load()) return false;
+
+            _full_waiters.fetch_add(1, memory_order_seq_cst);
+            uint32_t pops = _pops.load(memory_order_seq_cst);
+            if (tryPush(item)) {
+                _full_waiters.fetch_sub(1, memory_order_relaxed);
+                return true;
+            }
+            struct timespec timeout = {0, MPSC_RING_FULL_WAIT_MS * 1000000L};
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_pops), FUTEX_WAIT_PRIVATE, pops, &timeout, nullptr, 0);
+            _full_waiters.fetch_sub(1, memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Só o consumidor
+    bool tryPop(T& out) {
+        size_t head = _head.load(memory_order_relaxed);
+        Cell& cell = _cells[head & _mask];
+        size_t sequence = cell.sequence.load(memory_order_acquire);
+        if ((intptr_t)sequence - (intptr_t)(head + 1) < 0) return false;
+
+        out = move(cell.data);
+        cell.sequence.store(head + _mask + 1, memory_order_release);
+        _head.store(head + 1, memory_order_release);
+
+        _pops.store(_pops.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (_full_waiters.load(memory_order_relaxed) > 0)
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_pops), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+        return true;
+    }
+
+    // Aproximado fora do consumidor (conta também um push ainda em andamento)
+    bool empty() const { return _head.load(memory_order_acquire) == _tail.load(memory_order_acquire); }
+
+    /* === Espera do consumidor === */
+
+    int eventFd() const { return _event_fd; }
+
+    // Avisa que vai dormir. false = já há item publicado, não durma (chame
+    // finishWait do mesmo jeito)
+    bool prepareWait() {
+        _consumer_waiting.store(true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        size_t head = _head.load(memory_order_relaxed);
+        return (intptr_t)_cells[head & _mask].sequence.load(memory_order_acquire) - (intptr_t)(head + 1) < 0;
+    }
+
+    void finishWait() {
+        _consumer_waiting.store(false, memory_order_relaxed);
+        uint64_t count;
+        while (read(_event_fd, &count, sizeof(count)) == (ssize_t)sizeof(count)) {}
+    }
+
+    // Dorme até chegar item, wake() ou o prazo (-1 = sem prazo)
+    void wait(int timeout_ms) {
+        if (prepareWait()) {
+            struct pollfd pfd = {_event_fd, POLLIN, 0};
+            poll(&pfd, 1, timeout_ms);
+        }
+        finishWait();
+    }
+
+    // Acorda o consumidor (ex.: para ele notar um pedido de parada)
+    void wake() {
+        uint64_t one = 1;
+        ssize_t written = write(_event_fd, &one, sizeof(one));
+        (void)written;
+    }
+};
+
+#endif // CLIENT_MPSC_RING_H
@@ -3,6 +3,8 @@
 #define CLIENT_REQUEST_H
 
 #include "common/protocol.h"
+#include "client/rto.h"
+#include "client/mpsc_ring.h"
 #include <string>
 #include <mutex>
 #include <queue>
@@ -15,6 +17,9 @@
 #include <sstream>
 #include <stdexcept>
 #include <tuple>
+#include <deque>
+#include <vector>
+#include <chrono>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -32,14 +37,17 @@ class ClientRequest{
 
 public:
 
-    //Construtor inicializa com o IP do servidor (descoberto) 
-    ClientRequest(const string& server_ip, int port);
+    //Construtor inicializa com o IP do servidor (descoberto). window = requisições
+    //em voo ao mesmo tempo (1 = uma por vez, esperando cada ACK)
+    ClientRequest(const string& server_ip, int port, int window = 1);
     ~ClientRequest();
 
     void setInterface(ClientInterface* interface);
     
     //Funcao chamada pela thread de input da Interface
     void enqueueCommand(const string& dest_ip, uint32_t value);
+    //Lote de transferências (enviado em PKT_BATCH_REQUEST de até BATCH_REQUEST_MAX itens)
+    void enqueueBatch(const vector<RequestData>& items);
     
     //Loop principal de envio (com lógica bloqueante)
     void runProcessingLoop();
@@ -55,11 +63,19 @@ private:
     int _sockfd;
     struct sockaddr_in _server_addr;
     uint32_t _next_seqn; //Proximo ID a ser usado (comeca em 1)
+    int _window;
+    RtoEstimator _rto; // prazo de retransmissão, adaptado ao RTT medido
     
     //Sincronizacao e fila 
-    queue<tuple<string, uint32_t>> _command_queue; //Fila de comandos do usuário
-    mutable mutex _queue_mutex;
-    condition_variable _queue_cv;
+    // Comando do usuário: uma transferência, ou um lote (linha com vários pares)
+    struct ClientCommand {
+        uint32_t dest_addr;
+        uint32_t value;
+        vector<RequestData> batch; // vazio = transferência simples
+    };
+    //Fila de comandos do usuário (sem lock; a thread de processamento dorme no
+    //eventfd dela, junto com o socket no modo janela)
+    MpscRing<ClientCommand> _commands;
     atomic<bool> _running = true;
 
     //Referencia à interface para notificar a thread de saída
@@ -70,6 +86,27 @@ private:
 
     //Logica bloqueante principal (envio, timeout e reenvio)
     bool sendRequestWithRetry(const Packet& request_packet);
+    //Mesma lógica para um lote: espera o PKT_BATCH_ACK e entrega um ACK por item
+    bool sendBatchWithRetry(const BatchRequest& batch);
+    //Envia o lote com os próximos IDs (avança _next_seqn se houve resposta)
+    void runBatchCommand(const ClientCommand& command);
+
+    // Requisição enviada esperando ACK (modo janela)
+    struct InflightRequest {
+        Packet packet;
+        chrono::steady_clock::time_point sent_at;
+        chrono::steady_clock::time_point deadline;     // prazo da tentativa atual (RTO com backoff)
+        chrono::steady_clock::time_point silent_since; // base para buscar um novo líder
+        int retries;
+        bool acked;
+        uint32_t new_balance;
+    };
+
+    //Modo janela: até _window requisições em voo, ACKs casados por seqn e
+    //entregues à interface em ordem
+    void runWindowedLoop();
+    bool rediscoverLeader();
+    void receiveWindowAcks(deque<InflightRequest>& window);
 
 };
 
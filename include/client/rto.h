@@ -0,0 +1,45 @@
+// rto.h
+#ifndef CLIENT_RTO_H
+#define CLIENT_RTO_H
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+// Prazo de retransmissão inicial, antes da primeira amostra de RTT
+#define RTO_INITIAL_MS 500
+// Limites do prazo: numa LAN o RTO cai para poucos ms; o backoff para no máximo
+#define RTO_MIN_US 2000
+#define RTO_MAX_MS 4000
+// Granularidade do relógio somada ao termo de variância (G do RFC 6298)
+#define RTO_CLOCK_GRANULARITY_US 1000
+
+// Estimador de RTT no estilo Jacobson/Karels (RFC 6298):
+//   SRTT   <- 7/8 SRTT + 1/8 R
+//   RTTVAR <- 3/4 RTTVAR + 1/4 |SRTT - R|
+//   RTO    =  SRTT + max(G, 4 * RTTVAR)
+// Pelo algoritmo de Karn, só entram amostras de requisições que não foram
+// retransmitidas (o ACK de uma retransmissão é ambíguo).
+class RtoEstimator {
+public:
+    RtoEstimator();
+
+    void sample(std::chrono::microseconds rtt);
+
+    std::chrono::microseconds rto() const { return std::chrono::microseconds(_rto_us); }
+    std::chrono::microseconds srtt() const { return std::chrono::microseconds(_srtt_us); }
+
+    // Prazo da tentativa 'attempt' (0 = primeiro envio): RTO * 2^attempt, até
+    // RTO_MAX_MS, com jitter de +-20% para que clientes que perderam pacotes
+    // juntos (ex.: durante uma eleição) não retransmitam todos no mesmo instante
+    std::chrono::microseconds timeout(int attempt);
+
+private:
+    int64_t _srtt_us;
+    int64_t _rttvar_us;
+    int64_t _rto_us;
+    bool _has_sample;
+    std::minstd_rand _rng;
+};
+
+#endif // CLIENT_RTO_H
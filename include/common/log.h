@@ -0,0 +1,70 @@
+#ifndef COMMON_LOG_H
+#define COMMON_LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Níveis de log, do mais grave ao mais detalhado. 0 desliga a categoria.
+enum LogLevel : uint8_t {
+    LOG_LEVEL_OFF = 0,
+    LOG_LEVEL_ERROR = 1,
+    LOG_LEVEL_WARN = 2,
+    LOG_LEVEL_INFO = 3,
+    LOG_LEVEL_DEBUG = 4,
+    LOG_LEVEL_TRACE = 5,
+};
+
+// Categorias com nível próprio, ajustável em tempo de execução (--log=...)
+enum LogCategory : uint8_t {
+    LOG_CAT_GENERAL,      // inicialização e encerramento
+    LOG_CAT_NET,          // sockets, laço de eventos, io_uring
+    LOG_CAT_STORAGE,      // banco, log de transações e snapshots
+    LOG_CAT_ELECTION,
+    LOG_CAT_REPLICATION,
+    LOG_CAT_PROCESSING,
+    LOG_CAT_DISCOVERY,
+    LOG_CAT_CLIENT,       // requisições do lado do cliente
+    LOG_CAT_COUNT
+};
+
+// Nível máximo compilado (make LOG_LEVEL=...). Chamadas acima dele somem em
+// tempo de compilação, com argumentos e tudo.
+#ifndef PIX_LOG_LEVEL
+#define PIX_LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+constexpr LogLevel LOG_COMPILED_LEVEL = static_cast<LogLevel>(PIX_LOG_LEVEL);
+
+// Nível corrente de cada categoria (padrão: LOG_LEVEL_INFO)
+extern atomic<uint8_t> log_category_levels[LOG_CAT_COUNT];
+
+inline bool logEnabled(LogLevel level, LogCategory category) {
+    return log_category_levels[category].load(memory_order_relaxed) >= level;
+}
+
+// Escreve "TIMESTAMP mensagem" no stdout, numa escrita só. Use as macros abaixo.
+void logWrite(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// Ajusta os níveis a partir de "debug" (todas as categorias) ou de uma lista
+// "election=debug,replication=trace,net=off". Retorna false se algo não for reconhecido.
+bool logConfigure(const string& spec);
+
+void logSetLevel(LogCategory category, LogLevel level);
+
+// Os argumentos só são avaliados se o nível estiver compilado e ligado na categoria
+#define PIX_LOG(level, category, ...)                                   \
+    do {                                                                \
+        if constexpr ((level) <= LOG_COMPILED_LEVEL) {                  \
+            if (logEnabled((level), (category))) logWrite(__VA_ARGS__); \
+        }                                                               \
+    } while (0)
+
+#define PIX_LOG_ERROR(category, ...) PIX_LOG(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+#define PIX_LOG_WARN(category, ...) PIX_LOG(LOG_LEVEL_WARN, category, __VA_ARGS__)
+#define PIX_LOG_INFO(category, ...) PIX_LOG(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#define PIX_LOG_DEBUG(category, ...) PIX_LOG(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#define PIX_LOG_TRACE(category, ...) PIX_LOG(LOG_LEVEL_TRACE, category, __VA_ARGS__)
+
+#endif // COMMON_LOG_H
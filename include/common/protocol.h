@@ -1,4 +1,5 @@
 // Definições de structs e enums para os pacotes (DESCUBERTA, REQ, ACK…)
+// São a forma em memória; no socket vai o formato de fio de common/wire.h.
 
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
@@ -28,6 +29,12 @@ typedef struct {
 
     uint32_t final_balance_origin; 
     uint32_t final_balance_dest;
+
+    // Fluxo de replicação de transferências: posição da entrada (1, 2, 3...)
+    // e época do líder (muda a cada novo líder, e a contagem recomeça).
+    // No PKT_REPLICATION_ACK, log_index é cumulativo: tudo até ele foi aplicado.
+    uint32_t log_index;
+    uint32_t log_epoch;
 } ReplicationData;
 
 typedef enum {
@@ -38,9 +45,9 @@ typedef enum {
 
     PKT_REPLICATION_REQ, //Replica transação (Servidor Líder -> Servidor Backups) 
     PKT_REPLICATION_ACK,
-    PKT_REP_CLIENT_REQ, //Replica criação de cliente (Servidor Líder -> Servidor Backups)
+    PKT_REP_CLIENT_REQ, //Replica criação de cliente (líder de versão anterior: hoje vai no fluxo de replicação)
     PKT_REP_CLIENT_ACK,
-    PKT_REP_QUERY_REQ,
+    PKT_REP_QUERY_REQ,  // Consulta avulsa (líder de versão anterior: hoje vai no fluxo de replicação)
     PKT_REP_QUERY_ACK,
 
     PKT_ELECTION,      // Inicia eleição (Servidor Backup -> Servidores Backups)
@@ -50,7 +57,15 @@ typedef enum {
     PKT_HEARTBEAT_ACK, // Resposta ao batimento cardíaco (Servidor Backup -> Servidores Backups)
 
     PKT_SERVER_DISCOVER,    //Descoberta de servidores
-    PKT_SERVER_DISCOVER_ACK
+    PKT_SERVER_DISCOVER_ACK,
+
+    PKT_REPLICATION_BATCH,  // Várias transferências do fluxo de replicação num datagrama (ReplicationRecord)
+
+    PKT_BATCH_REQUEST,      // Várias transferências de um cliente numa requisição (BatchRequest)
+    PKT_BATCH_ACK,          // Resultado de cada item e saldo final (BatchAck)
+
+    PKT_REP_SYNC_REQ,       // Backup atrás do fluxo pede o estado inteiro (Backup -> Líder)
+    PKT_REP_SYNC_DATA       // Parte do estado: contas num corte do fluxo (ReplicationSyncClient)
 } PacketType;
 
 typedef struct {
@@ -104,4 +119,73 @@ typedef struct {
 
 } Packet;
 
+// Transferência dentro de um ReplicationBatch (mesmos campos do ReplicationData).
+// Dois destinos que nenhum cliente usa marcam entradas que não são transferências,
+// mas vão no mesmo fluxo ordenado (aplicadas nos backups na ordem do líder):
+//  - 0: criação do cliente origin_addr, antes de qualquer transferência dele;
+//  - 255.255.255.255: consulta de saldo seqn de origin_addr, respondida com
+//    final_balance_origin (last_req não volta atrás por uma transferência anterior).
+#define REPLICATION_NEW_CLIENT_DEST 0
+#define REPLICATION_QUERY_DEST 0xFFFFFFFFu
+typedef struct {
+    uint32_t log_index;
+    uint32_t seqn;        // ID da requisição no cliente de origem
+    uint32_t origin_addr;
+    uint32_t dest_addr;
+    uint32_t value;
+    uint32_t final_balance_origin;
+    uint32_t final_balance_dest;
+} ReplicationRecord;
+
+inline bool isTransferRecord(const ReplicationRecord& record) {
+    return record.dest_addr != REPLICATION_NEW_CLIENT_DEST && record.dest_addr != REPLICATION_QUERY_DEST;
+}
+
+// Conta dentro de um PKT_REP_SYNC_DATA: o estado que o líder tinha no corte,
+// incluindo o ACK bufferizado (campos do PKT_REQUEST_ACK)
+typedef struct {
+    uint32_t addr;
+    uint32_t last_req;
+    uint32_t balance;
+    uint32_t ack_seqn;
+    uint32_t ack_balance;
+    uint32_t ack_dest_addr;
+    uint32_t ack_value;
+} ReplicationSyncClient;
+
+// Contas por datagrama de sincronização (cabe em WIRE_MAX_DATAGRAM, ver wire.h)
+#define REPLICATION_SYNC_CHUNK 40
+
+// Máximo de transferências por quadro de replicação (Líder -> Backups; a
+// resposta é um PKT_REPLICATION_ACK cumulativo). O quadro cheio ainda cabe
+// num pacote Ethernet sem fragmentar (WIRE_MAX_DATAGRAM = 1358 bytes)
+#define REPLICATION_BATCH_MAX 48
+
+// Máximo de requisições de um cliente em voo ao mesmo tempo (janela do
+// cliente). O servidor guarda até esse tanto de chegadas adiantadas por cliente
+#define REQUEST_WINDOW_MAX 32
+
+// Máximo de transferências numa requisição em lote. O resultado por item vai
+// num mapa de bits de 64 bits
+#define BATCH_REQUEST_MAX 64
+// Lote atômico: se um item falhar, nenhum é efetivado
+#define BATCH_FLAG_ATOMIC 0x01
+
+// Requisição em lote (Cliente -> Servidor): os itens ocupam os IDs
+// seqn .. seqn + count - 1, na ordem, como se fossem requisições seguidas
+typedef struct {
+    uint32_t seqn;
+    uint16_t count;
+    uint8_t flags;
+    RequestData items[BATCH_REQUEST_MAX];
+} BatchRequest;
+
+// Resposta ao lote (Servidor -> Cliente)
+typedef struct {
+    uint32_t seqn;        // Primeiro ID do lote
+    uint16_t count;
+    uint32_t new_balance; // Saldo da origem depois do lote
+    uint64_t applied;     // Bit i = item i efetivado
+} BatchAck;
+
 #endif // PROTOCOL_H
@@ -12,15 +12,13 @@
 #include <unistd.h>
 #include <sys/socket.h>
 
+#include "common/log.h"
+
 using namespace std;
 
 // Retorna o timestamp atual formatado como uma string.
 string get_timestamp_str();
 
-// Loga uma mensagem no console com timestamp.
-void log_message(const char *msg);
-void log_message_core(const char *msg);
-
 uint32_t ipToUint32(const string& ip_str);
 
 string uint32ToIp(uint32_t ip_int);
@@ -31,5 +29,8 @@ int getIdFromIP(const string& ip_str);
 // Obtém o IP local da máquina
 string getMyIP();
 
+// CRC32 (polinômio IEEE). 'crc' permite calcular em partes: crc32(b, n2, crc32(a, n1)).
+uint32_t crc32(const void* data, size_t len, uint32_t crc = 0);
+
 
 #endif // UTILS_H
\ No newline at end of file
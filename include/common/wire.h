@@ -0,0 +1,214 @@
+// Formato de fio das mensagens: cabeçalho de 4 bytes + carga do tipo, com
+// exatamente os campos que o tipo usa, em ordem de rede. O Packet continua
+// sendo a forma em memória; só a borda dos sockets fala este formato.
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "common/protocol.h"
+
+// Cabeçalho (todo datagrama):
+//   byte 0    versão do formato
+//   byte 1    tipo (PacketType)
+//   bytes 2-3 tamanho da carga que segue (uint16, ordem de rede)
+//
+// Atualização gradual: campos novos só são acrescentados no fim da carga, sem
+// mudar a versão. Quem lê ignora bytes a mais e lê como 0 os campos novos que
+// faltarem, então servidores e clientes de versões diferentes convivem. A
+// versão só muda quando o formato deixa de ser compatível: fora do intervalo
+// [WIRE_MIN_VERSION, WIRE_VERSION] o datagrama é recusado.
+//
+// O Packet cru de antes (tipo uint16 little-endian e preenchimento, sem
+// cabeçalho) é recusado pelas duas verificações do WireView: o byte 0 é o
+// tipo (acima de WIRE_VERSION, a não ser o tipo 1) e o tamanho da carga, lido
+// do preenchimento, não bate com o do datagrama.
+#define WIRE_VERSION 1
+#define WIRE_MIN_VERSION 1
+#define WIRE_HEADER_SIZE 4
+
+// ReplicationRecord no fio: 7 campos de 4 bytes
+#define WIRE_RECORD_SIZE 28
+// Cabeçalho do quadro de replicação: época (4) + quantidade (2)
+#define WIRE_BATCH_HEADER_SIZE 6
+// Depois dos registros: índice base da réplica (4), acrescentado no fim da carga
+#define WIRE_BATCH_TRAILER_SIZE 4
+
+// Quadro de sincronização: época (4) + pedido (4) + corte (4) + parte (2) +
+// partes (2) + transações (8) + total transferido (8) + quantidade (2), e 28 por conta
+#define WIRE_SYNC_HEADER_SIZE 34
+#define WIRE_SYNC_CLIENT_SIZE 28
+
+// Maior mensagem de um Packet (PKT_REPLICATION_REQ: 8 campos)
+#define WIRE_MAX_PACKET (WIRE_HEADER_SIZE + 32)
+// Lote de transferências: seqn (4) + quantidade (2) + flags (1) + 8 por item
+#define WIRE_BATCH_REQUEST_HEADER_SIZE 7
+#define WIRE_BATCH_ITEM_SIZE 8
+// Resposta ao lote: seqn (4) + quantidade (2) + saldo (4) + mapa de bits
+#define WIRE_BATCH_ACK_MAX (WIRE_HEADER_SIZE + 10 + BATCH_REQUEST_MAX / 8)
+
+// Maior datagrama: quadro de replicação cheio (4 + 6 + 48 * 28 + 4 = 1358 bytes)
+#define WIRE_MAX_DATAGRAM \
+    (WIRE_HEADER_SIZE + WIRE_BATCH_HEADER_SIZE + REPLICATION_BATCH_MAX * WIRE_RECORD_SIZE + WIRE_BATCH_TRAILER_SIZE)
+
+static_assert(WIRE_HEADER_SIZE + WIRE_SYNC_HEADER_SIZE + REPLICATION_SYNC_CHUNK * WIRE_SYNC_CLIENT_SIZE <=
+                  WIRE_MAX_DATAGRAM,
+              "a full sync chunk must fit in a datagram");
+
+// Buffer de recepção: qualquer mensagem cabe nele
+typedef struct {
+    uint8_t bytes[WIRE_MAX_DATAGRAM];
+} WireDatagram;
+
+// Escreve uma mensagem direto no buffer de envio (sem montar e copiar uma
+// struct). Se o buffer não couber, finish() retorna 0.
+class WireWriter {
+private:
+    uint8_t* _buf;
+    size_t _cap;
+    size_t _pos;
+    bool _overflow;
+
+    uint8_t* reserve(size_t n);
+
+public:
+    WireWriter(void* buf, size_t cap, uint8_t type);
+
+    void u8(uint8_t v);
+    void u16(uint16_t v);
+    void u32(uint32_t v);
+    // Endereço IPv4 já em ordem de rede (s_addr): vai como está
+    void addr(uint32_t v);
+
+    // Preenche o tamanho da carga; retorna o tamanho do datagrama (0 = não coube)
+    size_t finish();
+};
+
+// Lê campos em sequência a partir da carga, sem copiar o datagrama. Campos
+// além do fim da carga valem 0 (mensagem de uma versão mais antiga).
+class WireReader {
+private:
+    const uint8_t* _p;
+    size_t _len;
+    size_t _pos;
+    bool _short;
+
+public:
+    WireReader(const uint8_t* payload, size_t len) : _p(payload), _len(len), _pos(0), _short(false) {}
+
+    uint8_t u8();
+    uint16_t u16();
+    uint32_t u32();
+    uint32_t addr();
+
+    size_t remaining() const { return _pos < _len ? _len - _pos : 0; }
+    // Todos os campos lidos até aqui estavam na carga (nenhum valeu 0 por falta)
+    bool complete() const { return !_short; }
+};
+
+// Visão de um datagrama recebido: valida o cabeçalho e aponta para a carga
+class WireView {
+private:
+    const uint8_t* _data;
+    size_t _len;
+    bool _valid;
+
+public:
+    WireView(const void* data, size_t len);
+
+    // Cabeçalho completo, versão entre WIRE_MIN_VERSION e WIRE_VERSION e o
+    // datagrama exatamente do tamanho do cabeçalho mais a carga
+    bool valid() const { return _valid; }
+    uint8_t version() const { return _data[0]; }
+    uint8_t type() const { return _data[1]; }
+    const uint8_t* payload() const { return _data + WIRE_HEADER_SIZE; }
+    size_t payloadLength() const { return ((size_t)_data[2] << 8) | _data[3]; }
+
+    WireReader reader() const { return WireReader(payload(), payloadLength()); }
+};
+
+// Visão de um PKT_REPLICATION_BATCH: os registros são lidos no próprio buffer
+class ReplicationBatchView {
+private:
+    WireView _view;
+    uint32_t _epoch;
+    uint16_t _count;
+    uint32_t _base_index;
+    bool _valid;
+
+public:
+    explicit ReplicationBatchView(const WireView& view);
+
+    // Tipo certo e os 'count' registros inteiros na carga
+    bool valid() const { return _valid; }
+    uint32_t epoch() const { return _epoch; }
+    uint16_t count() const { return _count; }
+    // Índices até este não serão enviados a quem recebeu o quadro (entrou no
+    // meio da época). 0 num quadro de versão que não tem o campo.
+    uint32_t baseIndex() const { return _base_index; }
+    ReplicationRecord record(size_t i) const;
+};
+
+// Visão de um PKT_REP_SYNC_DATA (parte 'part' de 'parts' do estado no corte sync_index)
+class ReplicationSyncView {
+private:
+    WireView _view;
+    uint32_t _epoch;
+    uint32_t _request_id;
+    uint32_t _sync_index;
+    uint16_t _part;
+    uint16_t _parts;
+    uint64_t _num_transactions;
+    uint64_t _total_transferred;
+    uint16_t _count;
+    bool _valid;
+
+public:
+    explicit ReplicationSyncView(const WireView& view);
+
+    bool valid() const { return _valid; }
+    uint32_t epoch() const { return _epoch; }
+    uint32_t requestId() const { return _request_id; }
+    uint32_t syncIndex() const { return _sync_index; }
+    uint16_t part() const { return _part; }
+    uint16_t parts() const { return _parts; }
+    uint64_t numTransactions() const { return _num_transactions; }
+    uint64_t totalTransferred() const { return _total_transferred; }
+    uint16_t count() const { return _count; }
+    ReplicationSyncClient client(size_t i) const;
+};
+
+// Codifica o Packet com só os campos do seu tipo. Retorna o tamanho (0 = tipo
+// desconhecido ou buffer pequeno).
+size_t encodePacket(const Packet& packet, void* buf, size_t cap);
+
+// Decodifica um Packet (campos fora do tipo ficam zerados). false = datagrama
+// inválido ou tipo que não é um Packet (ex.: PKT_REPLICATION_BATCH).
+bool decodePacket(const WireView& view, Packet& packet);
+
+// Lote de transferências do cliente e a resposta a ele (os itens não cabem
+// num Packet). O mapa de bits do BatchAck vai com (count + 7) / 8 bytes.
+size_t encodeBatchRequest(const BatchRequest& batch, void* buf, size_t cap);
+bool decodeBatchRequest(const WireView& view, BatchRequest& batch);
+size_t encodeBatchAck(const BatchAck& ack, void* buf, size_t cap);
+bool decodeBatchAck(const WireView& view, BatchAck& ack);
+
+// Um registro do quadro de replicação. O quadro é montado por quem o envia:
+// WireWriter(PKT_REPLICATION_BATCH), u32(época), u16(quantidade), os registros
+// e u32(índice base).
+void encodeRecord(WireWriter& writer, const ReplicationRecord& record);
+
+// Uma conta do quadro de sincronização, montado como o de replicação:
+// WireWriter(PKT_REP_SYNC_DATA), o cabeçalho (ver WIRE_SYNC_HEADER_SIZE) e as contas
+void encodeSyncClient(WireWriter& writer, const ReplicationSyncClient& client);
+
+// sendto/recvfrom de um Packet no formato de fio (cliente e mensagens avulsas
+// do servidor). recvPacket retorna -1 em erro do socket, 0 para um datagrama
+// que não decodifica (packet fica zerado) e senão o tamanho recebido.
+ssize_t sendPacket(int sockfd, const Packet& packet, const struct sockaddr* addr, socklen_t addrlen);
+ssize_t recvPacket(int sockfd, Packet& packet, int flags, struct sockaddr* from, socklen_t* fromlen);
+
+#endif // WIRE_H
@@ -0,0 +1,149 @@
+#ifndef SERVER_ACCOUNT_TABLE_H
+#define SERVER_ACCOUNT_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "common/protocol.h"
+#include "server/locks.h"
+
+using namespace std;
+
+#define INITIAL_CLIENT_BALANCE 100
+
+// Conta de um cliente. A chave é o IPv4 em network byte order, como vem do socket.
+struct Client {
+    uint32_t addr;
+    uint32_t last_req;
+    uint32_t balance;
+    // Versão do registro (seqlock da conta): ímpar enquanto um commit altera
+    // os campos. Só muda dentro de um ClientWriteGuard.
+    uint32_t version;
+
+    Packet last_ack_response;
+
+    Client() : addr(0), last_req(0), balance(0), version(0) {
+        memset(&last_ack_response, 0, sizeof(Packet));
+    }
+
+    explicit Client(uint32_t client_addr)
+        : addr(client_addr), last_req(0), balance(INITIAL_CLIENT_BALANCE), version(0) {
+        memset(&last_ack_response, 0, sizeof(Packet));
+    }
+};
+
+// Cópia consistente dos campos de uma conta, lida sem lock
+struct ClientSnapshot {
+    uint32_t last_req;
+    uint32_t balance;
+    Packet last_ack_response;
+};
+
+// Alteração de uma ou duas contas (origem e destino podem ser a mesma): a
+// versão fica ímpar durante o escopo, e leitores que cruzarem com ele refazem
+// a leitura. O chamador tem o lock de escrita das partições; o escopo tem que
+// terminar antes de soltá-lo.
+class ClientWriteGuard {
+private:
+    Client* _a;
+    Client* _b;
+
+    static void bump(Client* client, int order) {
+        __atomic_store_n(&client->version, client->version + 1, order);
+    }
+
+public:
+    explicit ClientWriteGuard(Client* a, Client* b = nullptr) : _a(a), _b(b == a ? nullptr : b) {
+        bump(_a, __ATOMIC_RELAXED);
+        if (_b != nullptr) bump(_b, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
+    ~ClientWriteGuard() {
+        bump(_a, __ATOMIC_RELEASE);
+        if (_b != nullptr) bump(_b, __ATOMIC_RELEASE);
+    }
+
+    ClientWriteGuard(const ClientWriteGuard&) = delete;
+    ClientWriteGuard& operator=(const ClientWriteGuard&) = delete;
+};
+
+// Espalha os bits do endereço (finalizador do MurmurHash3). Os IPs de uma
+// rede diferem quase só no último byte, então sem isso as chaves colidem.
+static inline uint32_t hashAddr(uint32_t addr) {
+    addr ^= addr >> 16;
+    addr *= 0x85ebca6bu;
+    addr ^= addr >> 13;
+    addr *= 0xc2b2ae35u;
+    addr ^= addr >> 16;
+    return addr;
+}
+
+// Tabela hash plana com endereçamento aberto (sondagem linear) e registros
+// Client guardados inline no vetor: uma busca toca poucas linhas de cache
+// e não aloca nada. A chave 0 (0.0.0.0) marca slot vazio.
+// Não é thread-safe: o chamador protege com o lock da partição. A exceção é
+// readClient(), que lê sem lock nenhum (ver abaixo).
+class AccountTable {
+private:
+    struct Slot {
+        uint32_t key;
+        Client client;
+
+        Slot() : key(0) {}
+    };
+
+    // Um vetor de slots com a sua máscara: nunca muda de tamanho
+    struct Storage {
+        uint32_t mask;
+        vector<Slot> slots;
+
+        explicit Storage(size_t capacity) : mask((uint32_t)(capacity - 1)), slots(capacity) {}
+    };
+
+    // O atual é o último. Os anteriores ficam vivos porque um leitor sem lock
+    // pode estar no meio de uma sondagem neles (somam menos que o atual, que
+    // sempre dobra).
+    vector<unique_ptr<Storage>> _storages;
+    atomic<Storage*> _current;
+    size_t _size;
+
+    // Ímpar durante inserções e crescimento: o leitor sem lock refaz a busca
+    SeqLock _layout;
+
+    void grow();
+
+    // Cópia de um registro pela versão dele (espera um commit em andamento)
+    static void readRecord(const Client& client, ClientSnapshot& out);
+
+public:
+    explicit AccountTable(size_t initial_capacity = 16);
+
+    Client* find(uint32_t addr);
+    const Client* find(uint32_t addr) const;
+
+    // Leitura sem lock e sem escrever em memória compartilhada: copia os campos
+    // da conta e confere as versões do registro e da tabela, refazendo só se um
+    // commit ou uma inserção cruzou a leitura. false = cliente inexistente.
+    bool readClient(uint32_t addr, ClientSnapshot& out) const;
+
+    // Insere um cliente novo; retorna nullptr se a chave já existir (ou for 0).
+    // Ponteiros retornados valem até a próxima inserção (a tabela pode crescer).
+    Client* insert(uint32_t addr);
+
+    // Garante espaço para 'count' clientes sem crescer (usado ao restaurar snapshots)
+    void reserve(size_t count);
+
+    size_t size() const { return _size; }
+
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (const auto& slot : _storages.back()->slots) {
+            if (slot.key != 0) fn(slot.client);
+        }
+    }
+};
+
+#endif // SERVER_ACCOUNT_TABLE_H
@@ -0,0 +1,70 @@
+#ifndef SERVER_ACK_DEMUX_H
+#define SERVER_ACK_DEMUX_H
+
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <netinet/in.h>
+#include "common/protocol.h"
+
+using namespace std;
+
+// Chamado com o ACK recebido (acked = true) ou no prazo (acked = false, ack zerado)
+using AckCallback = function<void(bool acked, const Packet& ack)>;
+// Recebe todos os ACKs de um tipo (ex.: os cumulativos do fluxo de replicação)
+using AckStreamHandler = function<void(const Packet& ack, const struct sockaddr_in& sender_addr)>;
+
+// Distribui os ACKs que chegam no socket de réplicas. Só a thread do
+// laço de eventos lê o socket; quem envia uma mensagem registra antes o que
+// espera, pela chave (tipo, seqn, IP do cliente em rep.origin_addr), e recebe
+// o ACK por callback. Assim replicações concorrentes não roubam
+// ACKs umas das outras. Vale o primeiro ACK de cada chave (basta um backup).
+class AckDemux {
+private:
+    using Key = tuple<uint16_t, uint32_t, uint32_t>;
+
+    struct Waiter {
+        chrono::steady_clock::time_point deadline;
+        AckCallback callback;
+    };
+
+    mutex _mutex;
+    condition_variable _cv;
+    multimap<Key, Waiter> _waiters;
+    map<uint16_t, AckStreamHandler> _stream_handlers;
+
+    atomic<bool> _running;
+    thread _timer;
+
+    void timerLoop();
+
+public:
+    AckDemux();
+    ~AckDemux();
+
+    // Thread que encerra (com acked = false) as esperas vencidas
+    void start();
+    void stop();
+
+    // Registra a espera ANTES de enviar a mensagem (o ACK pode chegar logo)
+    void expect(uint16_t type, uint32_t seqn, uint32_t origin_addr,
+                chrono::milliseconds timeout, AckCallback callback);
+
+    // Todos os ACKs do tipo vão para 'handler' em vez das esperas por chave
+    void setStreamHandler(uint16_t type, AckStreamHandler handler);
+
+    // Chamado pelo laço de eventos; retorna false se ninguém esperava o ACK
+    bool deliver(const Packet& ack, const struct sockaddr_in& sender_addr);
+
+    AckDemux(const AckDemux&) = delete;
+    AckDemux& operator=(const AckDemux&) = delete;
+};
+
+extern AckDemux ack_demux;
+
+#endif // SERVER_ACK_DEMUX_H
@@ -0,0 +1,70 @@
+#ifndef SERVER_BATCH_IO_H
+#define SERVER_BATCH_IO_H
+
+#include <vector>
+#include <cstddef>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include "common/protocol.h"
+#include "common/wire.h"
+
+using namespace std;
+
+// Máximo de datagramas por recvmmsg/sendmmsg
+#define BATCH_IO_MAX 64
+// Padrão da flag --batch-io (0 = um recvfrom/sendto por datagrama)
+#define DEFAULT_BATCH_IO 32
+
+// Tamanho do lote de E/S do servidor; 0 desliga recvmmsg e a saída em lote
+void setBatchIo(size_t batch);
+size_t batchIoSize();
+
+// Recebe até 'batch' datagramas por chamada (recvmmsg). Bloqueia até chegar
+// o primeiro e leva junto os que já estiverem na fila do socket.
+class DatagramReceiver {
+private:
+    vector<WireDatagram> _buffers;
+    vector<struct sockaddr_in> _addrs;
+    vector<struct iovec> _iovecs;
+    vector<struct mmsghdr> _msgs;
+
+public:
+    explicit DatagramReceiver(size_t batch);
+
+    // Retorna quantos datagramas chegaram (>= 1), ou -1 em erro. Com
+    // flags = MSG_DONTWAIT não espera nem pelo primeiro (-1 e EAGAIN).
+    int receive(int sockfd, int flags = 0);
+
+    // Bytes do datagrama i no formato de fio (ver WireView)
+    const uint8_t* data(size_t i) const { return _buffers[i].bytes; }
+    size_t length(size_t i) const { return _msgs[i].msg_len; }
+    const struct sockaddr_in& sender(size_t i) const { return _addrs[i]; }
+    socklen_t senderLen(size_t i) const { return _msgs[i].msg_hdr.msg_namelen; }
+
+    DatagramReceiver(const DatagramReceiver&) = delete;
+    DatagramReceiver& operator=(const DatagramReceiver&) = delete;
+};
+
+// Saída em lote por thread. Enquanto houver um OutboxScope aberto na thread,
+// sendDatagram codifica os Packets direto na caixa e o fim do escopo (ou a
+// caixa cheia) envia todos com sendmmsg. Sem escopo aberto, ou com
+// --batch-io=0, é um sendto.
+class OutboxScope {
+public:
+    OutboxScope();
+    ~OutboxScope();
+
+    OutboxScope(const OutboxScope&) = delete;
+    OutboxScope& operator=(const OutboxScope&) = delete;
+};
+
+ssize_t sendDatagram(int sockfd, const Packet& packet, const struct sockaddr_in& addr, socklen_t addrlen);
+// Mesmo caminho para uma mensagem já codificada (ex.: PKT_BATCH_ACK). Acima de
+// WIRE_MAX_PACKET bytes sai direto, sem passar pela caixa.
+ssize_t sendEncoded(int sockfd, const void* data, size_t len, const struct sockaddr_in& addr, socklen_t addrlen);
+
+// Envia já o que a thread acumulou (chamado pelo fim do OutboxScope)
+void flushOutbox();
+
+#endif // SERVER_BATCH_IO_H
@@ -0,0 +1,54 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <string>
+#include <cstddef>
+#include "server/worker_pool.h"
+#include "server/wal.h"
+#include "server/snapshot.h"
+#include "server/replication.h"
+#include "server/batch_io.h"
+
+using namespace std;
+
+#define DEFAULT_WORKER_QUEUE_CAPACITY 4096
+
+// Opções de execução do servidor (flags --opcao=valor após as portas)
+struct ServerConfig {
+    size_t worker_threads;        // 0 = número de núcleos
+    size_t worker_queue_capacity;
+    OverloadPolicy overload_policy;
+
+    bool wal_enabled;
+    string wal_path;              // vazio = pix_server_<ID>.wal no diretório atual
+    unsigned int wal_group_commit_us;
+    unsigned int snapshot_interval_s;  // 0 = sem snapshots (requer o log)
+
+    size_t replication_batch;          // Transferências por quadro de replicação
+    unsigned int replication_batch_us; // Espera para completar o quadro (0 = envia na hora)
+
+    size_t batch_io;                   // Datagramas por recvmmsg/sendmmsg (0 = recvfrom/sendto)
+    size_t reuseport_sockets;          // Sockets SO_REUSEPORT na porta de clientes, um receptor cada
+    bool io_uring;                     // Backend io_uring (só tem efeito com make IO_URING=1)
+
+    ServerConfig()
+        : worker_threads(0),
+          worker_queue_capacity(DEFAULT_WORKER_QUEUE_CAPACITY),
+          overload_policy(OVERLOAD_REPLY_LAST_ACK),
+          wal_enabled(true),
+          wal_group_commit_us(WAL_DEFAULT_GROUP_COMMIT_US),
+          snapshot_interval_s(DEFAULT_SNAPSHOT_INTERVAL_S),
+          replication_batch(REPLICATION_BATCH_MAX),
+          replication_batch_us(REPLICATION_BATCH_DELAY_US),
+          batch_io(DEFAULT_BATCH_IO),
+          reuseport_sockets(1),
+          io_uring(true) {}
+};
+
+// Lê as flags a partir de argv[first]. Lança invalid_argument em flag inválida.
+ServerConfig parseServerOptions(int argc, char* argv[], int first);
+
+// Texto de ajuda das flags (usado no Usage do main)
+void printServerOptionsUsage();
+
+#endif // SERVER_CONFIG_H
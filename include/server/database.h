@@ -1,7 +1,6 @@
 #ifndef SERVER_DATABASE_H
 #define SERVER_DATABASE_H
 
-#include <unordered_map>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -9,31 +8,44 @@
 #include "common/protocol.h"
 #include "common/utils.h"
 #include "server/locks.h"
+#include "server/account_table.h"
 #include <atomic>
 #include <cstring>
 #define ERROR -1
 
 using namespace std;
 
-struct Client {
-    string ip;
-    uint32_t last_req;
-    uint32_t balance;
-
-    Packet last_ack_response;
-    
-    Client(const string& client_ip) : ip(client_ip), last_req(0), balance(100.0) {}
-};
+class TransactionLog;
+struct WalRecord;
+struct SnapshotClient;
+struct SnapshotShardHeader;
 
 struct Transaction {
     int id;
-    string origin_ip;
+    uint32_t origin_addr;
     int req_id;
-    string destination_ip;
+    uint32_t destination_addr;
     uint32_t amount;
 
-    Transaction(int next_transaction_id, const string& origin_ip, int req_id, const string& destination_ip, uint32_t amount)
-        : id(next_transaction_id++), origin_ip(origin_ip), req_id(req_id), destination_ip(destination_ip), amount(amount) {}
+    Transaction(int next_transaction_id, uint32_t origin_addr, int req_id, uint32_t destination_addr, uint32_t amount)
+        : id(next_transaction_id++), origin_addr(origin_addr), req_id(req_id), destination_addr(destination_addr), amount(amount) {}
+};
+
+// Resultado de makeTransaction
+struct TransferResult {
+    uint32_t balance_origin;  // Saldo final da origem (em falha: saldo atual)
+    uint32_t balance_dest;
+    uint64_t lsn;             // Posição no log de transações (0 = sem log)
+};
+
+// Resultado de makeBatchTransaction
+struct BatchResult {
+    uint64_t applied;         // Bit i = item i efetivado
+    uint32_t balance_origin;  // Saldo final da origem
+    // Itens efetivados, na ordem, com os saldos finais de cada um (para replicar)
+    ReplicationRecord transfers[BATCH_REQUEST_MAX];
+    size_t transfer_count;
+    uint64_t lsn;             // Posição do último registro no log (0 = sem log)
 };
 
 struct BankSummary {
@@ -42,60 +54,181 @@ struct BankSummary {
     uint32_t total_balance;
 };
 
+// Quantidade de partições da tabela de clientes (cada uma com seu lock).
+// No máximo 64: conjuntos de partições são máscaras de 64 bits.
+#define CLIENT_TABLE_SHARDS 64
+
+// Partição da tabela de clientes.
+// Cada partição guarda somas parciais do BankSummary, atualizadas em O(1)
+// no commit (sob o lock da partição) e somadas na leitura.
+struct alignas(64) ClientShard {
+    AccountTable clients;
+    mutable RWLock lock;
+
+    atomic<uint64_t> balance_sum{0};        // Soma dos saldos dos clientes da partição
+    atomic<uint64_t> num_transactions{0};   // Transações com origem na partição
+    atomic<uint64_t> total_transferred{0};  // Valor transferido com origem na partição
+
+    // LSN de corte do snapshot restaurado: o replay pula registros até ele
+    uint64_t restored_lsn = 0;
+};
+
 class ServerDatabase {
 private:
-    // Tabela de clientes (hash table)
-    unordered_map<string, Client> client_table;
-    mutable RWLock client_table_lock;
+    // Tabela de clientes, particionada pelo IP (uint32_t em network byte order).
+    // Uma transferência trava só as partições da origem e do destino.
+    ClientShard client_shards[CLIENT_TABLE_SHARDS];
     
     // Histórico de transações
     vector<Transaction> transaction_history;
     mutable RWLock transaction_history_lock;
-    
-    // Resumo/estatísticas do banco
-    BankSummary bank_summary;
-    mutable RWLock bank_summary_lock;
 
     // Contador para gerar IDs únicos de transação
     atomic<int> next_transaction_id;
 
+    // Transações que vieram de um snapshot (estão nos contadores, mas não no histórico)
+    uint64_t history_base_transactions;
+    uint64_t history_base_transferred;
+
+    // Log de transações (nullptr = sem durabilidade). Os registros são
+    // anexados dentro da seção crítica, então a ordem do log respeita a
+    // ordem dos commits em cada conta.
+    TransactionLog* transaction_log_;
+
+    uint64_t appendLog_unsafe(uint8_t type, uint32_t origin_addr, uint32_t dest_addr, uint32_t req_id,
+                              uint32_t amount, uint32_t balance_origin, uint32_t balance_dest);
+
+    // Sobrescreve as contas com o resultado de uma transferência já decidida.
+    // apply_origin/apply_dest permitem pular o lado que um snapshot já contém.
+    void applyTransferState_unsafe(size_t orig_shard, Client* orig, size_t dest_shard, Client* dest,
+                                   uint32_t req_id, uint32_t amount, uint32_t final_balance_origin,
+                                   uint32_t final_balance_dest, bool apply_origin, bool apply_dest);
+
+    static size_t shardIndex(uint32_t addr);
+    ClientShard& shardFor(uint32_t addr);
+
+    // Busca sem lock: o chamador deve ter o lock da partição do IP
+    Client* findClient_unsafe(uint32_t addr);
+
+    // Cria o cliente (saldo inicial, no log; o LSN do registro vai em *lsn).
+    // nullptr se já existe. Lock de escrita da partição.
+    Client* insertClient_unsafe(uint32_t addr, uint64_t* lsn = nullptr);
+
+    // recordQuery com o lock de escrita da partição já tomado
+    uint64_t recordQuery_unsafe(uint32_t addr, uint32_t req_number, uint32_t balance);
+
+    // [BACKUP] Conta citada por uma entrada replicada e que não existe aqui (o
+    // backup entrou no fluxo depois da criação dela): é criada, e os saldos
+    // absolutos da entrada a deixam igual à do líder. Chamar para origem e
+    // destino antes de buscar os ponteiros (a inserção pode mover a tabela).
+    // false = endereço inválido.
+    bool ensureReplicatedClient_unsafe(uint32_t addr);
+
+    // Trava as partições de dois IPs em ordem crescente de índice (evita deadlock).
+    // Se caírem na mesma partição, trava uma única vez.
+    void lockPair_unsafe(size_t a, size_t b);
+    void unlockPair_unsafe(size_t a, size_t b);
+
+    // Trava para escrita as partições de uma máscara (bit i = partição i), em ordem crescente
+    void lockShards_unsafe(uint64_t mask);
+    void unlockShards_unsafe(uint64_t mask);
+
+    // Trava/destrava todas as partições para leitura, em ordem
+    void readLockAllShards() const;
+    void unlockAllShards() const;
+
 public:
-    ServerDatabase() : next_transaction_id(1) {}
+    ServerDatabase()
+        : next_transaction_id(1), history_base_transactions(0), history_base_transferred(0),
+          transaction_log_(nullptr) {}
+
+    // Liga o log de transações (depois do replay, para não regravar o que foi lido)
+    void attachLog(TransactionLog* log) { transaction_log_ = log; }
 
     // === Métodos para gerenciar clientes ===
-    bool addClient(const string& ip_address);
+    bool addClient(uint32_t addr);
+
+    // Leituras sem lock: saldo, last_req e ACK bufferizado de uma mesma versão
+    // do registro (os getters abaixo copiam um campo dele). false = inexistente.
+    bool getClientSnapshot(uint32_t addr, ClientSnapshot& out);
 
-    uint32_t getClientBalance(const string& ip_address);
-    uint32_t getClientBalance_unsafe(const string& ip_address);
+    uint32_t getClientBalance(uint32_t addr);
 
-    bool updateClientBalance(const string& ip_address, int32_t transaction_value);
-    bool updateClientBalance_unsafe(const string& ip_address, int32_t transaction_value);
+    bool updateClientBalance(uint32_t addr, int32_t transaction_value);
 
-    uint32_t getClientLastReq(const string& ip_address);
+    uint32_t getClientLastReq(uint32_t addr);
 
-    bool updateClientLastReq(const string& ip_address, uint32_t req_number);
-    bool updateClientLastReq_unsafe(const string& ip_address, uint32_t req_number);
+    bool updateClientLastReq(uint32_t addr, uint32_t req_number);
 
-    Packet getClientLastAck(const string& ip_address);
+    Packet getClientLastAck(uint32_t addr);
     
-    bool updateClientLastAck_unsafe(const string& ip_address, const Packet& ack);
-    bool updateClientLastAck(const string& ip_address, const Packet& ack);
+    bool updateClientLastAck(uint32_t addr, const Packet& ack);
+
+    // Consulta de saldo efetivada: avança last_req e bufferiza o ACK, juntos.
+    // Retorna o LSN do registro no log (0 = sem log, cliente inexistente ou
+    // consulta mais antiga que last_req).
+    uint64_t recordQuery(uint32_t addr, uint32_t req_number, uint32_t balance);
 
     
     // === Métodos para gerenciar transações ===
-    bool makeTransaction(const string& origin_ip, const string& dest_ip, Packet request);
+    // Valida e efetiva a transferência. Devolve os saldos finais e o LSN do registro.
+    bool makeTransaction(uint32_t origin_addr, uint32_t dest_addr, const Packet& request, TransferResult& result);
+
+    // Efetiva um lote sob uma única aquisição das partições envolvidas. Item a
+    // item (os recusados são pulados) ou, com BATCH_FLAG_ATOMIC, tudo ou nada.
+    // last_req avança para o último ID do lote. false = origem inexistente.
+    bool makeBatchTransaction(uint32_t origin_addr, const BatchRequest& batch, BatchResult& result);
 
-    int addTransaction(const string& origin_ip, int req_id, const string& destination_ip, uint32_t amount);
-    int addTransaction_unsafe(const string& origin_ip, int req_id, const string& destination_ip, uint32_t amount);
+    // [BACKUP/REPLAY] Aplica o estado final replicado pelo líder (saldos, histórico,
+    // last_req e ACK bufferizado). Retorna o LSN do registro (0 = sem log ou falha).
+    uint64_t applyReplicatedTransfer(uint32_t origin_addr, uint32_t dest_addr, uint32_t req_id,
+                                     uint32_t amount, uint32_t final_balance_origin, uint32_t final_balance_dest);
+
+    // [BACKUP] Aplica um lote replicado, em ordem, travando uma única vez todas
+    // as partições envolvidas. Registros com dest_addr == REPLICATION_NEW_CLIENT_DEST
+    // criam o cliente e com REPLICATION_QUERY_DEST registram uma consulta.
+    // Retorna o LSN do último registro (0 = sem log).
+    uint64_t applyReplicatedBatch(const ReplicationRecord* records, size_t count);
+
+    int addTransaction(uint32_t origin_addr, int req_id, uint32_t destination_addr, uint32_t amount);
+
+    // === Snapshots e replay ===
+    static size_t shardCount() { return CLIENT_TABLE_SHARDS; }
+
+    // Copia uma partição sob o lock de leitura só dela (as demais seguem livres).
+    // Preenche o cabeçalho, incluindo o LSN de corte.
+    void captureShard(size_t index, vector<SnapshotClient>& out, SnapshotShardHeader& header) const;
+
+    // Restaura uma partição a partir do snapshot (banco vazio, antes do replay)
+    void restoreShard(size_t index, const SnapshotClient* clients, const SnapshotShardHeader& header);
+
+    // [LÍDER] Todas as contas e os totais do BankSummary num corte consistente
+    // (todas as partições travadas juntas), para sincronizar um backup
+    void captureSyncState(vector<ReplicationSyncClient>& out, uint64_t& num_transactions,
+                          uint64_t& total_transferred) const;
+
+    // [BACKUP] Passa a ter exatamente o estado recebido do líder: contas (criadas
+    // se faltarem), saldos, last_req, ACK bufferizado e totais. O histórico
+    // anterior fica só contado, como num snapshot. Não vai para o log: depois,
+    // grave um snapshot.
+    void installSyncState(const vector<ReplicationSyncClient>& clients, uint64_t num_transactions,
+                          uint64_t total_transferred);
+
+    // [REPLAY] Reaplica um registro do log, pulando as partições cujo snapshot
+    // já o contém. Retorna false se nada foi aplicado.
+    bool applyLogRecord(const WalRecord& record);
 
     // === Métodos para estatísticas do banco ===
+    // Soma as parciais das partições: O(CLIENT_TABLE_SHARDS), sem varrer histórico/clientes
     BankSummary getBankSummary() const;
-    void updateBankSummary_unsafe();
-    void updateBankSummary();
+
+    // Confere as somas parciais contra uma varredura completa (loga divergências).
+    // Com PIX_DEBUG é chamado automaticamente após cada commit.
+    bool verifyBankSummary() const;
     
     uint32_t getTotalBalance() const;
 
-    void forceClientBalance(const string& ip, uint32_t new_balance); 
+    void forceClientBalance(uint32_t addr, uint32_t new_balance); 
 };
 
 // Instância única do banco de dados do servidor
@@ -7,6 +7,7 @@
 #include "server/database.h"
 #include "common/utils.h"
 #include "server/replication.h" 
+#include "server/batch_io.h"
 
 class ServerDiscovery {
 public:
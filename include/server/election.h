@@ -7,6 +7,7 @@
 
 #include "common/protocol.h"
 #include "server/replication.h"
+#include "server/event_loop.h"
 #include <functional>
 #include <map>
 #include <mutex>
@@ -18,6 +19,8 @@
 #define HEARTBEAT_INTERVAL_MS 1000
 #define LEADER_TIMEOUT_MS 3000
 #define ELECTION_TIMEOUT_MS 2000
+// Período da verificação de timeout do líder e da eleição
+#define ELECTION_MONITOR_MS 500
 
 using namespace std;
 using namespace chrono;
@@ -48,19 +51,21 @@ private:
     atomic<int> current_leader_id;
     atomic<bool> election_in_progress;
     steady_clock::time_point last_heartbeat_from_leader;
+    steady_clock::time_point election_started;  // Candidatura atual (guardado por heartbeat_mutex)
     mutable mutex heartbeat_mutex;
     
-    // === Controle de threads ===
+    // === Controle dos timers (no laço de eventos) ===
     atomic<bool> running;
-    thread heartbeat_thread;
-    thread monitor_thread;
+    EventLoop* loop;
+    int heartbeat_timer;
+    int monitor_timer;
     
     // === Callback para notificar mudanças ===
     ElectionCallback on_leader_change;
     
     // === Métodos privados ===
-    void heartbeatLoop();
-    void monitorLoop();
+    void onHeartbeatTimer();
+    void onMonitorTimer();
     void startElection();
     void sendElectionMsg(int target_id);
     void sendOkMsg(int target_id);
@@ -73,7 +78,8 @@ private:
 public:
     ElectionManager()
         : my_id(-1), sockfd(-1), state(FOLLOWER),
-          current_leader_id(0), election_in_progress(false), running(false) {}
+          current_leader_id(0), election_in_progress(false), running(false),
+          loop(nullptr), heartbeat_timer(-1), monitor_timer(-1) {}
     
     // === Interface pública ===
     
@@ -82,8 +88,9 @@ public:
     void addReplica(int id, string ip, int port);
     void setLeaderChangeCallback(ElectionCallback callback);
     
-    // Controle do módulo
-    void start();
+    // Controle do módulo: heartbeats e monitoramento como timers do laço.
+    // stop() só depois que o laço parou.
+    void start(EventLoop& event_loop);
     void stop();
     
     // Handlers de mensagens (chamados pelo main loop)
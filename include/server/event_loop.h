@@ -0,0 +1,67 @@
+#ifndef SERVER_EVENT_LOOP_H
+#define SERVER_EVENT_LOOP_H
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+// Eventos tratados por volta do epoll_wait
+#define EVENT_LOOP_MAX_EVENTS 64
+
+using EventHandler = function<void()>;
+
+// Laço de eventos (epoll + timerfd): uma thread espera ao mesmo tempo por
+// sockets legíveis e por timers, sem sleep nem select. Os handlers rodam na
+// thread de run() e não devem bloquear (quem espera ACK espera em outra thread).
+// watch/addTimer/armTimer podem ser chamados de qualquer thread.
+class EventLoop {
+private:
+    struct Watch {
+        int fd;
+        bool timer;  // timerfd: consome as expirações antes do handler
+        EventHandler handler;
+    };
+
+    int _epoll_fd;
+    int _wake_fd;  // eventfd para acordar o epoll_wait no stop()
+    atomic<bool> _stopped;
+
+    mutex _mutex;
+    map<int, shared_ptr<Watch>> _watches;
+
+    void add(int fd, bool timer, EventHandler handler);
+
+public:
+    EventLoop();
+    ~EventLoop();
+
+    // Chama on_readable sempre que o fd tiver dados (level-triggered):
+    // o handler pode ler só um lote, o resto dispara de novo
+    void watch(int fd, EventHandler on_readable);
+    void unwatch(int fd);
+
+    // Timer desarmado; retorna o identificador usado em armTimer
+    int addTimer(EventHandler on_expire);
+    // Dispara daqui a 'after' e depois a cada 'period' (0 = uma vez só)
+    void armTimer(int timer, chrono::microseconds after, chrono::microseconds period = chrono::microseconds(0));
+    void disarmTimer(int timer);
+    void removeTimer(int timer);
+
+    // Roda os handlers até stop()
+    void run();
+    void stop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+};
+
+// Laço da thread principal: socket de clientes, socket de réplicas e os
+// timers da eleição e da replicação
+extern EventLoop event_loop;
+
+#endif // SERVER_EVENT_LOOP_H
@@ -3,21 +3,51 @@
 
 #pragma once
 
-#include <iostream>
-
-#include <queue>
-#include <string>
-
-#include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <atomic>
-#include <sstream>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "common/utils.h"
 
 using namespace std;
 
+// Tipos de evento do log de operações
+enum LogEventType : uint8_t {
+    LOG_EVENT_REQUEST,     // requisição executada (ou replicada, num backup)
+    LOG_EVENT_DUPLICATE,   // requisição duplicada ou fora de ordem respondida com o último ACK
+    LOG_EVENT_BATCH,       // lote de transferências
+};
+
+// Registro binário de tamanho fixo: quem atende a requisição só preenche os
+// campos; o texto é montado na thread da interface
+struct LogRecord {
+    uint64_t tsc;          // instante do evento (contador da CPU, ver readLogClock)
+    uint8_t type;          // LogEventType
+    uint8_t duplicate;     // LOG_EVENT_DUPLICATE: 1 = duplicata, 0 = fora de ordem
+    uint16_t count;        // LOG_EVENT_BATCH: itens do lote
+    uint32_t origin_addr;
+    uint32_t dest_addr;
+    uint32_t seqn;         // no lote, o primeiro ID
+    uint32_t last_seqn;    // LOG_EVENT_BATCH: último ID
+    uint32_t value;        // no lote, itens efetivados
+    uint32_t balance;      // LOG_EVENT_BATCH: saldo final da origem
+};
+
+// Registros por thread produtora antes de começar a descartar
+#define LOG_RING_SIZE 4096
+// Threads produtoras distintas (as que passarem disso têm os eventos descartados)
+#define LOG_MAX_RINGS 256
+
+struct LogRing;
+
+// Interface do servidor: imprime uma linha por operação seguida do resumo do
+// banco. As threads que atendem requisições gravam registros binários no anel
+// próprio de cada uma (SPSC, sem lock nem alocação; o conjunto dos anéis é o
+// MPSC); a thread da interface junta os anéis, ordena pelo instante e formata
+// tudo com escritas em bloco e o timestamp em texto guardado por segundo.
+// Anel cheio descarta o registro (e conta), nunca bloqueia quem produz.
 class ServerInterface {
 public:
     ServerInterface();
@@ -26,15 +56,34 @@ public:
     void start();
     void stop();
 
-    void notifyUpdate(const string& logline = "");
+    // "client A id_req N dest B value V"
+    void logRequest(uint32_t origin_addr, uint32_t seqn, uint32_t dest_addr, uint32_t value);
+    // Como logRequest, com " DUP!!" depois do cliente se for duplicata
+    void logDuplicate(uint32_t origin_addr, uint32_t seqn, uint32_t dest_addr, uint32_t value, bool duplicate);
+    // "client A batch id_req N..M applied K/C new_balance X"
+    void logBatch(uint32_t origin_addr, uint32_t first_seqn, uint32_t last_seqn, uint32_t applied, uint16_t count,
+                  uint32_t balance);
 
 private:
     thread th_;
-    mutex m_;
-    condition_variable cv_;
-    queue<string> msgs_;
     atomic<bool> running_{false};
 
+    // Anéis das threads produtoras; o mutex só é pego no registro de um anel
+    // novo, que é publicado pelo contador (o consumidor lê sem lock)
+    mutex rings_mutex_;
+    unique_ptr<LogRing> rings_[LOG_MAX_RINGS];
+    atomic<size_t> ring_count_{0};
+    atomic<uint64_t> unregistered_drops_{0};
+
+    // Thread da interface ociosa: dorme num futex sobre wake_seq_, e o produtor
+    // só faz a syscall se ela avisou que ia dormir (consumer_waiting_)
+    alignas(64) atomic<uint32_t> wake_seq_{0};
+    atomic<bool> consumer_waiting_{false};
+
+    LogRing* localRing();
+    void push(const LogRecord& record);
+    void wakeConsumer();
+    bool hasPending() const;
     void run();
 };
 
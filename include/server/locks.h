@@ -2,11 +2,41 @@
 #define LOCKS_H
 
 #include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
+#include <type_traits>
 
 using namespace std;
 
-class RWLock {
+// Dica para a CPU dentro de laços de espera ativa
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Espera ativa curta; depois de alguns giros cede a CPU (quem segura o lock
+// pode estar fora da CPU, e girando só atrasaria a sua volta)
+#define SPIN_BEFORE_YIELD 64
+static inline void spin_wait(unsigned& spins) {
+    if (++spins < SPIN_BEFORE_YIELD) cpu_relax();
+    else sched_yield();
+}
+
+// Família de locks leitor/escritor. Todos têm a mesma interface (read_lock,
+// read_unlock, write_lock, write_unlock) e servem nos guards abaixo; o RWLock
+// do servidor é escolhido na compilação (make RWLOCK=distributed|shared|condvar).
+
+// Lock original: mutex + variável de condição. Todo leitor passa pelo mesmo
+// mutex e todo unlock acorda todos os que esperam. Fica para comparação.
+class CondvarRWLock {
 private:
     pthread_mutex_t _mutex;
     pthread_cond_t _cond;
@@ -15,41 +45,190 @@ private:
     int _writers_waiting;  // número de escritores esperando
     bool _writer_active;   // se há um escritor ativo
 
+    void unlock();
+
 public:
-    RWLock();
-    ~RWLock();
+    CondvarRWLock();
+    ~CondvarRWLock();
 
     void read_lock();
+    void read_unlock() { unlock(); }
     void write_lock();
-    void unlock();
+    void write_unlock() { unlock(); }
 
     // Previne cópia
-    RWLock(const RWLock&) = delete;
-    RWLock& operator=(const RWLock&) = delete;
+    CondvarRWLock(const CondvarRWLock&) = delete;
+    CondvarRWLock& operator=(const CondvarRWLock&) = delete;
+};
+
+// std::shared_mutex (pthread_rwlock na glibc): um contador de leitores só
+class SharedMutexRWLock {
+private:
+    shared_mutex _lock;
+
+public:
+    void read_lock() { _lock.lock_shared(); }
+    void read_unlock() { _lock.unlock_shared(); }
+    void write_lock() { _lock.lock(); }
+    void write_unlock() { _lock.unlock(); }
 };
 
+// Slots de leitores do DistributedRWLock (uma linha de cache cada)
+#define DRW_LOCK_SLOTS 16
+
+// Contadores de leitores distribuídos: cada thread conta no seu slot, então
+// leitores em núcleos diferentes não disputam a mesma linha de cache (só leem
+// a flag do escritor, que fica compartilhada entre os caches). O escritor
+// levanta a flag e espera os slots zerarem; leitores que a encontram dormem
+// no futex dela. Escritores têm preferência, como no lock original.
+class DistributedRWLock {
+private:
+    struct alignas(64) Slot {
+        atomic<uint32_t> readers{0};
+    };
+
+    Slot _slots[DRW_LOCK_SLOTS];
+    // 0 = livre, 1 = escritor ativo, 2 = escritor ativo com leitores dormindo
+    alignas(64) atomic<uint32_t> _writer{0};
+    mutex _writers;  // serializa os escritores
+
+    // Slot da thread: atribuído em rodízio na primeira vez que ela lê
+    static size_t slotIndex() {
+        static atomic<size_t> next_slot{0};
+        thread_local size_t slot = next_slot.fetch_add(1, memory_order_relaxed) % DRW_LOCK_SLOTS;
+        return slot;
+    }
+
+    void readWait();
+
+public:
+    DistributedRWLock() = default;
+
+    void read_lock() {
+        Slot& slot = _slots[slotIndex()];
+        for (;;) {
+            slot.readers.fetch_add(1, memory_order_seq_cst);
+            if (_writer.load(memory_order_seq_cst) == 0) return;
+            // Escritor ativo ou esperando: sai do caminho dele e espera
+            slot.readers.fetch_sub(1, memory_order_release);
+            readWait();
+        }
+    }
+
+    void read_unlock() { _slots[slotIndex()].readers.fetch_sub(1, memory_order_release); }
+
+    void write_lock();
+    void write_unlock();
+
+    DistributedRWLock(const DistributedRWLock&) = delete;
+    DistributedRWLock& operator=(const DistributedRWLock&) = delete;
+};
+
+// Seqlock para campos lidos muito mais do que escritos: o leitor não escreve
+// nada (nem um contador) e refaz a leitura se uma escrita a cruzou. Não serve
+// para ReadGuard; a leitura é read_begin() + cópia + read_retry().
+class SeqLock {
+private:
+    atomic<uint32_t> _seq{0};  // ímpar = escrita em andamento
+
+public:
+    uint32_t read_begin() const {
+        unsigned spins = 0;
+        for (;;) {
+            uint32_t seq = _seq.load(memory_order_acquire);
+            if ((seq & 1) == 0) return seq;
+            spin_wait(spins);
+        }
+    }
+
+    // true = a leitura começada em 'seq' cruzou uma escrita e deve ser refeita
+    bool read_retry(uint32_t seq) const {
+        atomic_thread_fence(memory_order_acquire);
+        return _seq.load(memory_order_relaxed) != seq;
+    }
+
+    // Escritores se excluem entre si (girando: as escritas protegidas são curtas)
+    void write_lock() {
+        uint32_t seq = _seq.load(memory_order_relaxed);
+        unsigned spins = 0;
+        for (;;) {
+            if ((seq & 1) == 0 && _seq.compare_exchange_weak(seq, seq + 1, memory_order_acquire)) break;
+            spin_wait(spins);
+            seq = _seq.load(memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_release);
+    }
+
+    void write_unlock() { _seq.store(_seq.load(memory_order_relaxed) + 1, memory_order_release); }
+};
+
+// Valor pequeno protegido por um SeqLock. A cópia é feita palavra a palavra
+// com acessos atômicos relaxados (sem corrida de dados formal com o escritor).
+template <typename T>
+class SeqLocked {
+    static_assert(is_trivially_copyable<T>::value, "SeqLocked<T> copia T byte a byte");
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    SeqLock _lock;
+    uint32_t _words[WORDS] = {};
+
+public:
+    T load() const {
+        uint32_t copy[WORDS];
+        uint32_t seq;
+        do {
+            seq = _lock.read_begin();
+            for (size_t i = 0; i < WORDS; ++i) copy[i] = __atomic_load_n(&_words[i], __ATOMIC_RELAXED);
+        } while (_lock.read_retry(seq));
+
+        T value;
+        memcpy(&value, copy, sizeof(T));
+        return value;
+    }
+
+    void store(const T& value) {
+        uint32_t copy[WORDS] = {};
+        memcpy(copy, &value, sizeof(T));
+        _lock.write_lock();
+        for (size_t i = 0; i < WORDS; ++i) __atomic_store_n(&_words[i], copy[i], __ATOMIC_RELAXED);
+        _lock.write_unlock();
+    }
+};
+
+#if defined(PIX_RWLOCK_CONDVAR)
+typedef CondvarRWLock RWLock;
+#elif defined(PIX_RWLOCK_SHARED)
+typedef SharedMutexRWLock RWLock;
+#else
+typedef DistributedRWLock RWLock;
+#endif
+
 
 //Guard RAII para leitura (permite múltiplos leitores simultâneos)
+template <typename Lock>
 class ReadGuard {
 private:
-    RWLock& _lock;
+    Lock& _lock;
 
 public:
-    explicit ReadGuard(RWLock& lock);
-    ~ReadGuard();
+    explicit ReadGuard(Lock& lock) : _lock(lock) { _lock.read_lock(); }
+    ~ReadGuard() { _lock.read_unlock(); }
 
     ReadGuard(const ReadGuard&) = delete;
     ReadGuard& operator=(const ReadGuard&) = delete;
 };
 
 //Guard RAII para escrita (acesso exclusivo)
+template <typename Lock>
 class WriteGuard {
 private:
-    RWLock& _lock;
+    Lock& _lock;
 
 public:
-    explicit WriteGuard(RWLock& lock);
-    ~WriteGuard();
+    explicit WriteGuard(Lock& lock) : _lock(lock) { _lock.write_lock(); }
+    ~WriteGuard() { _lock.write_unlock(); }
 
     WriteGuard(const WriteGuard&) = delete;
     WriteGuard& operator=(const WriteGuard&) = delete;
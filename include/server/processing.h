@@ -15,16 +15,86 @@
 #include "common/protocol.h" 
 #include "common/utils.h"
 #include "server/replication.h"    
+#include "server/wal.h"
+#include "server/batch_io.h"
 #include <unistd.h>
 #include <stdexcept>
 #include <iostream>
 #include <string>
 #include <arpa/inet.h>
 #include <cstring> 
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <map>
+#include <vector>
+#include <atomic>
 
 class ServerProcessing {
+private:
+    // ACK de uma requisição efetivada (a resposta ao cliente). Com batch_count > 0
+    // é a resposta a um lote (PKT_BATCH_ACK), guardada pelo último ID do lote.
+    struct ReadyAck {
+        bool ready;
+        int sockfd;
+        struct sockaddr_in client_addr;
+        socklen_t clilen;
+        uint32_t balance;
+        uint32_t dest_addr;
+        uint32_t value;
+        uint16_t batch_count;
+        uint64_t batch_applied;
+    };
+
+    // Requisições efetivadas cujo ACK ainda espera replicação/disco, por cliente
+    // e em ordem de seqn. Com a janela do cliente várias ficam em voo; os ACKs
+    // saem sempre em ordem, então o ACK de N confirma também tudo antes de N.
+    // Retransmissões não são respondidas com o ACK bufferizado antes da hora.
+    mutex inflight_mutex;
+    unordered_map<uint32_t, map<uint32_t, ReadyAck>> inflight;
+
+    struct PendingTransferAck;
+
+    void startInflight(uint32_t origin_addr, uint32_t seqn);
+    bool hasInflight(uint32_t origin_addr);
+    // Marca o ACK de seqn como pronto e envia os prontos do início da fila
+    void finishInflight(uint32_t origin_addr, uint32_t seqn, const ReadyAck& ack);
+
+    // Requisição que chegou antes das anteriores (seqn > last_req + 1)
+    struct EarlyRequest {
+        Packet packet;
+        struct sockaddr_in client_addr;
+        socklen_t clilen;
+        int sockfd;
+    };
+
+    // Buffer de reordenação por cliente: até REQUEST_WINDOW_MAX chegadas
+    // adiantadas esperam a lacuna ser preenchida em vez de serem rejeitadas
+    mutex early_mutex;
+    unordered_map<uint32_t, map<uint32_t, EarlyRequest>> early_requests;
+    // Total guardado: o caminho comum (nada adiantado) não toma o lock
+    atomic<size_t> early_total{0};
+
+    bool holdEarly(uint32_t origin_addr, uint32_t last_processed_seqn, const Packet& packet,
+                   const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd);
+    bool takeEarly(uint32_t origin_addr, uint32_t seqn, EarlyRequest& out);
+
+    void processRequest(const Packet& packet, const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd);
+    // Executa, em ordem, as adiantadas que ficaram contínuas
+    void drainEarly(uint32_t origin_addr);
+
+    // Resposta ao último lote de cada cliente, para reenviar a um lote
+    // retransmitido (guardado por inflight_mutex)
+    unordered_map<uint32_t, BatchAck> last_batch_ack;
+
 public:
     void handleRequest(const Packet& packet, const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd);
+
+    // Lote de transferências do cliente (PKT_BATCH_REQUEST), na raia do cliente
+    void handleBatchRequest(const BatchRequest& batch, const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd);
+
+    // Sobrecarga: responde sem processar, com o último ACK bufferizado do cliente
+    void replyWithLastAck(const Packet& packet, const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd);
 };
 
 
@@ -5,16 +5,60 @@
 #include <string>
 #include <netinet/in.h>
 #include "common/protocol.h"
+#include "common/wire.h"
 #include "server/database.h"
 #include "server/interface.h"
 #include "common/utils.h"
+#include "server/event_loop.h"
 #include <cstring>
 #include <iostream>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
 
 using namespace std;
 
+// Entradas de transferência enviadas e ainda não confirmadas por todos os backups
+#define REPLICATION_WINDOW 1024
+// Sem ACK nesse tempo, a entrada é retransmitida para quem não confirmou
+#define REPLICATION_RTO_MS 50
+// Sem ACK de nenhum backup nesse tempo, o cliente é respondido mesmo assim
+// (mesmo limite do antigo select de 200ms)
+#define REPLICATION_ACK_TIMEOUT_MS 200
+// Retransmissões antes de tirar do fluxo um backup que não responde. Precisa
+// durar mais que REPLICATION_GAP_TIMEOUT_MS: o backup pede a sincronização
+// antes de o líder desistir dele
+#define REPLICATION_MAX_RETRIES 60
+// Quadros reenviados a partir da primeira entrada não confirmada, a cada estouro do RTO
+#define REPLICATION_RETRANSMIT_BURST 32
+// ACKs repetidos (o backup recebeu algo depois de uma lacuna) que disparam o reenvio imediato
+#define REPLICATION_DUP_ACKS 3
+// Backup: lacuna que não se fecha nesse tempo (a entrada se perdeu) não é
+// pulada: o backup pede ao líder o estado inteiro (PKT_REP_SYNC_REQ)
+#define REPLICATION_GAP_TIMEOUT_MS 2000
+static_assert(REPLICATION_MAX_RETRIES * REPLICATION_RTO_MS > REPLICATION_GAP_TIMEOUT_MS,
+              "the leader must keep retransmitting until the backup has asked for a state transfer");
+// Backup: sincronização que não chegou inteira nesse tempo é pedida de novo
+#define REPLICATION_SYNC_RETRY_MS 1000
+#define REPLICATION_TICK_MS 10
+// Buffer de recepção do socket de réplicas: cabe uma janela inteira em rajada
+#define REPLICATION_SOCKET_BUFFER (4 * 1024 * 1024)
+// Espera máxima para juntar transferências num quadro antes de enviá-lo
+// (0 = envia cada uma na hora). O quadro sai antes se encher.
+#define REPLICATION_BATCH_DELAY_US 200
+
+// Chamado quando a entrada foi confirmada por um backup (true) ou estourou o
+// prazo (false). Roda na thread do laço de eventos (ACK recebido ou tick).
+using ReplicationCallback = function<void(bool replicated)>;
+
 // Estrutura para guardar info das outras réplicas
 struct ReplicaInfo {
     int id;
@@ -22,6 +66,19 @@ struct ReplicaInfo {
     int port;
     struct sockaddr_in addr;
     bool active;
+    uint32_t acked_index;  // ACK cumulativo recebido desta réplica (época atual)
+    uint32_t base_index;   // Entrou no fluxo depois deste índice: vai nos quadros (o backup se sincroniza até ele)
+    bool syncing;          // Recebendo o estado inteiro: não conta como confirmação até o ACK do corte
+    int dup_acks;          // ACKs seguidos sem avanço
+};
+
+// Entrada do fluxo de replicação no líder
+struct ReplicationEntry {
+    ReplicationRecord record;
+    chrono::steady_clock::time_point first_sent;  // Quando entrou na janela (prazo do cliente)
+    chrono::steady_clock::time_point last_sent;
+    int retries;
+    ReplicationCallback on_done;  // vazio depois de chamado
 };
 
 class ReplicationManager {
@@ -29,31 +86,147 @@ private:
     vector<ReplicaInfo> replicas;
     int my_id;
     int sockfd;
-    bool is_leader_flag;
+    atomic<bool> is_leader_flag;
     mutable std::mutex replicas_mutex;
 
+    // === Líder: janela de transferências em trânsito ===
+    // Índices contínuos: window[i] tem o índice window_base + i.
+    // Guardado por replicas_mutex (as réplicas fazem parte do estado da janela).
+    deque<ReplicationEntry> window;
+    uint32_t window_base;
+    uint32_t next_log_index;
+    uint32_t log_epoch;
+    condition_variable window_cv;
+
+    // Entradas a partir de next_unsent_index esperam para sair num quadro
+    // (PKT_REPLICATION_BATCH): quando juntar batch_max ou vencer batch_deadline
+    uint32_t next_unsent_index;
+    size_t batch_max;
+    chrono::microseconds batch_delay;
+    chrono::steady_clock::time_point batch_deadline;
+
+    // Timers no laço de eventos (tick de retransmissão e prazo do quadro)
+    EventLoop* loop;
+    int tick_timer;
+    int batch_timer;
+
+    atomic<bool> running;
+
+    // === Backup: aplicação em ordem ===
+    mutex apply_mutex;
+    uint32_t applied_epoch;
+    uint32_t applied_index;
+    uint64_t applied_lsn;  // LSN da última entrada aplicada (o ACK espera ele ir para o disco)
+    map<uint32_t, ReplicationRecord> reorder_buffer;  // Entradas que chegaram antes da hora
+    chrono::steady_clock::time_point gap_since;
+
+    // === Backup: sincronização com o líder (o ACK não passa de applied_index) ===
+    bool syncing;
+    uint32_t sync_request_id;                   // Partes de outro pedido são ignoradas
+    chrono::steady_clock::time_point sync_requested;
+    struct sockaddr_in sync_leader_addr;
+    uint32_t sync_index;                        // Corte do estado recebido
+    uint16_t sync_parts;                        // 0 = nenhuma parte ainda
+    uint16_t sync_received;
+    vector<bool> sync_have;
+    vector<ReplicationSyncClient> sync_clients;
+    uint64_t sync_num_transactions;
+    uint64_t sync_total_transferred;
+    // last_req de cada conta no corte: entradas depois do corte que o estado já
+    // continha (efetivadas no líder antes da cópia, anexadas depois) são puladas
+    unordered_map<uint32_t, uint32_t> sync_included;
+
+    void onTick();
+    void onBatchDeadline();
+    void resendFrom_unsafe(const ReplicaInfo& r, size_t count, chrono::steady_clock::time_point now);
+    // Envia a 'r' as entradas window[first, last) em quadros de até batch_max
+    void sendFrames_unsafe(const ReplicaInfo& r, size_t first, size_t last);
+    // Envia a todas as réplicas ativas as entradas que ainda não saíram
+    void flush_unsafe(chrono::steady_clock::time_point now);
+
+    // Separam os callbacks prontos (chamados depois, fora do lock) e descartam
+    // da janela as entradas que todas as réplicas ativas já confirmaram.
+    void collectCompleted_unsafe(vector<pair<ReplicationCallback, bool>>& done);
+    void resetWindow_unsafe(vector<pair<ReplicationCallback, bool>>& done);
+
+    // Numera as entradas, põe na janela e envia (ou arma o prazo do quadro).
+    // Não espera espaço na janela. Retorna o índice da última.
+    uint32_t appendEntries_unsafe(const ReplicationRecord* records, size_t count, ReplicationCallback on_done);
+
+    // Líder: copia o estado e envia a 'r' em partes (PKT_REP_SYNC_DATA)
+    void sendSync_unsafe(const ReplicaInfo& r, uint32_t request_id, uint32_t cut_index);
+
+    // Backup: pede o estado ao líder (de novo só depois de REPLICATION_SYNC_RETRY_MS)
+    void requestSync_unsafe(chrono::steady_clock::time_point now);
+    void resetSync_unsafe();
+    // Backup: tira do buffer de reordenação e aplica o trecho contínuo após applied_index
+    void applyContiguous_unsafe(chrono::steady_clock::time_point now, vector<ReplicationRecord>& applied);
+    // Backup: loga as transferências aplicadas e confirma ao líder quando ack_lsn estiver em disco
+    void finishApply(const vector<ReplicationRecord>& applied, uint64_t ack_lsn, uint32_t ack_index,
+                     uint32_t ack_epoch, const struct sockaddr_in& leader_addr);
+
+    // Backup: bufferiza, aplica em ordem o que ficou contínuo e confirma
+    void acceptRecords(uint32_t epoch, uint32_t base_index, const ReplicationRecord* records, size_t count,
+                       const struct sockaddr_in& sender_addr);
+    bool hasActiveReplicas_unsafe() const;
+
 public:
     ReplicationManager();
+    ~ReplicationManager();
     
     // Inicializa com ID e Socket
     void init(int socket, int id, bool leader_status);
 
+    // Timers de retransmissão/prazo do fluxo de replicação, no laço de eventos.
+    // stop() só depois que o laço parou.
+    void start(EventLoop& event_loop);
+    void stop();
+
     void addReplica(int id, string ip, int port);
 
+    // Tamanho máximo do quadro (1..REPLICATION_BATCH_MAX) e espera para completá-lo
+    void setBatching(size_t max_records, uint32_t delay_us);
+
     // Getters/Setters
     bool isLeader() const { return is_leader_flag; }
-    void setLeader(bool status) { is_leader_flag = status; }
+    // Ao virar líder começa uma nova época; entradas pendentes da anterior são encerradas
+    void setLeader(bool status);
 
-    // [LÍDER] Tenta replicar para os backups e espera ACK
-    bool replicateState(const string& origin_ip, const string& dest_ip, 
-                                        uint32_t amount, uint32_t seqn,
-                                        uint32_t final_bal_orig, uint32_t final_bal_dest);
-    bool replicateNewClient(const string& client_ip);
+    // [LÍDER] Anexa a transferência ao fluxo de replicação (enviada no próximo quadro),
+    // sem esperar ACK: on_done é chamado quando um backup confirmar (ou no prazo).
+    // Bloqueia só se a janela estiver cheia. Retorna o índice da entrada (0 = sem backups).
+    uint32_t replicateState(uint32_t origin_addr, uint32_t dest_addr,
+                            uint32_t amount, uint32_t seqn,
+                            uint32_t final_bal_orig, uint32_t final_bal_dest,
+                            ReplicationCallback on_done);
+    // [LÍDER] Várias transferências numa só passagem pela janela (lote do
+    // cliente): on_done é chamado uma vez, quando a última for confirmada.
+    // Retorna o índice da última entrada (0 = sem backups).
+    uint32_t replicateStates(const ReplicationRecord* records, size_t count, ReplicationCallback on_done);
+    // [LÍDER] Anexa a criação do cliente ao fluxo de replicação, antes de qualquer
+    // transferência dele. Não bloqueia (nem com a janela cheia): on_done recebe o
+    // resultado quando um backup confirmar (ou em REPLICATION_ACK_TIMEOUT_MS).
+    // Pode ser chamado no laço de eventos.
+    void replicateNewClient(uint32_t client_addr, ReplicationCallback on_done);
 
-    bool replicateQuery(const string &client_ip, uint32_t seqn);
+    // [LÍDER] Anexa a consulta ao fluxo de replicação, na ordem das transferências
+    // do cliente (como replicateState, bloqueia só com a janela cheia): on_done
+    // recebe o resultado quando um backup confirmar (ou no prazo)
+    void replicateQuery(uint32_t client_addr, uint32_t seqn, uint32_t balance, ReplicationCallback on_done);
+
+    // [LÍDER] ACK cumulativo de um backup (entregue pelo AckDemux)
+    void handleReplicationAck(const Packet& pkt, const struct sockaddr_in& sender_addr);
 
     // [RÉPLICA] Recebe ordem do líder e aplica no DB
     void handleReplicationMessage(const Packet& pkt, const struct sockaddr_in& sender_addr);
+    // [RÉPLICA] Quadro com várias transferências, lido direto do datagrama
+    void handleReplicationBatch(const ReplicationBatchView& batch, const struct sockaddr_in& sender_addr);
+
+    // [LÍDER] Backup atrás do fluxo: fica fora da confirmação dos clientes e
+    // recebe o estado inteiro no corte atual; volta a contar com o ACK do corte
+    void handleSyncRequest(const Packet& pkt, const struct sockaddr_in& sender_addr);
+    // [RÉPLICA] Parte do estado do líder; com todas, instala, grava um snapshot e confirma o corte
+    void handleSyncData(const ReplicationSyncView& sync, const struct sockaddr_in& sender_addr);
 };
 
 extern ReplicationManager replication_manager;
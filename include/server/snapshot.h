@@ -0,0 +1,104 @@
+#ifndef SERVER_SNAPSHOT_H
+#define SERVER_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "common/protocol.h"
+
+using namespace std;
+
+#define SNAPSHOT_MAGIC   0x53584950u  // "PIXS"
+#define SNAPSHOT_VERSION 1
+// Intervalo padrão entre snapshots (0 = desligado)
+#define DEFAULT_SNAPSHOT_INTERVAL_S 60
+
+class ServerDatabase;
+class TransactionLog;
+
+// Conta gravada no snapshot (formato binário fixo, lido direto do mmap)
+struct SnapshotClient {
+    uint32_t addr;
+    uint32_t last_req;
+    uint32_t balance;
+    Packet last_ack_response;
+};
+
+// Cabeçalho de cada partição, seguido de num_clients registros SnapshotClient.
+// cut_lsn: a partição reflete exatamente os registros do log com lsn <= cut_lsn
+// que a tocam (foi copiada sob o seu lock de leitura).
+struct SnapshotShardHeader {
+    uint64_t cut_lsn;
+    uint64_t num_clients;
+    uint64_t num_transactions;
+    uint64_t total_transferred;
+};
+
+// Início do arquivo. O CRC cobre todo o conteúdo após o cabeçalho.
+struct SnapshotFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_shards;
+    uint32_t crc;
+    uint64_t start_lsn;     // Tudo até aqui está em todas as partições
+    uint64_t payload_size;
+};
+
+// O que um snapshot carregado cobre do log
+struct SnapshotInfo {
+    uint64_t start_lsn;  // Replay do log começa depois deste LSN
+    uint64_t last_lsn;   // Maior cut_lsn: o log nunca deve reutilizar LSNs até aqui
+    size_t num_clients;
+};
+
+// Snapshots periódicos do banco, para o restart não depender de reaplicar o
+// log inteiro. A cópia é "fuzzy": cada partição é copiada sob o seu próprio
+// lock de leitura (as outras seguem aceitando commits) e guarda o LSN do corte.
+// No restart, o replay pula, em cada partição, o que ela já contém.
+class SnapshotManager {
+private:
+    string _path;
+    ServerDatabase* _db;
+    TransactionLog* _log;
+    unsigned int _interval_s;
+
+    atomic<bool> _running;
+    thread _thread;
+    mutex _mutex;
+    condition_variable _cv;
+    mutex _write_mutex;  // Um snapshot por vez (periódico ou writeNow); guarda _path/_db/_log
+
+    void snapshotLoop();
+
+public:
+    SnapshotManager();
+    ~SnapshotManager();
+
+    // Grava um snapshot de 'db' (arquivo temporário + fsync + rename atômico).
+    // Espera o log estar durável até o último corte antes de publicar.
+    static bool write(const string& path, const ServerDatabase& db, TransactionLog* log);
+
+    // Carrega o snapshot (via mmap) num banco vazio. Retorna false se não há
+    // arquivo ou ele é inválido; nesse caso o banco não é alterado.
+    static bool load(const string& path, ServerDatabase& db, SnapshotInfo& info);
+
+    // Thread que grava um snapshot a cada interval_s segundos (0 = sem a thread;
+    // writeNow continua gravando em 'path')
+    void start(const string& path, ServerDatabase& db, TransactionLog& log, unsigned int interval_s);
+    void stop();
+
+    // Grava um snapshot agora, na thread atual (ex.: o backup acabou de receber
+    // o estado inteiro do líder, que não está no log). false sem log configurado
+    // ou se a gravação falhou.
+    bool writeNow();
+
+    SnapshotManager(const SnapshotManager&) = delete;
+    SnapshotManager& operator=(const SnapshotManager&) = delete;
+};
+
+extern SnapshotManager snapshot_manager;
+
+#endif // SERVER_SNAPSHOT_H
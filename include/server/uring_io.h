@@ -0,0 +1,74 @@
+#ifndef SERVER_URING_IO_H
+#define SERVER_URING_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include "common/wire.h"
+
+using namespace std;
+
+// Backend io_uring da E/S de datagramas (make IO_URING=1, define PIX_IO_URING).
+// Usa direto as chamadas do kernel (<linux/io_uring.h>), sem liburing.
+// Sem o build flag, ou se o kernel recusar o anel, tudo aqui retorna false
+// e o servidor segue com epoll + recvmmsg/sendmmsg.
+
+// Buffers do anel de recepção (cada um cabe um WireDatagram)
+#define URING_RECV_BUFFERS 256
+// Entradas do anel de envio de cada thread (o lote da caixa de saída)
+#define URING_SEND_ENTRIES 64
+
+// Compilado com PIX_IO_URING, ligado (--io-uring) e aceito pelo kernel (testado uma vez)
+bool uringAvailable();
+// Liga/desliga o backend em tempo de execução (padrão: ligado quando compilado)
+void setUringIo(bool enabled);
+
+// data: bytes do datagrama no formato de fio (ver WireView)
+using UringDatagramHandler = function<void(const uint8_t* data, size_t len,
+                                           const struct sockaddr_in& sender, socklen_t senderlen)>;
+
+struct UringRing;
+
+// Recepção multishot: um RECVMSG fica postado no socket e o kernel preenche
+// os buffers de um anel de buffers fornecidos, sem uma chamada por lote.
+// O fd do anel fica legível quando há conclusões (vai no EventLoop).
+class UringReceiver {
+private:
+    UringRing* _ring;
+    int _sockfd;
+    char* _buffers;
+    void* _buf_ring;
+    struct msghdr _msg;  // Formato das mensagens (tamanho do endereço) para o multishot
+    bool _armed;
+
+    void arm();
+    void recycle(uint16_t bid);
+
+public:
+    UringReceiver();
+    ~UringReceiver();
+
+    // false se o backend não estiver disponível (o chamador usa o caminho epoll)
+    bool open(int sockfd);
+    int ringFd() const;
+
+    // Entrega ao handler cada datagrama já concluído e repõe o multishot se preciso.
+    // Retorna quantos datagramas foram entregues.
+    size_t drain(const UringDatagramHandler& handler);
+
+    UringReceiver(const UringReceiver&) = delete;
+    UringReceiver& operator=(const UringReceiver&) = delete;
+};
+
+// Envia n datagramas com um SENDMSG cada, numa única submissão no anel de envio
+// da thread (criado na primeira vez). false = backend indisponível, nada enviado.
+bool uringSendBatch(const int* fds, const struct iovec* datagrams, const struct sockaddr_in* addrs,
+                    const socklen_t* addrlens, size_t n);
+
+// Chamadas io_uring_enter feitas pelo processo (para o benchmark)
+uint64_t uringEnterCalls();
+
+#endif // SERVER_URING_IO_H
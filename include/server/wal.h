@@ -0,0 +1,123 @@
+#ifndef SERVER_WAL_H
+#define SERVER_WAL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <sys/types.h>
+
+using namespace std;
+
+// Janela extra (opcional) em que o writer junta registros antes do fsync.
+// 0 = só o agrupamento natural: o que chega durante um fsync vai no próximo lote.
+#define WAL_DEFAULT_GROUP_COMMIT_US 0
+// Registros por lote: acima disso o fsync é feito sem esperar a janela
+#define WAL_MAX_BATCH 512
+// Falha de write/fdatasync: corta o que o lote deixou no arquivo e tenta de novo.
+// Esgotadas as tentativas, o servidor para (não dá para confirmar nada sem o log)
+#define WAL_WRITE_RETRIES 5
+#define WAL_RETRY_DELAY_MS 100
+
+class ServerDatabase;
+
+enum WalRecordType : uint8_t {
+    WAL_NEW_CLIENT = 1,  // origin_addr = novo cliente
+    WAL_TRANSFER   = 2,  // transferência efetivada, com saldos finais
+    WAL_QUERY      = 3,  // consulta de saldo: last_req e ACK bufferizado (balance_origin)
+    WAL_LAST_REQ   = 4   // só avança last_req (ex.: transferência recusada)
+};
+
+// Registro binário de tamanho fixo (40 bytes, sem padding implícito).
+// Guarda os saldos finais, então reaplicar é idempotente e não depende de
+// revalidar saldo. O CRC cobre todos os bytes após o próprio campo.
+struct WalRecord {
+    uint32_t crc;
+    uint8_t type;
+    uint8_t reserved[3];
+    uint64_t lsn;            // Log sequence number (crescente, começa em 1)
+    uint32_t origin_addr;
+    uint32_t dest_addr;
+    uint32_t req_id;
+    uint32_t amount;
+    uint32_t balance_origin;
+    uint32_t balance_dest;
+};
+
+static_assert(sizeof(WalRecord) == 40, "WalRecord must have a fixed on-disk size");
+
+// Log de escrita antecipada (write-ahead log) das operações efetivadas.
+// Os commits enfileiram registros (append) e seguem; uma thread dedicada
+// escreve em lote e faz um único fdatasync por lote. Quem precisa de
+// durabilidade (antes do ACK ao cliente) espera com waitDurable(lsn).
+class TransactionLog {
+private:
+    int _fd;
+    string _path;
+
+    mutable mutex _mutex;
+    condition_variable _work_cv;
+    condition_variable _durable_cv;
+    vector<WalRecord> _pending;
+    multimap<uint64_t, function<void()>> _durable_callbacks;  // Por LSN esperado
+
+    uint64_t _next_lsn;
+    uint64_t _durable_lsn;
+    off_t _good_offset;  // Fim do último lote inteiro em disco (só o writer mexe depois do start)
+    unsigned int _group_commit_us;
+
+    atomic<bool> _running;
+    thread _writer;
+
+    void writerLoop();
+    void runDurableCallbacks(unique_lock<mutex>& lk);
+    bool writeBatch(vector<WalRecord>& batch);
+    void writeBatchOrDie(vector<WalRecord>& batch);
+    off_t offsetOf(uint64_t lsn) const;
+
+public:
+    TransactionLog();
+    ~TransactionLog();
+
+    // Abre (ou cria) o arquivo. Não inicia a thread.
+    bool open(const string& path, unsigned int group_commit_us = WAL_DEFAULT_GROUP_COMMIT_US);
+
+    // Reaplica o log no banco, a partir do primeiro registro com lsn > after_lsn.
+    // Corta uma cauda corrompida/incompleta (queda no meio de uma escrita).
+    // Retorna o número de registros aplicados; deve ser chamado antes de start().
+    size_t replay(ServerDatabase& db, uint64_t after_lsn = 0);
+
+    // Garante que os próximos LSNs sejam > lsn (ex.: snapshot mais novo que o
+    // log, se o arquivo do log foi perdido). Chamar antes de start().
+    void reserveLsn(uint64_t lsn);
+
+    void start();
+    void stop();
+
+    bool isOpen() const { return _fd >= 0; }
+
+    // Atribui o próximo LSN e enfileira para escrita. Não bloqueia em I/O.
+    uint64_t append(WalRecord record);
+
+    // Bloqueia até o registro 'lsn' estar em disco (retorna na hora se lsn == 0)
+    void waitDurable(uint64_t lsn);
+
+    // Versão assíncrona: chama 'callback' quando 'lsn' estiver em disco (na hora,
+    // na thread atual, se já estiver; senão na thread do writer, após o fsync)
+    void whenDurable(uint64_t lsn, function<void()> callback);
+
+    uint64_t durableLsn() const;
+    uint64_t lastLsn() const;
+
+    TransactionLog(const TransactionLog&) = delete;
+    TransactionLog& operator=(const TransactionLog&) = delete;
+};
+
+extern TransactionLog transaction_log;
+
+#endif // SERVER_WAL_H
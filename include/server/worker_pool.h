@@ -0,0 +1,143 @@
+#ifndef SERVER_WORKER_POOL_H
+#define SERVER_WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <netinet/in.h>
+#include "common/protocol.h"
+
+using namespace std;
+
+// Trabalho enfileirado pela leitura dos sockets: cópia do pacote e do remetente.
+// Guardamos por valor para não alocar nada por requisição (sem std::function).
+// Só um lote (PKT_BATCH_REQUEST, que não cabe no Packet) aloca, uma vez por lote.
+struct PacketJob {
+    Packet packet;
+    struct sockaddr_in addr;
+    socklen_t addrlen;
+    int sockfd;
+    shared_ptr<const BatchRequest> batch;
+};
+
+// Fila circular limitada MPMC (vários produtores, vários consumidores).
+template <typename T>
+class BoundedQueue {
+private:
+    vector<T> _buffer;
+    size_t _head;
+    size_t _count;
+    bool _closed;
+
+    mutable mutex _mutex;
+    condition_variable _not_empty;
+
+public:
+    explicit BoundedQueue(size_t capacity)
+        : _buffer(capacity > 0 ? capacity : 1), _head(0), _count(0), _closed(false) {}
+
+    // Não bloqueia: retorna false se a fila estiver cheia ou fechada.
+    bool tryPush(const T& item) {
+        {
+            lock_guard<mutex> lk(_mutex);
+            if (_closed || _count == _buffer.size()) return false;
+            _buffer[(_head + _count) % _buffer.size()] = item;
+            _count++;
+        }
+        _not_empty.notify_one();
+        return true;
+    }
+
+    // Bloqueia até haver item; retorna false quando a fila foi fechada e esvaziada.
+    bool pop(T& out) {
+        unique_lock<mutex> lk(_mutex);
+        _not_empty.wait(lk, [&] { return _count > 0 || _closed; });
+        if (_count == 0) return false;
+        out = move(_buffer[_head]);
+        _head = (_head + 1) % _buffer.size();
+        _count--;
+        return true;
+    }
+
+    // Não bloqueia: retorna false se a fila estiver vazia.
+    bool tryPop(T& out) {
+        lock_guard<mutex> lk(_mutex);
+        if (_count == 0) return false;
+        out = move(_buffer[_head]);
+        _head = (_head + 1) % _buffer.size();
+        _count--;
+        return true;
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> lk(_mutex);
+            _closed = true;
+        }
+        _not_empty.notify_all();
+    }
+
+    size_t size() const {
+        lock_guard<mutex> lk(_mutex);
+        return _count;
+    }
+
+    size_t capacity() const { return _buffer.size(); }
+};
+
+// Política quando a fila está cheia
+enum OverloadPolicy {
+    OVERLOAD_DROP,           // Descarta o pacote (o remetente retransmite)
+    OVERLOAD_REPLY_LAST_ACK  // Responde ao cliente com o último ACK bufferizado
+};
+
+using PacketHandler = function<void(const PacketJob& job)>;
+
+// Uma "raia" de execução: fila própria consumida por uma única thread.
+// Todos os pacotes com a mesma chave caem na mesma raia e rodam em ordem.
+struct WorkerLane {
+    BoundedQueue<PacketJob> queue;
+    thread worker;
+
+    explicit WorkerLane(size_t capacity) : queue(capacity) {}
+};
+
+// Pool fixo de raias, compartilhado pelos sockets de clientes e de
+// réplicas (substitui uma thread por requisição). Os pacotes são
+// distribuídos por chave (IP de origem), então um mesmo cliente nunca
+// concorre consigo mesmo e clientes diferentes rodam em paralelo.
+class WorkerPool {
+private:
+    vector<WorkerLane*> _lanes;
+    PacketHandler _handler;
+    atomic<bool> _running;
+    atomic<uint64_t> _rejected;
+
+    void laneLoop(WorkerLane* lane);
+    size_t laneFor(uint32_t key) const;
+
+public:
+    WorkerPool();
+    ~WorkerPool();
+
+    // queue_capacity é o total, dividido igualmente entre as raias
+    void start(size_t num_lanes, size_t queue_capacity, PacketHandler handler);
+    void stop();
+
+    // Enfileira sem bloquear na raia da chave. Retorna false em sobrecarga (fila cheia).
+    bool trySubmit(uint32_t key, const PacketJob& job);
+
+    uint64_t rejectedCount() const { return _rejected; }
+    size_t laneCount() const { return _lanes.size(); }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+};
+
+extern WorkerPool worker_pool;
+
+#endif // SERVER_WORKER_POOL_H
@@ -1,5 +1,6 @@
 #include "client/discovery.h"
 #include "common/protocol.h"
+#include "common/wire.h"
 #include "common/utils.h"
 #include <ifaddrs.h>
 #include <net/if.h>
@@ -55,14 +56,14 @@ ClientDiscovery::ClientDiscovery(int port) : _port(port), _sockfd(-1) {
 void ClientDiscovery::setupSocket() {
     _sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (_sockfd < 0) {
-        log_message("ERROR opening client socket");
+        PIX_LOG_ERROR(LOG_CAT_DISCOVERY, "ERROR opening client socket");
         throw runtime_error("Failed to open socket.");
     }
     
     // Habilita a opção SO_BROADCAST no socket
     int enable = 1;
     if (setsockopt(_sockfd, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable)) < 0) {
-        log_message("ERROR setting SO_BROADCAST option");
+        PIX_LOG_ERROR(LOG_CAT_DISCOVERY, "ERROR setting SO_BROADCAST option");
         close(_sockfd);
         throw runtime_error("Failed to set SO_BROADCAST.");
     }
@@ -85,24 +86,24 @@ bool ClientDiscovery::waitForResponse(sockaddr_in& server_info, socklen_t& len)
     retval = select(_sockfd + 1, &read_fds, NULL, NULL, &tv);
 
     if (retval == -1) {
-        log_message("ERROR in select() during discovery");
+        PIX_LOG_ERROR(LOG_CAT_DISCOVERY, "ERROR in select() during discovery");
         return false;
     } else if (retval == 0) {
-        log_message("Discovery timeout. Retrying...");
+        PIX_LOG_DEBUG(LOG_CAT_DISCOVERY, "Discovery timeout. Retrying...");
         return false;
     } else {
         // Dados recebidos (sockfd está no read_fds set)
         Packet response_packet;
         
-        ssize_t n = recvfrom(_sockfd, (char*)&response_packet, sizeof(Packet), 0, 
-                             (struct sockaddr*)&server_info, &len);
+        ssize_t n = recvPacket(_sockfd, response_packet, 0,
+                               (struct sockaddr*)&server_info, &len);
         
         if (response_packet.type != PKT_DISCOVER_ACK) {
-            log_message("Received unexpected packet type during discovery. Ignoring.");
+            PIX_LOG_DEBUG(LOG_CAT_DISCOVERY, "Received unexpected packet type during discovery. Ignoring.");
             return false;
         }
         if (n < 0) {
-            log_message("ERROR on recvfrom during discovery");
+            PIX_LOG_ERROR(LOG_CAT_DISCOVERY, "ERROR on recvfrom during discovery");
             return false;
         }
         return true;
@@ -127,11 +128,11 @@ string ClientDiscovery::discoverServer() {
     for (int i = 0; i < MAX_DISCOVERY_ATTEMPTS; ++i) {
         
         // 1. Envia o pacote de Descoberta em broadcast
-        ssize_t n = sendto(_sockfd, (const char*)&discovery_packet, sizeof(Packet), 0, 
-                           (const struct sockaddr*)&_serv_addr, sizeof(_serv_addr));
+        ssize_t n = sendPacket(_sockfd, discovery_packet,
+                               (const struct sockaddr*)&_serv_addr, sizeof(_serv_addr));
         
         if (n < 0) {
-            log_message("ERROR sending discovery broadcast");
+            PIX_LOG_ERROR(LOG_CAT_DISCOVERY, "ERROR sending discovery broadcast");
             continue; // Tenta novamente
         }
         
@@ -146,7 +147,7 @@ string ClientDiscovery::discoverServer() {
     }
 
     // 3. Falha após N tentativas
-    log_message("Failed to discover server after multiple attempts.");
+    PIX_LOG_WARN(LOG_CAT_DISCOVERY, "Failed to discover server after multiple attempts.");
     if (_sockfd >= 0) {
         close(_sockfd);
     }
@@ -1,9 +1,12 @@
 #include "client/interface.h"
 #include "client/request.h"
 
+// ACKs à espera da thread de output
+#define ACK_QUEUE_CAPACITY 4096
+
 // Recebe e armazena a referência ao RequestManager
 ClientInterface::ClientInterface(ClientRequest& request_manager)
-    : request_manager_(request_manager) {}
+    : request_manager_(request_manager), acks_(ACK_QUEUE_CAPACITY) {}
 
 ClientInterface::~ClientInterface() { stop(); }
 
@@ -21,17 +24,14 @@ void ClientInterface::start() {
 void ClientInterface::stop() {
     if (!running_) return;
     running_ = false;
-    cv_.notify_all();
+    acks_.wake();
     if (in_thread_.joinable()) in_thread_.join();
     if (out_thread_.joinable()) out_thread_.join();
 }
 
 void ClientInterface::pushAck(const AckData& ack) {
-    {
-        lock_guard<mutex> lk(mutex_);
-        acks_.push(ack);
-    }
-    cv_.notify_one();
+    // Com a fila cheia, espera a thread de output (ou desiste se ela parou)
+    acks_.push(ack, running_);
 }
 
 void ClientInterface::displayDiscoverySuccess(const string& server_ip) {
@@ -53,54 +53,73 @@ void ClientInterface::inputLoop() {
         uint32_t value;
 
         if (!(iss >> dest_ip >> value)) {
-            cerr << "input invalido. Use: IP_DESTINO VALOR\n";
+            cerr << "input invalido. Use: IP_DESTINO VALOR [IP_DESTINO VALOR ...]\n";
+            continue;
+        }
+
+        // Vários pares na mesma linha: um lote de transferências
+        vector<RequestData> batch;
+        batch.push_back(RequestData{ipToUint32(dest_ip), value});
+        string more_ip;
+        while (iss >> more_ip) {
+            if (!(iss >> value)) break;
+            batch.push_back(RequestData{ipToUint32(more_ip), value});
+        }
+        if (!iss.eof()) {
+            cerr << "input invalido. Use: IP_DESTINO VALOR [IP_DESTINO VALOR ...]\n";
             continue;
         }
 
-        request_manager_.enqueueCommand(dest_ip, value);
+        if (batch.size() == 1) {
+            request_manager_.enqueueCommand(dest_ip, value);
+        } else {
+            request_manager_.enqueueBatch(batch);
+        }
+    }
+}
+
+static void printAck(const AckData& ack) {
+    // Converte endereços IP
+    char server_ip[INET_ADDRSTRLEN];
+    char dest_ip[INET_ADDRSTRLEN];
+    struct in_addr server_addr;
+
+    server_addr.s_addr = ack.server_addr;
+    
+    inet_ntop(AF_INET, &server_addr, server_ip, INET_ADDRSTRLEN);
+
+    if (ack.dest_addr != 0) {
+        struct in_addr dest_addr;
+        dest_addr.s_addr = ack.dest_addr;
+        inet_ntop(AF_INET, &dest_addr, dest_ip, INET_ADDRSTRLEN);
+    } else {
+        strcpy(dest_ip, "N/A");
     }
+
+    ostringstream oss;
+    oss << get_timestamp_str()
+        << " server " << server_ip
+        << " id_req " << ack.seqn
+        << " dest " << dest_ip
+        << " value " << ack.value
+        << " new_balance " << ack.new_balance;
+    cout << oss.str() << '\n';
 }
 
 // Thread de output fica em loop imprimindo dados da requisição assim que ack é recebido.
+// Com vários ACKs na fila, as linhas saem juntas num flush só.
 void ClientInterface::outputLoop() {
-    unique_lock<mutex> lk(mutex_);
-
+    AckData ack;
     while (running_) {
-        cv_.wait(lk, [&]{ return !running_ || !acks_.empty(); });
-        
-        while (!acks_.empty()) {
-            auto ack = acks_.front(); 
-            acks_.pop();
-
-            lk.unlock();
-
-            // Converte endereços IP
-            char server_ip[INET_ADDRSTRLEN];
-            char dest_ip[INET_ADDRSTRLEN];
-            struct in_addr server_addr;
-
-            server_addr.s_addr = ack.server_addr;
-            
-            inet_ntop(AF_INET, &server_addr, server_ip, INET_ADDRSTRLEN);
-
-            if (ack.dest_addr != 0) {
-                struct in_addr dest_addr;
-                dest_addr.s_addr = ack.dest_addr;
-                inet_ntop(AF_INET, &dest_addr, dest_ip, INET_ADDRSTRLEN);
-            } else {
-                strcpy(dest_ip, "N/A");
-            }
-
-            ostringstream oss;
-            oss << get_timestamp_str()
-                << " server " << server_ip
-                << " id_req " << ack.seqn
-                << " dest " << dest_ip
-                << " value " << ack.value
-                << " new_balance " << ack.new_balance;
-            cout << oss.str() << endl;
-
-            lk.lock();
+        if (!acks_.tryPop(ack)) {
+            cout.flush();
+            acks_.wait(-1);
+            continue;
         }
+        printAck(ack);
     }
-}
\ No newline at end of file
+
+    // Os que já estavam na fila ao parar ainda são exibidos
+    while (acks_.tryPop(ack)) printAck(ack);
+    cout.flush();
+}
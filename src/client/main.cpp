@@ -24,7 +24,7 @@ int main(int argc, char* argv[]) {
 
     // O cliente deve ser iniciado com a porta UDP como parâmetro (ex: ./cliente 4000)
     if (argc < 2) {
-        cerr << "ERRO: Uso correto: " << argv[0] << " <PORTA_UDP>" << endl;
+        cerr << "ERRO: Uso correto: " << argv[0] << " <PORTA_UDP> [--window=N] [--log=NIVEL|CATEGORIA=NIVEL,...]" << endl;
         return EXIT_FAILURE;
     }
     
@@ -36,6 +36,29 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    // Requisições em voo ao mesmo tempo (1 = espera cada ACK antes da próxima)
+    int window = 1;
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        try {
+            if (arg.rfind("--window=", 0) == 0) {
+                window = stoi(arg.substr(9));
+            } else if (arg.rfind("--log=", 0) == 0) {
+                if (!logConfigure(arg.substr(6))) throw invalid_argument(arg);
+            } else {
+                cerr << "ERRO: Opção desconhecida: " << arg << endl;
+                return EXIT_FAILURE;
+            }
+        } catch (const exception& e) {
+            cerr << "ERRO: Valor inválido em " << arg << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (window < 1 || window > REQUEST_WINDOW_MAX) {
+        cerr << "ERRO: --window deve estar entre 1 e " << REQUEST_WINDOW_MAX << endl;
+        return EXIT_FAILURE;
+    }
+
     //Iniciar a Fase de Descoberta
     ClientDiscovery client_disco(port);
     string server_ip = client_disco.discoverServer();
@@ -45,7 +68,7 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    ClientRequest request_manager(server_ip, port); 
+    ClientRequest request_manager(server_ip, port, window); 
     ClientInterface client_interface(request_manager); 
     request_manager.setInterface(&client_interface); 
     client_interface.displayDiscoverySuccess(server_ip);
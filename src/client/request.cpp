@@ -1,19 +1,29 @@
 #include "client/request.h"
 #include "client/interface.h"
 #include "common/protocol.h"
+#include "common/wire.h"
 #include "common/utils.h"
 #include "client/discovery.h"
+#include <cerrno>
 
-// Definicoes para o RRA (timeout/retry)
-#define RRA_TIMEOUT_MS 500
+// Definicoes para o RRA (timeout/retry). O prazo de cada tentativa vem do
+// RtoEstimator (client/rto.h)
 #define MAX_RETRIES 20000
-#define DISCOVERY_THRESHOLD 5
+// Busca um novo líder só depois de tanto tempo sem resposta para a requisição
+// (com o backoff, isso é o mesmo que uma sequência de tentativas perdidas)
+#define DISCOVERY_AFTER_MS 2500
+// Comandos do usuário à espera da thread de processamento
+#define COMMAND_QUEUE_CAPACITY 4096
 
 /*---Construtor e Setup ---*/
 
-ClientRequest::ClientRequest(const string &server_ip, int port)
-    : _server_ip(server_ip), _server_port(port), _sockfd(-1), _next_seqn(1), _interface(nullptr)
+ClientRequest::ClientRequest(const string &server_ip, int port, int window)
+    : _server_ip(server_ip), _server_port(port), _sockfd(-1), _next_seqn(1), _window(window),
+      _commands(COMMAND_QUEUE_CAPACITY), _interface(nullptr)
 {
+    if (_window < 1) _window = 1;
+    if (_window > REQUEST_WINDOW_MAX) _window = REQUEST_WINDOW_MAX;
+
 
     // Inicializa o endereço do servidor
     memset(&_server_addr, 0, sizeof(_server_addr));
@@ -36,7 +46,7 @@ void ClientRequest::setInterface(ClientInterface *interface)
 {
     if (!interface)
     {
-        log_message("CRITICAL ERROR: Attempted to set null interface pointer.");
+        PIX_LOG_ERROR(LOG_CAT_CLIENT, "CRITICAL ERROR: Attempted to set null interface pointer.");
         throw runtime_error("Null interface pointer.");
     }
     _interface = interface;
@@ -47,7 +57,7 @@ void ClientRequest::setupSocket()
     _sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (_sockfd < 0)
     {
-        log_message("ERROR opening request socket");
+        PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR opening request socket");
         throw runtime_error("Failed to open request socket.");
     }
     // O cliente não precisa de bind, pois a porta de origem é aleatória (efêmera)
@@ -57,129 +67,158 @@ void ClientRequest::stopProcessing()
 {
     // Sinaliza a flag de parada
     _running = false;
-    // Acorda a thread que está bloqueada em cv.wait()
-    _queue_cv.notify_all();
+    // Acorda a thread que está dormindo à espera de comandos
+    _commands.wake();
 }
 
 /*--- Sincronização (Fila Thread-Safe) ---*/
 
 void ClientRequest::enqueueCommand(const string &dest_ip, uint32_t value)
 {
+    // Esta função é chamada pela thread de input da interface; com a fila
+    // cheia ela espera a thread de processamento abrir espaço
+    _commands.push(ClientCommand{ipToUint32(dest_ip), value, {}}, _running);
+}
+
+void ClientRequest::enqueueBatch(const vector<RequestData> &items)
+{
+    // Linhas maiores que um lote viram lotes seguidos
+    for (size_t first = 0; first < items.size(); first += BATCH_REQUEST_MAX)
     {
-        // Esta função é chamada pela thread de input da interface
-        lock_guard<mutex> lk(_queue_mutex);
-        _command_queue.push({dest_ip, value});
+        size_t last = min(items.size(), first + BATCH_REQUEST_MAX);
+        if (!_commands.push(ClientCommand{0, 0, vector<RequestData>(items.begin() + first, items.begin() + last)},
+                            _running))
+            return;
     }
-    _queue_cv.notify_one(); // Notifica a thread de processamento
 }
 
 bool ClientRequest::isQueueEmpty() const {
-    // Usa lock_guard para proteger a leitura do tamanho da fila
-    lock_guard<mutex> lk(_queue_mutex);
-    return _command_queue.empty();
+    return _commands.empty();
 }
 
 /* Lógica bloqueante de envio (RRA) ---*/
 
+bool ClientRequest::rediscoverLeader()
+{
+    // Instancia a descoberta temporária usando a mesma porta configurada
+    ClientDiscovery temp_discovery(_server_port);
+    string new_leader_ip = temp_discovery.discoverServer();
+
+    if (new_leader_ip.empty()) {
+        PIX_LOG_WARN(LOG_CAT_CLIENT, "AVISO: Nenhum lider encontrado. Tentando novamente...");
+        return false;
+    }
+
+    // Nota: Pode ser o mesmo IP (se o servidor só estava lento) ou novo (se houve eleição)
+    // Converte string IP para struct in_addr e atualiza _server_addr
+    inet_pton(AF_INET, new_leader_ip.c_str(), &(_server_addr.sin_addr));
+
+    PIX_LOG_INFO(LOG_CAT_CLIENT, "Lider encontrado/confirmado em: %s", new_leader_ip.c_str());
+    return true;
+}
+
 bool ClientRequest::sendRequestWithRetry(const Packet &initial_request)
 {
+    using clock = chrono::steady_clock;
 
     Packet current_request = initial_request;
     // Variável para controlar log de "Tentando reconectar..." para não floodar o terminal
     bool trying_reconnect = false;
+    // Desde quando o líder atual não responde a esta requisição
+    auto silent_since = clock::now();
 
     for (int retry_count = 0; retry_count < MAX_RETRIES; ++retry_count)
     {
 
-        if (retry_count > 0 && (retry_count % DISCOVERY_THRESHOLD == 0))
+        if (clock::now() - silent_since >= chrono::milliseconds(DISCOVERY_AFTER_MS))
         {
             if (!trying_reconnect) {
-                log_message("AVISO: Servidor nao responde. Buscando novo Lider na rede...");
+                PIX_LOG_WARN(LOG_CAT_CLIENT, "AVISO: Servidor nao responde. Buscando novo Lider na rede...");
                 trying_reconnect = true;
             }
 
-            // Instancia a descoberta temporária usando a mesma porta configurada
-            ClientDiscovery temp_discovery(_server_port);
-            string new_leader_ip = temp_discovery.discoverServer();
-
-            if (!new_leader_ip.empty()) {
-                // Se achou alguém, atualiza o endereço de destino
-                // Nota: Pode ser o mesmo IP (se o servidor só estava lento) ou novo (se houve eleição)
-                
-                // Converte string IP para struct in_addr e atualiza _server_addr
-                inet_pton(AF_INET, new_leader_ip.c_str(), &(_server_addr.sin_addr));
-                
-                string msg = "Lider encontrado/confirmado em: " + new_leader_ip;
-                log_message(msg.c_str());
-                
+            // Se achou alguém, o endereço de destino já foi atualizado
+            if (rediscoverLeader()) {
                 trying_reconnect = false; // Reset da flag visual
-            } else {
-                 log_message("AVISO: Nenhum lider encontrado. Tentando novamente...");
             }
+            silent_since = clock::now();
         }
 
         if (retry_count > 0 && !trying_reconnect)
         {
             // Notificação da retransmissão normal
-            string msg = "Retransmitting request ID: " + to_string(current_request.seqn);
-            log_message(msg.c_str());
+            PIX_LOG_DEBUG(LOG_CAT_CLIENT, "Retransmitting request ID: %u", current_request.seqn);
         }
 
         // 1.Envio da Requisição
-        ssize_t sent_bytes = sendto(_sockfd, (const char *)&current_request, sizeof(Packet), 0,
-                                    (const struct sockaddr *)&_server_addr, sizeof(_server_addr));
+        auto sent_at = clock::now();
+        ssize_t sent_bytes = sendPacket(_sockfd, current_request,
+                                        (const struct sockaddr *)&_server_addr, sizeof(_server_addr));
 
         if (sent_bytes < 0)
         {
-            log_message("ERROR sending request.");
+            PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR sending request.");
             // Falha grave, tenta novamente
             continue;
         }
 
-        // 2.Aguardo do ACK com timeout (usando select)
-        fd_set read_fds;
-        struct timeval tv;
+        // 2.Aguardo do ACK até o prazo da tentativa (RTO com backoff). Um pacote
+        //   inesperado não conta como timeout: continua esperando o mesmo prazo
+        auto deadline = sent_at + _rto.timeout(retry_count);
 
-        FD_ZERO(&read_fds);
-        FD_SET(_sockfd, &read_fds);
+        for (;;)
+        {
+            auto now = clock::now();
+            if (now >= deadline)
+            {
+                PIX_LOG_DEBUG(LOG_CAT_CLIENT, "ACK timeout");
+                break;
+            }
+            auto wait = chrono::duration_cast<chrono::microseconds>(deadline - now);
 
-        // Timeout de 10ms
-        tv.tv_sec = 0;
-        tv.tv_usec = RRA_TIMEOUT_MS * 1000;
+            fd_set read_fds;
+            struct timeval tv;
 
-        int retval = select(_sockfd + 1, &read_fds, NULL, NULL, &tv);
+            FD_ZERO(&read_fds);
+            FD_SET(_sockfd, &read_fds);
+
+            tv.tv_sec = wait.count() / 1000000;
+            tv.tv_usec = wait.count() % 1000000;
+
+            int retval = select(_sockfd + 1, &read_fds, NULL, NULL, &tv);
+
+            if (retval == -1)
+            {
+                PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR in select() during ACK wait.");
+                break;
+            }
+            else if (retval == 0)
+            {
+                continue; // o laço confere o prazo
+            }
 
-        if (retval == -1)
-        {
-            log_message("ERROR in select() during ACK wait.");
-            continue;
-        }
-        else if (retval == 0)
-        {
-            log_message("ACK timeout");
-            continue;
-        }
-        else
-        {
             // 3.ACK recebido
             Packet ack_packet;
-            memset(&ack_packet, 0, sizeof(Packet));
             struct sockaddr_in from_addr;
             socklen_t from_len = sizeof(from_addr);
 
-            ssize_t received_bytes = recvfrom(_sockfd, (char *)&ack_packet, sizeof(Packet), 0,
-                                              (struct sockaddr *)&from_addr, &from_len);
+            // Datagrama que não decodifica volta zerado (tipo inesperado abaixo)
+            ssize_t received_bytes = recvPacket(_sockfd, ack_packet, 0,
+                                                (struct sockaddr *)&from_addr, &from_len);
 
             if (received_bytes < 0)
             {
-                log_message("ERROR on recvfrom ACK.");
+                PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR on recvfrom ACK.");
                 continue;
             }
 
             // 4.Validação do ACK
             if (ack_packet.type == PKT_REQUEST_ACK && ack_packet.seqn == current_request.seqn)
             {
-                
+                // Karn: o ACK de uma retransmissão não diz a qual envio responde
+                if (retry_count == 0)
+                    _rto.sample(chrono::duration_cast<chrono::microseconds>(clock::now() - sent_at));
+
                 // Se recebemos ACK de alguém, garantimos que esse IP é o Líder atual.
                 // Isso evita que, se o IP mudou num discover anterior, a gente perca a referência.
                 // (Opcional, mas boa prática de update)
@@ -199,48 +238,410 @@ bool ClientRequest::sendRequestWithRetry(const Packet &initial_request)
             {
                 // Cenário de ACK Duplicado/Atrasado (o cliente já esperava o próximo)
                 // O servidor geralmente lida com isso. Aqui o cliente pode ignorar ou logar.
-                log_message("Received delayed/duplicate ACK. Ignoring.");
-                continue;
+                PIX_LOG_TRACE(LOG_CAT_CLIENT, "Received delayed/duplicate ACK. Ignoring.");
             }
             else
             {
-                log_message("Received unexpected packet type or sequence number. Ignoring.");
-                continue;
+                PIX_LOG_DEBUG(LOG_CAT_CLIENT, "Received unexpected packet type or sequence number. Ignoring.");
             }
         }
     }
 
     // Falha total: estourou o número máximo de tentativas
-    log_message("Failed to receive ACK after maximum retries.");
+    PIX_LOG_WARN(LOG_CAT_CLIENT, "Failed to receive ACK after maximum retries.");
     return false;
 }
 
-/*--- Loop Principal de Processamento ---*/
-void ClientRequest::runProcessingLoop()
+/*--- Lotes ---*/
+
+// Lê uma resposta do servidor: um Packet ou um PKT_BATCH_ACK (que não cabe no
+// Packet; nesse caso packet.type = PKT_BATCH_ACK e o conteúdo vai em batch_ack).
+// Retorna -1 em erro do socket e 0 para um datagrama que não decodifica.
+static ssize_t recvReply(int sockfd, Packet &packet, BatchAck &batch_ack, int flags, struct sockaddr_in &from)
 {
-    while (_running)
+    WireDatagram buf;
+    socklen_t from_len = sizeof(from);
+    ssize_t n = recvfrom(sockfd, buf.bytes, sizeof(buf.bytes), flags, (struct sockaddr *)&from, &from_len);
+    if (n < 0)
+        return -1;
+
+    WireView view(buf.bytes, (size_t)n);
+    if (view.valid() && view.type() == PKT_BATCH_ACK)
     {
-        unique_lock<mutex> lk(_queue_mutex);
+        packet = Packet();
+        if (!decodeBatchAck(view, batch_ack))
+            return 0;
+        packet.type = PKT_BATCH_ACK;
+        packet.seqn = batch_ack.seqn;
+        return n;
+    }
+    return decodePacket(view, packet) ? n : 0;
+}
 
-        // Espera até que haja um comando na fila ou o cliente esteja parando
-        _queue_cv.wait(lk, [&]
-                       { return !_command_queue.empty() || !_running; });
+void ClientRequest::runBatchCommand(const ClientCommand &command)
+{
+    BatchRequest batch;
+    batch.seqn = _next_seqn;
+    batch.count = (uint16_t)command.batch.size();
+    batch.flags = 0;
+    copy(command.batch.begin(), command.batch.end(), batch.items);
+
+    // Como numa transferência simples, os IDs só avançam se houve resposta
+    if (sendBatchWithRetry(batch))
+        _next_seqn += batch.count;
+}
+
+bool ClientRequest::sendBatchWithRetry(const BatchRequest &batch)
+{
+    using clock = chrono::steady_clock;
+
+    uint8_t request[WIRE_MAX_DATAGRAM];
+    size_t request_len = encodeBatchRequest(batch, request, sizeof(request));
+    if (request_len == 0)
+    {
+        PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR encoding batch request.");
+        return false;
+    }
+    uint32_t last_seqn = batch.seqn + batch.count - 1;
+    auto silent_since = clock::now();
+
+    for (int retry_count = 0; retry_count < MAX_RETRIES; ++retry_count)
+    {
+        if (clock::now() - silent_since >= chrono::milliseconds(DISCOVERY_AFTER_MS))
+        {
+            PIX_LOG_WARN(LOG_CAT_CLIENT, "AVISO: Servidor nao responde. Buscando novo Lider na rede...");
+            rediscoverLeader();
+            silent_since = clock::now();
+        }
+
+        if (retry_count > 0)
+        {
+            PIX_LOG_DEBUG(LOG_CAT_CLIENT, "Retransmitting batch ID: %u", batch.seqn);
+        }
+
+        auto sent_at = clock::now();
+        if (sendto(_sockfd, request, request_len, 0, (const struct sockaddr *)&_server_addr, sizeof(_server_addr)) < 0)
+        {
+            PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR sending batch request.");
+            continue;
+        }
 
-        if (!_running)
-            break; // Sai se o cliente estiver parando
+        auto deadline = sent_at + _rto.timeout(retry_count);
+        for (;;)
+        {
+            auto now = clock::now();
+            if (now >= deadline)
+            {
+                PIX_LOG_DEBUG(LOG_CAT_CLIENT, "ACK timeout");
+                break;
+            }
+            auto wait = chrono::duration_cast<chrono::microseconds>(deadline - now);
 
-        // Pega o próximo comando da fila (IP_DESTINO, VALOR)
-        auto [dest_ip, value] = _command_queue.front();
-        _command_queue.pop();
-        lk.unlock();
+            fd_set read_fds;
+            FD_ZERO(&read_fds);
+            FD_SET(_sockfd, &read_fds);
+            struct timeval tv;
+            tv.tv_sec = wait.count() / 1000000;
+            tv.tv_usec = wait.count() % 1000000;
 
+            int retval = select(_sockfd + 1, &read_fds, NULL, NULL, &tv);
+            if (retval == -1)
+            {
+                PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR in select() during ACK wait.");
+                break;
+            }
+            if (retval == 0)
+                continue;
+
+            Packet reply;
+            BatchAck batch_ack;
+            struct sockaddr_in from_addr;
+            if (recvReply(_sockfd, reply, batch_ack, 0, from_addr) <= 0)
+                continue;
+
+            bool done = false;
+            uint64_t applied = ~0ull;
+            uint32_t new_balance = 0;
+            if (reply.type == PKT_BATCH_ACK && batch_ack.seqn == batch.seqn && batch_ack.count == batch.count)
+            {
+                done = true;
+                applied = batch_ack.applied;
+                new_balance = batch_ack.new_balance;
+            }
+            else if (reply.type == PKT_REQUEST_ACK && reply.seqn >= last_seqn)
+            {
+                // ACK cumulativo (ex.: o novo líder não tem a resposta do lote):
+                // o lote foi processado, mas o resultado por item se perdeu
+                done = true;
+                new_balance = reply.ack.new_balance;
+            }
+
+            if (!done)
+            {
+                PIX_LOG_DEBUG(LOG_CAT_CLIENT, "Received unexpected packet type or sequence number. Ignoring.");
+                continue;
+            }
+
+            if (retry_count == 0)
+                _rto.sample(chrono::duration_cast<chrono::microseconds>(clock::now() - sent_at));
+            _server_addr.sin_addr = from_addr.sin_addr;
+
+            // Um ACK por item, em ordem; item recusado aparece com valor 0
+            for (size_t i = 0; i < batch.count; ++i)
+            {
+                AckData ack_data;
+                ack_data.seqn = batch.seqn + (uint32_t)i;
+                ack_data.new_balance = new_balance;
+                ack_data.value = (applied >> i) & 1 ? batch.items[i].value : 0;
+                ack_data.dest_addr = batch.items[i].dest_addr;
+                ack_data.server_addr = _server_addr.sin_addr.s_addr;
+                _interface->pushAck(ack_data);
+            }
+            return true;
+        }
+    }
+
+    PIX_LOG_WARN(LOG_CAT_CLIENT, "Failed to receive ACK after maximum retries.");
+    return false;
+}
+
+/*--- Modo janela (pipelining) ---*/
+
+void ClientRequest::receiveWindowAcks(deque<InflightRequest> &window)
+{
+    // Lê tudo o que já chegou, sem bloquear
+    for (;;)
+    {
+        Packet ack_packet;
+        struct sockaddr_in from_addr;
+        socklen_t from_len = sizeof(from_addr);
+
+        ssize_t received_bytes = recvPacket(_sockfd, ack_packet, MSG_DONTWAIT,
+                                            (struct sockaddr *)&from_addr, &from_len);
+        if (received_bytes < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR on recvfrom ACK.");
+            return;
+        }
+
+        if (ack_packet.type != PKT_REQUEST_ACK)
+        {
+            PIX_LOG_DEBUG(LOG_CAT_CLIENT, "Received unexpected packet type or sequence number. Ignoring.");
+            continue;
+        }
+
+        if (window.empty() || ack_packet.seqn < window.front().packet.seqn)
+        {
+            PIX_LOG_TRACE(LOG_CAT_CLIENT, "Received delayed/duplicate ACK. Ignoring.");
+            continue;
+        }
+
+        _server_addr.sin_addr = from_addr.sin_addr;
+
+        // Karn: amostra só do ACK da própria requisição, se nunca retransmitida
+        for (const auto &entry : window)
+        {
+            if (entry.packet.seqn != ack_packet.seqn)
+                continue;
+            if (!entry.acked && entry.retries == 0)
+                _rto.sample(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - entry.sent_at));
+            break;
+        }
+
+        // O servidor envia os ACKs de um cliente em ordem, então o de N confirma
+        // tudo até N. Uma requisição cujo próprio ACK se perdeu fica com o saldo
+        // informado no ACK que a cobriu.
+        for (auto &entry : window)
+        {
+            if (entry.packet.seqn > ack_packet.seqn)
+                break;
+            if (!entry.acked)
+            {
+                entry.acked = true;
+                entry.new_balance = ack_packet.ack.new_balance;
+            }
+        }
+    }
+}
+
+void ClientRequest::runWindowedLoop()
+{
+    using clock = chrono::steady_clock;
+
+    // Em ordem de seqn; a frente é a mais antiga ainda sem ACK entregue
+    deque<InflightRequest> window;
+
+    // Próximo comando já tirado da fila (a fila não deixa espiar a frente)
+    ClientCommand next;
+    bool has_next = false;
+
+    // Ao parar, termina as que já estão em voo (como o modo de uma por vez)
+    while (_running || !window.empty())
+    {
+        // 1. Completa a janela com comandos da fila
+        size_t first_new = window.size();
+        if (window.empty())
+        {
+            if (!has_next && !(has_next = _commands.tryPop(next)))
+            {
+                _commands.wait(-1);
+                continue;
+            }
+            if (!_running)
+                break;
+
+            // Um lote é uma barreira: sai sozinho, com a janela vazia
+            if (!next.batch.empty())
+            {
+                has_next = false;
+                runBatchCommand(next);
+                continue;
+            }
+        }
+
+        while (_running && (int)window.size() < _window && (has_next || (has_next = _commands.tryPop(next))) &&
+               next.batch.empty())
+        {
+            has_next = false;
+
+            InflightRequest entry{};
+            entry.packet.type = PKT_REQUEST;
+            entry.packet.seqn = _next_seqn++;
+            entry.packet.req.dest_addr = next.dest_addr;
+            entry.packet.req.value = next.value;
+            window.push_back(entry);
+        }
+
+        for (size_t i = first_new; i < window.size(); ++i)
+        {
+            window[i].sent_at = clock::now();
+            window[i].silent_since = window[i].sent_at;
+            window[i].deadline = window[i].sent_at + _rto.timeout(0);
+            if (sendPacket(_sockfd, window[i].packet, (const struct sockaddr *)&_server_addr, sizeof(_server_addr)) < 0)
+                PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR sending request.");
+        }
+
+        // 2. Espera ACKs até o primeiro prazo de retransmissão ou, se ainda
+        //    cabe requisição nova na janela, até chegar um comando
+        auto deadline = clock::time_point::max();
+        for (const auto &entry : window)
+        {
+            if (!entry.acked && entry.deadline < deadline)
+                deadline = entry.deadline;
+        }
+        auto now = clock::now();
+        auto wait = deadline > now ? chrono::duration_cast<chrono::microseconds>(deadline - now) : chrono::microseconds(0);
+        bool wait_commands = _running && (int)window.size() < _window && !has_next;
+        if (wait_commands && !_commands.prepareWait())
+            wait = chrono::microseconds(0);
+
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(_sockfd, &read_fds);
+        int max_fd = _sockfd;
+        if (wait_commands)
+        {
+            FD_SET(_commands.eventFd(), &read_fds);
+            max_fd = max(max_fd, _commands.eventFd());
+        }
+        struct timeval tv;
+        tv.tv_sec = wait.count() / 1000000;
+        tv.tv_usec = wait.count() % 1000000;
+
+        int retval = select(max_fd + 1, &read_fds, NULL, NULL, (deadline == clock::time_point::max()) ? NULL : &tv);
+        if (wait_commands)
+            _commands.finishWait();
+        if (retval == -1)
+            PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR in select() during ACK wait.");
+        else if (retval > 0 && FD_ISSET(_sockfd, &read_fds))
+            receiveWindowAcks(window);
+
+        // 3. Entrega à interface em ordem de seqn
+        while (!window.empty() && window.front().acked)
+        {
+            const InflightRequest &done = window.front();
+            AckData ack_data;
+            ack_data.seqn = done.packet.seqn;
+            ack_data.new_balance = done.new_balance;
+            ack_data.value = done.packet.req.value;
+            ack_data.dest_addr = done.packet.req.dest_addr;
+            ack_data.server_addr = _server_addr.sin_addr.s_addr;
+            _interface->pushAck(ack_data);
+            window.pop_front();
+        }
+
+        // 4. Reenvia as que estouraram o prazo
+        now = clock::now();
+        bool rediscovered = false;
+        for (auto &entry : window)
+        {
+            if (entry.acked || now < entry.deadline)
+                continue;
+
+            if (entry.retries + 1 >= MAX_RETRIES)
+            {
+                // Falha total: o cliente volta a usar o ID da mais antiga no próximo comando
+                PIX_LOG_WARN(LOG_CAT_CLIENT, "Failed to receive ACK after maximum retries.");
+                _next_seqn = window.front().packet.seqn;
+                window.clear();
+                break;
+            }
+
+            // Sem resposta há várias tentativas: o líder pode ter mudado
+            if (now - entry.silent_since >= chrono::milliseconds(DISCOVERY_AFTER_MS))
+            {
+                if (!rediscovered)
+                {
+                    PIX_LOG_WARN(LOG_CAT_CLIENT, "AVISO: Servidor nao responde. Buscando novo Lider na rede...");
+                    rediscoverLeader();
+                    rediscovered = true;
+                }
+                entry.silent_since = clock::now();
+            }
+
+            entry.retries++;
+            PIX_LOG_DEBUG(LOG_CAT_CLIENT, "Retransmitting request ID: %u", entry.packet.seqn);
+
+            entry.sent_at = clock::now();
+            entry.deadline = entry.sent_at + _rto.timeout(entry.retries);
+            if (sendPacket(_sockfd, entry.packet, (const struct sockaddr *)&_server_addr, sizeof(_server_addr)) < 0)
+                PIX_LOG_ERROR(LOG_CAT_CLIENT, "ERROR sending request.");
+        }
+    }
+}
+
+/*--- Loop Principal de Processamento ---*/
+void ClientRequest::runProcessingLoop()
+{
+    if (_window > 1)
+    {
+        runWindowedLoop();
+        return;
+    }
+
+    while (_running)
+    {
+        // Pega o próximo comando da fila (IP_DESTINO, VALOR); sem nenhum, dorme
+        // até chegar um ou o cliente estar parando
+        ClientCommand command;
+        if (!_commands.tryPop(command))
+        {
+            _commands.wait(-1);
+            continue;
+        }
+
+        if (!command.batch.empty())
+        {
+            runBatchCommand(command);
+            continue;
+        }
         // 1.Prepara o pacote de Requisição com o próximo ID sequencial
         Packet request_packet;
-        memset(&request_packet, 0, sizeof(Packet));
         request_packet.type = PKT_REQUEST;
         request_packet.seqn = _next_seqn;
-        request_packet.req.dest_addr = ipToUint32(dest_ip);
-        request_packet.req.value = value;
+        request_packet.req.dest_addr = command.dest_addr;
+        request_packet.req.value = command.value;
 
         // 2. Chama a lógica bloqueante de envio e reenvio
         bool success = sendRequestWithRetry(request_packet);
@@ -0,0 +1,39 @@
+#include "client/rto.h"
+#include <algorithm>
+
+using namespace std;
+using namespace chrono;
+
+RtoEstimator::RtoEstimator()
+    : _srtt_us(0), _rttvar_us(0), _rto_us((int64_t)RTO_INITIAL_MS * 1000), _has_sample(false),
+      _rng(random_device{}()) {}
+
+void RtoEstimator::sample(microseconds rtt) {
+    int64_t r = max<int64_t>(rtt.count(), 1);
+
+    if (!_has_sample) {
+        // Primeira amostra: SRTT = R, RTTVAR = R/2
+        _srtt_us = r;
+        _rttvar_us = r / 2;
+        _has_sample = true;
+    } else {
+        int64_t err = _srtt_us > r ? _srtt_us - r : r - _srtt_us;
+        _rttvar_us = (3 * _rttvar_us + err) / 4;
+        _srtt_us = (7 * _srtt_us + r) / 8;
+    }
+
+    _rto_us = _srtt_us + max<int64_t>(RTO_CLOCK_GRANULARITY_US, 4 * _rttvar_us);
+    _rto_us = clamp<int64_t>(_rto_us, RTO_MIN_US, (int64_t)RTO_MAX_MS * 1000);
+}
+
+microseconds RtoEstimator::timeout(int attempt) {
+    const int64_t max_us = (int64_t)RTO_MAX_MS * 1000;
+
+    int64_t t = _rto_us;
+    for (int i = 0; i < attempt && t < max_us; ++i) t *= 2;
+    t = min(t, max_us);
+
+    uniform_int_distribution<int64_t> jitter(-t / 5, t / 5);
+    t += jitter(_rng);
+    return microseconds(max<int64_t>(t, RTO_MIN_US));
+}
@@ -0,0 +1,87 @@
+#include "common/log.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// Tamanho máximo de uma linha de log (o excesso é cortado)
+#define LOG_LINE_MAX 1024
+
+atomic<uint8_t> log_category_levels[LOG_CAT_COUNT] = {
+    {LOG_LEVEL_INFO}, {LOG_LEVEL_INFO}, {LOG_LEVEL_INFO}, {LOG_LEVEL_INFO},
+    {LOG_LEVEL_INFO}, {LOG_LEVEL_INFO}, {LOG_LEVEL_INFO}, {LOG_LEVEL_INFO},
+};
+static_assert(LOG_CAT_COUNT == 8, "initialize log_category_levels for every category");
+
+static const char* const CATEGORY_NAMES[LOG_CAT_COUNT] = {
+    "general", "net", "storage", "election", "replication", "processing", "discovery", "client",
+};
+
+static const char* const LEVEL_NAMES[] = {"off", "error", "warn", "info", "debug", "trace"};
+
+void logWrite(const char* fmt, ...) {
+    char line[LOG_LINE_MAX];
+
+    time_t now = time(nullptr);
+    struct tm tm {};
+    localtime_r(&now, &tm);
+    size_t len = strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S ", &tm);
+
+    va_list args;
+    va_start(args, fmt);
+    int written = vsnprintf(line + len, sizeof(line) - len - 1, fmt, args);
+    va_end(args);
+
+    if (written < 0) written = 0;
+    len += ((size_t)written < sizeof(line) - len - 1) ? (size_t)written : sizeof(line) - len - 2;
+    line[len++] = '\n';
+
+    // Uma escrita só: linhas de threads diferentes não se misturam
+    fwrite(line, 1, len, stdout);
+    fflush(stdout);
+}
+
+void logSetLevel(LogCategory category, LogLevel level) {
+    log_category_levels[category].store(level, memory_order_relaxed);
+}
+
+static bool parseLevel(const string& name, LogLevel& level) {
+    for (size_t i = 0; i < sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]); ++i) {
+        if (name == LEVEL_NAMES[i]) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool logConfigure(const string& spec) {
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t comma = spec.find(',', start);
+        if (comma == string::npos) comma = spec.size();
+        string item = spec.substr(start, comma - start);
+        start = comma + 1;
+
+        size_t eq = item.find('=');
+        string category = (eq == string::npos) ? "all" : item.substr(0, eq);
+        LogLevel level;
+        if (!parseLevel((eq == string::npos) ? item : item.substr(eq + 1), level)) return false;
+
+        if (category == "all") {
+            for (int i = 0; i < LOG_CAT_COUNT; ++i) logSetLevel(static_cast<LogCategory>(i), level);
+            continue;
+        }
+
+        bool found = false;
+        for (int i = 0; i < LOG_CAT_COUNT; ++i) {
+            if (category == CATEGORY_NAMES[i]) {
+                logSetLevel(static_cast<LogCategory>(i), level);
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+    return true;
+}
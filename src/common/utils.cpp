@@ -1,6 +1,6 @@
 #include "common/utils.h"
 
-/* Funções utilitárias (timestamp, formatação de logs) */
+/* Funções utilitárias (timestamp, endereços, CRC) */
 
 string get_timestamp_str() {
     using namespace chrono;
@@ -14,20 +14,11 @@ string get_timestamp_str() {
     return buf;
 }
 
-void log_message(const char *msg) {
-    //cout << get_timestamp_str() << " " << msg << endl;
-    return;
-}
-void log_message_core(const char *msg) {
-    cout << get_timestamp_str() << " " << msg << endl;
-    return;
-}
-
 uint32_t ipToUint32(const std::string& ip_str) {
     struct in_addr addr;
     
     if (inet_pton(AF_INET, ip_str.c_str(), &addr) != 1) {
-        log_message("ERROR: Invalid IP format in ipToUint32.");
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR: Invalid IP format in ipToUint32.");
         return 0;
     }
     
@@ -49,7 +40,7 @@ int getIdFromIP(const string& ip_str) {
     struct in_addr addr;
     
     if (inet_pton(AF_INET, ip_str.c_str(), &addr) != 1) {
-        log_message("ERROR: Invalid IP format in getIdFromIP.");
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR: Invalid IP format in getIdFromIP.");
         return -1;
     }
     
@@ -64,7 +55,7 @@ int getIdFromIP(const string& ip_str) {
 string getMyIP() {
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock < 0) {
-        log_message("ERROR: Failed to create socket in getMyIP.");
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR: Failed to create socket in getMyIP.");
         return "";
     }
     
@@ -77,7 +68,7 @@ string getMyIP() {
     
     if (connect(sock, (const struct sockaddr*)&serv, sizeof(serv)) < 0) {
         close(sock);
-        log_message("ERROR: Failed to connect in getMyIP.");
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR: Failed to connect in getMyIP.");
         return "";
     }
     
@@ -85,7 +76,7 @@ string getMyIP() {
     socklen_t namelen = sizeof(name);
     if (getsockname(sock, (struct sockaddr*)&name, &namelen) < 0) {
         close(sock);
-        log_message("ERROR: Failed to get socket name in getMyIP.");
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR: Failed to get socket name in getMyIP.");
         return "";
     }
     
@@ -94,4 +85,28 @@ string getMyIP() {
     
     close(sock);
     return string(buffer);
-}
\ No newline at end of file
+}
+
+// Tabela do CRC32, montada na primeira chamada
+static const uint32_t* crc32Table() {
+    static uint32_t table[256];
+    static bool ready = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+uint32_t crc32(const void* data, size_t len, uint32_t crc) {
+    const uint32_t* table = crc32Table();
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    uint32_t c = crc ^ 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i) c = table[(c ^ bytes[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,468 @@
+#include "common/wire.h"
+#include "common/utils.h"
+
+/* === Escrita === */
+
+WireWriter::WireWriter(void* buf, size_t cap, uint8_t type)
+    : _buf((uint8_t*)buf), _cap(cap), _pos(WIRE_HEADER_SIZE), _overflow(cap < WIRE_HEADER_SIZE) {
+    if (!_overflow) {
+        _buf[0] = WIRE_VERSION;
+        _buf[1] = type;
+    }
+}
+
+uint8_t* WireWriter::reserve(size_t n) {
+    if (_overflow || _pos + n > _cap) {
+        _overflow = true;
+        return nullptr;
+    }
+    uint8_t* p = _buf + _pos;
+    _pos += n;
+    return p;
+}
+
+void WireWriter::u8(uint8_t v) {
+    uint8_t* p = reserve(1);
+    if (p) p[0] = v;
+}
+
+void WireWriter::u16(uint16_t v) {
+    uint8_t* p = reserve(2);
+    if (!p) return;
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+void WireWriter::u32(uint32_t v) {
+    uint8_t* p = reserve(4);
+    if (!p) return;
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+void WireWriter::addr(uint32_t v) {
+    uint8_t* p = reserve(4);
+    if (p) memcpy(p, &v, 4);
+}
+
+size_t WireWriter::finish() {
+    size_t payload = _pos - WIRE_HEADER_SIZE;
+    if (_overflow || payload > 0xFFFF) return 0;
+
+    _buf[2] = (uint8_t)(payload >> 8);
+    _buf[3] = (uint8_t)payload;
+    return _pos;
+}
+
+/* === Leitura === */
+
+uint8_t WireReader::u8() {
+    if (_pos + 1 > _len) {
+        _pos = _len;
+        _short = true;
+        return 0;
+    }
+    return _p[_pos++];
+}
+
+uint16_t WireReader::u16() {
+    if (_pos + 2 > _len) {
+        _pos = _len;
+        _short = true;
+        return 0;
+    }
+    uint16_t v = (uint16_t)((_p[_pos] << 8) | _p[_pos + 1]);
+    _pos += 2;
+    return v;
+}
+
+uint32_t WireReader::u32() {
+    if (_pos + 4 > _len) {
+        _pos = _len;
+        _short = true;
+        return 0;
+    }
+    uint32_t v = ((uint32_t)_p[_pos] << 24) | ((uint32_t)_p[_pos + 1] << 16) | ((uint32_t)_p[_pos + 2] << 8) |
+                 (uint32_t)_p[_pos + 3];
+    _pos += 4;
+    return v;
+}
+
+uint32_t WireReader::addr() {
+    if (_pos + 4 > _len) {
+        _pos = _len;
+        _short = true;
+        return 0;
+    }
+    uint32_t v;
+    memcpy(&v, _p + _pos, 4);
+    _pos += 4;
+    return v;
+}
+
+WireView::WireView(const void* data, size_t len) : _data((const uint8_t*)data), _len(len), _valid(false) {
+    _valid = len >= WIRE_HEADER_SIZE && _data[0] >= WIRE_MIN_VERSION && _data[0] <= WIRE_VERSION &&
+             WIRE_HEADER_SIZE + payloadLength() == len;
+}
+
+ReplicationBatchView::ReplicationBatchView(const WireView& view)
+    : _view(view), _epoch(0), _count(0), _base_index(0), _valid(false) {
+    if (!view.valid() || view.type() != PKT_REPLICATION_BATCH) return;
+
+    WireReader reader = view.reader();
+    if (reader.remaining() < WIRE_BATCH_HEADER_SIZE) return;
+    _epoch = reader.u32();
+    _count = reader.u16();
+    _valid = _count <= REPLICATION_BATCH_MAX && reader.remaining() >= (size_t)_count * WIRE_RECORD_SIZE;
+    if (!_valid) return;
+
+    // Campo depois dos registros (vale 0 se o quadro não o tiver)
+    size_t records_end = WIRE_BATCH_HEADER_SIZE + (size_t)_count * WIRE_RECORD_SIZE;
+    WireReader trailer(view.payload() + records_end, view.payloadLength() - records_end);
+    _base_index = trailer.u32();
+}
+
+static ReplicationRecord decodeRecord(WireReader& reader) {
+    ReplicationRecord record;
+    record.log_index = reader.u32();
+    record.seqn = reader.u32();
+    record.origin_addr = reader.addr();
+    record.dest_addr = reader.addr();
+    record.value = reader.u32();
+    record.final_balance_origin = reader.u32();
+    record.final_balance_dest = reader.u32();
+    return record;
+}
+
+ReplicationRecord ReplicationBatchView::record(size_t i) const {
+    size_t offset = WIRE_BATCH_HEADER_SIZE + i * WIRE_RECORD_SIZE;
+    WireReader reader(_view.payload() + offset, WIRE_RECORD_SIZE);
+    return decodeRecord(reader);
+}
+
+void encodeRecord(WireWriter& writer, const ReplicationRecord& record) {
+    writer.u32(record.log_index);
+    writer.u32(record.seqn);
+    writer.addr(record.origin_addr);
+    writer.addr(record.dest_addr);
+    writer.u32(record.value);
+    writer.u32(record.final_balance_origin);
+    writer.u32(record.final_balance_dest);
+}
+
+ReplicationSyncView::ReplicationSyncView(const WireView& view)
+    : _view(view), _epoch(0), _request_id(0), _sync_index(0), _part(0), _parts(0), _num_transactions(0),
+      _total_transferred(0), _count(0), _valid(false) {
+    if (!view.valid() || view.type() != PKT_REP_SYNC_DATA) return;
+
+    WireReader reader = view.reader();
+    if (reader.remaining() < WIRE_SYNC_HEADER_SIZE) return;
+    _epoch = reader.u32();
+    _request_id = reader.u32();
+    _sync_index = reader.u32();
+    _part = reader.u16();
+    _parts = reader.u16();
+    _num_transactions = (uint64_t)reader.u32() << 32;
+    _num_transactions |= reader.u32();
+    _total_transferred = (uint64_t)reader.u32() << 32;
+    _total_transferred |= reader.u32();
+    _count = reader.u16();
+    _valid = _part < _parts && _count <= REPLICATION_SYNC_CHUNK &&
+             reader.remaining() >= (size_t)_count * WIRE_SYNC_CLIENT_SIZE;
+}
+
+ReplicationSyncClient ReplicationSyncView::client(size_t i) const {
+    size_t offset = WIRE_SYNC_HEADER_SIZE + i * WIRE_SYNC_CLIENT_SIZE;
+    WireReader reader(_view.payload() + offset, WIRE_SYNC_CLIENT_SIZE);
+
+    ReplicationSyncClient client;
+    client.addr = reader.addr();
+    client.last_req = reader.u32();
+    client.balance = reader.u32();
+    client.ack_seqn = reader.u32();
+    client.ack_balance = reader.u32();
+    client.ack_dest_addr = reader.addr();
+    client.ack_value = reader.u32();
+    return client;
+}
+
+void encodeSyncClient(WireWriter& writer, const ReplicationSyncClient& client) {
+    writer.addr(client.addr);
+    writer.u32(client.last_req);
+    writer.u32(client.balance);
+    writer.u32(client.ack_seqn);
+    writer.u32(client.ack_balance);
+    writer.addr(client.ack_dest_addr);
+    writer.u32(client.ack_value);
+}
+
+/* === Packet === */
+
+// Carga de cada tipo, na ordem do fio. Campo novo numa versão futura vai no fim.
+size_t encodePacket(const Packet& packet, void* buf, size_t cap) {
+    WireWriter w(buf, cap, (uint8_t)packet.type);
+
+    switch (packet.type) {
+        case PKT_DISCOVER:
+        case PKT_DISCOVER_ACK:
+            break;
+
+        case PKT_REQUEST:
+            w.u32(packet.seqn);
+            w.addr(packet.req.dest_addr);
+            w.u32(packet.req.value);
+            break;
+
+        case PKT_REQUEST_ACK:
+            w.u32(packet.seqn);
+            w.u32(packet.ack.new_balance);
+            w.addr(packet.ack.dest_addr);
+            w.u32(packet.ack.value);
+            break;
+
+        case PKT_REPLICATION_REQ:
+            w.u32(packet.seqn);
+            w.u32(packet.rep.log_index);
+            w.u32(packet.rep.log_epoch);
+            w.addr(packet.rep.origin_addr);
+            w.addr(packet.rep.dest_addr);
+            w.u32(packet.rep.value);
+            w.u32(packet.rep.final_balance_origin);
+            w.u32(packet.rep.final_balance_dest);
+            break;
+
+        case PKT_REPLICATION_ACK:
+            w.u32(packet.rep.log_index);
+            w.u32(packet.rep.log_epoch);
+            break;
+
+        // seqn identifica o pedido; log_index é o que o backup já aplicou
+        case PKT_REP_SYNC_REQ:
+            w.u32(packet.seqn);
+            w.u32(packet.rep.log_index);
+            w.u32(packet.rep.log_epoch);
+            break;
+
+        case PKT_REP_CLIENT_REQ:
+        case PKT_REP_CLIENT_ACK:
+        case PKT_REP_QUERY_REQ:
+        case PKT_REP_QUERY_ACK:
+            w.u32(packet.seqn);
+            w.addr(packet.rep.origin_addr);
+            break;
+
+        // ElectionData, ElectionOkData e CoordinatorData têm o mesmo formato
+        case PKT_ELECTION:
+            w.u32(packet.election.candidate_id);
+            w.addr(packet.election.candidate_addr);
+            w.u16(packet.election.candidate_port);
+            break;
+        case PKT_ELECTION_OK:
+            w.u32(packet.election_ok.responder_id);
+            w.addr(packet.election_ok.responder_addr);
+            w.u16(packet.election_ok.responder_port);
+            break;
+        case PKT_COORDINATOR:
+            w.u32(packet.coordinator.coordinator_id);
+            w.addr(packet.coordinator.coordinator_addr);
+            w.u16(packet.coordinator.coordinator_port);
+            break;
+
+        case PKT_HEARTBEAT:
+        case PKT_HEARTBEAT_ACK:
+            w.u32(packet.heartbeat.sender_id);
+            w.addr(packet.heartbeat.sender_addr);
+            w.u16(packet.heartbeat.sender_port);
+            w.u8(packet.heartbeat.is_primary);
+            break;
+
+        case PKT_SERVER_DISCOVER:
+        case PKT_SERVER_DISCOVER_ACK:
+            w.u32((uint32_t)packet.server_discovery.id);
+            w.u32((uint32_t)packet.server_discovery.replica_port);
+            break;
+
+        default:
+            return 0;
+    }
+    return w.finish();
+}
+
+bool decodePacket(const WireView& view, Packet& packet) {
+    packet = Packet();
+    if (!view.valid()) return false;
+
+    WireReader r = view.reader();
+    packet.type = view.type();
+
+    switch (packet.type) {
+        case PKT_DISCOVER:
+        case PKT_DISCOVER_ACK:
+            break;
+
+        case PKT_REQUEST:
+            packet.seqn = r.u32();
+            packet.req.dest_addr = r.addr();
+            packet.req.value = r.u32();
+            break;
+
+        case PKT_REQUEST_ACK:
+            packet.seqn = r.u32();
+            packet.ack.new_balance = r.u32();
+            packet.ack.dest_addr = r.addr();
+            packet.ack.value = r.u32();
+            break;
+
+        case PKT_REPLICATION_REQ:
+            packet.seqn = r.u32();
+            packet.rep.log_index = r.u32();
+            packet.rep.log_epoch = r.u32();
+            packet.rep.origin_addr = r.addr();
+            packet.rep.dest_addr = r.addr();
+            packet.rep.value = r.u32();
+            packet.rep.final_balance_origin = r.u32();
+            packet.rep.final_balance_dest = r.u32();
+            break;
+
+        case PKT_REPLICATION_ACK:
+            packet.rep.log_index = r.u32();
+            packet.rep.log_epoch = r.u32();
+            break;
+
+        case PKT_REP_SYNC_REQ:
+            packet.seqn = r.u32();
+            packet.rep.log_index = r.u32();
+            packet.rep.log_epoch = r.u32();
+            break;
+
+        case PKT_REP_CLIENT_REQ:
+        case PKT_REP_CLIENT_ACK:
+        case PKT_REP_QUERY_REQ:
+        case PKT_REP_QUERY_ACK:
+            packet.seqn = r.u32();
+            packet.rep.origin_addr = r.addr();
+            break;
+
+        case PKT_ELECTION:
+            packet.election.candidate_id = r.u32();
+            packet.election.candidate_addr = r.addr();
+            packet.election.candidate_port = r.u16();
+            break;
+        case PKT_ELECTION_OK:
+            packet.election_ok.responder_id = r.u32();
+            packet.election_ok.responder_addr = r.addr();
+            packet.election_ok.responder_port = r.u16();
+            break;
+        case PKT_COORDINATOR:
+            packet.coordinator.coordinator_id = r.u32();
+            packet.coordinator.coordinator_addr = r.addr();
+            packet.coordinator.coordinator_port = r.u16();
+            break;
+
+        case PKT_HEARTBEAT:
+        case PKT_HEARTBEAT_ACK:
+            packet.heartbeat.sender_id = r.u32();
+            packet.heartbeat.sender_addr = r.addr();
+            packet.heartbeat.sender_port = r.u16();
+            packet.heartbeat.is_primary = r.u8();
+            break;
+
+        case PKT_SERVER_DISCOVER:
+        case PKT_SERVER_DISCOVER_ACK:
+            packet.server_discovery.id = (int32_t)r.u32();
+            packet.server_discovery.replica_port = (int32_t)r.u32();
+            break;
+
+        default:
+            return false;
+    }
+
+    // Os campos acima existem desde a versão 1: carga mais curta é truncada ou
+    // de outro formato. Campo acrescentado depois é lido abaixo, valendo 0 se faltar.
+    return r.complete();
+}
+
+/* === Lotes do cliente === */
+
+size_t encodeBatchRequest(const BatchRequest& batch, void* buf, size_t cap) {
+    if (batch.count == 0 || batch.count > BATCH_REQUEST_MAX) return 0;
+
+    WireWriter w(buf, cap, PKT_BATCH_REQUEST);
+    w.u32(batch.seqn);
+    w.u16(batch.count);
+    w.u8(batch.flags);
+    for (size_t i = 0; i < batch.count; ++i) {
+        w.addr(batch.items[i].dest_addr);
+        w.u32(batch.items[i].value);
+    }
+    return w.finish();
+}
+
+bool decodeBatchRequest(const WireView& view, BatchRequest& batch) {
+    if (!view.valid() || view.type() != PKT_BATCH_REQUEST) return false;
+
+    WireReader r = view.reader();
+    if (r.remaining() < WIRE_BATCH_REQUEST_HEADER_SIZE) return false;
+    batch.seqn = r.u32();
+    batch.count = r.u16();
+    batch.flags = r.u8();
+    if (batch.count == 0 || batch.count > BATCH_REQUEST_MAX ||
+        r.remaining() < (size_t)batch.count * WIRE_BATCH_ITEM_SIZE) {
+        return false;
+    }
+
+    for (size_t i = 0; i < batch.count; ++i) {
+        batch.items[i].dest_addr = r.addr();
+        batch.items[i].value = r.u32();
+    }
+    return true;
+}
+
+size_t encodeBatchAck(const BatchAck& ack, void* buf, size_t cap) {
+    WireWriter w(buf, cap, PKT_BATCH_ACK);
+    w.u32(ack.seqn);
+    w.u16(ack.count);
+    w.u32(ack.new_balance);
+    for (size_t i = 0; i < ((size_t)ack.count + 7) / 8; ++i) w.u8((uint8_t)(ack.applied >> (8 * i)));
+    return w.finish();
+}
+
+bool decodeBatchAck(const WireView& view, BatchAck& ack) {
+    if (!view.valid() || view.type() != PKT_BATCH_ACK) return false;
+
+    WireReader r = view.reader();
+    ack.seqn = r.u32();
+    ack.count = r.u16();
+    ack.new_balance = r.u32();
+    if (ack.count > BATCH_REQUEST_MAX) return false;
+
+    ack.applied = 0;
+    for (size_t i = 0; i < ((size_t)ack.count + 7) / 8; ++i) ack.applied |= (uint64_t)r.u8() << (8 * i);
+    return true;
+}
+
+/* === Sockets === */
+
+ssize_t sendPacket(int sockfd, const Packet& packet, const struct sockaddr* addr, socklen_t addrlen) {
+    uint8_t buf[WIRE_MAX_PACKET];
+    size_t len = encodePacket(packet, buf, sizeof(buf));
+    if (len == 0) {
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR encoding packet (unknown type)");
+        return -1;
+    }
+    return sendto(sockfd, buf, len, 0, addr, addrlen);
+}
+
+ssize_t recvPacket(int sockfd, Packet& packet, int flags, struct sockaddr* from, socklen_t* fromlen) {
+    WireDatagram buf;
+    ssize_t n = recvfrom(sockfd, buf.bytes, sizeof(buf.bytes), flags, from, fromlen);
+    if (n < 0) return -1;
+
+    if (!decodePacket(WireView(buf.bytes, (size_t)n), packet)) {
+        PIX_LOG_DEBUG(LOG_CAT_NET, "Received undecodable datagram. Ignoring.");
+        return 0;
+    }
+    return n;
+}
@@ -0,0 +1,116 @@
+#include "server/account_table.h"
+
+// Capacidade sempre potência de 2 (índice = hash & mask)
+static size_t roundUpPow2(size_t n) {
+    size_t p = 16;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+AccountTable::AccountTable(size_t initial_capacity) : _size(0) {
+    _storages.emplace_back(new Storage(roundUpPow2(initial_capacity)));
+    _current.store(_storages.back().get(), memory_order_release);
+}
+
+Client* AccountTable::find(uint32_t addr) {
+    return const_cast<Client*>(static_cast<const AccountTable*>(this)->find(addr));
+}
+
+const Client* AccountTable::find(uint32_t addr) const {
+    if (addr == 0) return nullptr;
+
+    const Storage& storage = *_storages.back();
+    uint32_t i = hashAddr(addr) & storage.mask;
+    while (true) {
+        const Slot& slot = storage.slots[i];
+        if (slot.key == addr) return &slot.client;
+        if (slot.key == 0) return nullptr;  // Sem remoções: vazio encerra a sondagem
+        i = (i + 1) & storage.mask;
+    }
+}
+
+void AccountTable::readRecord(const Client& client, ClientSnapshot& out) {
+    unsigned spins = 0;
+    for (;;) {
+        uint32_t version = __atomic_load_n(&client.version, __ATOMIC_ACQUIRE);
+        if (version & 1) {
+            spin_wait(spins);
+            continue;
+        }
+
+        out.last_req = __atomic_load_n(&client.last_req, __ATOMIC_RELAXED);
+        out.balance = __atomic_load_n(&client.balance, __ATOMIC_RELAXED);
+        memcpy(&out.last_ack_response, &client.last_ack_response, sizeof(Packet));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&client.version, __ATOMIC_RELAXED) == version) return;
+    }
+}
+
+bool AccountTable::readClient(uint32_t addr, ClientSnapshot& out) const {
+    if (addr == 0) return false;
+
+    for (;;) {
+        uint32_t layout = _layout.read_begin();
+        const Storage* storage = _current.load(memory_order_acquire);
+
+        // Sondagem limitada: durante uma inserção a cadeia pode estar incompleta
+        const Client* client = nullptr;
+        uint32_t i = hashAddr(addr) & storage->mask;
+        for (uint32_t probes = 0; probes <= storage->mask; ++probes) {
+            uint32_t key = __atomic_load_n(&storage->slots[i].key, __ATOMIC_RELAXED);
+            if (key == addr) {
+                client = &storage->slots[i].client;
+                break;
+            }
+            if (key == 0) break;
+            i = (i + 1) & storage->mask;
+        }
+        if (client != nullptr) readRecord(*client, out);
+
+        // A tabela não mudou durante a busca: o registro lido é o atual
+        if (!_layout.read_retry(layout)) return client != nullptr;
+    }
+}
+
+Client* AccountTable::insert(uint32_t addr) {
+    if (addr == 0) return nullptr;
+
+    WriteGuard layout(_layout);
+
+    // Fator de carga máximo de 70%
+    if ((_size + 1) * 10 > _storages.back()->slots.size() * 7) grow();
+
+    Storage& storage = *_storages.back();
+    uint32_t i = hashAddr(addr) & storage.mask;
+    while (storage.slots[i].key != 0) {
+        if (storage.slots[i].key == addr) return nullptr;
+        i = (i + 1) & storage.mask;
+    }
+
+    storage.slots[i].client = Client(addr);
+    storage.slots[i].key = addr;
+    _size++;
+    return &storage.slots[i].client;
+}
+
+void AccountTable::reserve(size_t count) {
+    WriteGuard layout(_layout);
+    while (count * 10 > _storages.back()->slots.size() * 7) grow();
+}
+
+void AccountTable::grow() {
+    const Storage& old = *_storages.back();
+    unique_ptr<Storage> storage(new Storage(old.slots.size() * 2));
+
+    for (const auto& slot : old.slots) {
+        if (slot.key == 0) continue;
+
+        uint32_t i = hashAddr(slot.key) & storage->mask;
+        while (storage->slots[i].key != 0) i = (i + 1) & storage->mask;
+        storage->slots[i] = slot;
+    }
+
+    _storages.push_back(move(storage));
+    _current.store(_storages.back().get(), memory_order_release);
+}
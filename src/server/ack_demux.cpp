@@ -0,0 +1,110 @@
+#include "server/ack_demux.h"
+#include <cstring>
+#include <vector>
+
+AckDemux ack_demux;
+
+AckDemux::AckDemux() : _running(false) {}
+
+AckDemux::~AckDemux() { stop(); }
+
+void AckDemux::start() {
+    bool expected = false;
+    if (!_running.compare_exchange_strong(expected, true)) return;
+    _timer = thread(&AckDemux::timerLoop, this);
+}
+
+void AckDemux::stop() {
+    bool expected = true;
+    if (_running.compare_exchange_strong(expected, false)) {
+        {
+            lock_guard<mutex> lk(_mutex);
+        }
+        _cv.notify_all();
+        if (_timer.joinable()) _timer.join();
+    }
+
+    // Ninguém fica esperando para sempre
+    multimap<Key, Waiter> pending;
+    {
+        lock_guard<mutex> lk(_mutex);
+        pending.swap(_waiters);
+    }
+
+    Packet empty;
+    memset(&empty, 0, sizeof(Packet));
+    for (auto& entry : pending) entry.second.callback(false, empty);
+}
+
+void AckDemux::expect(uint16_t type, uint32_t seqn, uint32_t origin_addr,
+                      chrono::milliseconds timeout, AckCallback callback) {
+    Waiter waiter;
+    waiter.deadline = chrono::steady_clock::now() + timeout;
+    waiter.callback = move(callback);
+
+    {
+        lock_guard<mutex> lk(_mutex);
+        _waiters.emplace(Key(type, seqn, origin_addr), move(waiter));
+    }
+    _cv.notify_one();  // Pode ser o novo prazo mais próximo
+}
+
+void AckDemux::setStreamHandler(uint16_t type, AckStreamHandler handler) {
+    lock_guard<mutex> lk(_mutex);
+    _stream_handlers[type] = move(handler);
+}
+
+bool AckDemux::deliver(const Packet& ack, const struct sockaddr_in& sender_addr) {
+    AckStreamHandler stream_handler;
+    vector<AckCallback> ready;
+
+    {
+        lock_guard<mutex> lk(_mutex);
+
+        auto handler = _stream_handlers.find(ack.type);
+        if (handler != _stream_handlers.end()) {
+            stream_handler = handler->second;
+        } else {
+            auto range = _waiters.equal_range(Key(ack.type, ack.seqn, ack.rep.origin_addr));
+            for (auto it = range.first; it != range.second; ++it) ready.push_back(move(it->second.callback));
+            _waiters.erase(range.first, range.second);
+        }
+    }
+
+    // Callbacks fora do lock: podem registrar novas esperas
+    if (stream_handler) {
+        stream_handler(ack, sender_addr);
+        return true;
+    }
+    for (auto& callback : ready) callback(true, ack);
+    return !ready.empty();
+}
+
+void AckDemux::timerLoop() {
+    Packet empty;
+    memset(&empty, 0, sizeof(Packet));
+
+    while (_running) {
+        vector<AckCallback> expired;
+        {
+            unique_lock<mutex> lk(_mutex);
+
+            // Dorme até o prazo mais próximo (ou até chegar uma espera nova)
+            auto next_deadline = chrono::steady_clock::now() + chrono::seconds(1);
+            for (const auto& entry : _waiters) next_deadline = min(next_deadline, entry.second.deadline);
+            _cv.wait_until(lk, next_deadline);
+
+            auto now = chrono::steady_clock::now();
+            for (auto it = _waiters.begin(); it != _waiters.end();) {
+                if (it->second.deadline <= now) {
+                    expired.push_back(move(it->second.callback));
+                    it = _waiters.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        for (auto& callback : expired) callback(false, empty);
+    }
+}
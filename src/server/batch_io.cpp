@@ -0,0 +1,135 @@
+#include "server/batch_io.h"
+#include "server/uring_io.h"
+#include "common/utils.h"
+#include <atomic>
+#include <cstring>
+
+static atomic<size_t> batch_io_size(DEFAULT_BATCH_IO);
+
+void setBatchIo(size_t batch) {
+    batch_io_size = (batch > BATCH_IO_MAX) ? BATCH_IO_MAX : batch;
+}
+
+size_t batchIoSize() { return batch_io_size; }
+
+/* === Recepção === */
+
+DatagramReceiver::DatagramReceiver(size_t batch)
+    : _buffers(batch > 0 ? batch : 1), _addrs(_buffers.size()), _iovecs(_buffers.size()), _msgs(_buffers.size()) {
+    for (size_t i = 0; i < _buffers.size(); ++i) {
+        _iovecs[i].iov_base = &_buffers[i];
+        _iovecs[i].iov_len = sizeof(WireDatagram);
+
+        memset(&_msgs[i], 0, sizeof(struct mmsghdr));
+        _msgs[i].msg_hdr.msg_iov = &_iovecs[i];
+        _msgs[i].msg_hdr.msg_iovlen = 1;
+        _msgs[i].msg_hdr.msg_name = &_addrs[i];
+    }
+}
+
+int DatagramReceiver::receive(int sockfd, int flags) {
+    // O kernel reescreve o tamanho do endereço a cada chamada
+    for (auto& msg : _msgs) msg.msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+
+    return recvmmsg(sockfd, _msgs.data(), _msgs.size(), MSG_WAITFORONE | flags, nullptr);
+}
+
+/* === Saída em lote === */
+
+struct Outbox {
+    int depth = 0;
+    size_t count = 0;
+    int fds[BATCH_IO_MAX];
+    uint8_t data[BATCH_IO_MAX][WIRE_MAX_PACKET];
+    struct iovec iovecs[BATCH_IO_MAX];
+    struct sockaddr_in addrs[BATCH_IO_MAX];
+    socklen_t addrlens[BATCH_IO_MAX];
+};
+
+static thread_local Outbox outbox;
+
+OutboxScope::OutboxScope() { outbox.depth++; }
+
+OutboxScope::~OutboxScope() {
+    if (--outbox.depth == 0) flushOutbox();
+}
+
+// Ocupa a próxima posição da caixa com um datagrama de 'len' bytes já escrito nela
+static ssize_t commitOutboxSlot(int sockfd, size_t len, const struct sockaddr_in& addr, socklen_t addrlen) {
+    size_t i = outbox.count;
+    outbox.count++;
+    outbox.fds[i] = sockfd;
+    outbox.iovecs[i].iov_base = outbox.data[i];
+    outbox.iovecs[i].iov_len = len;
+    outbox.addrs[i] = addr;
+    outbox.addrlens[i] = addrlen;
+
+    if (outbox.count >= batch_io_size) flushOutbox();
+    return len;
+}
+
+ssize_t sendDatagram(int sockfd, const Packet& packet, const struct sockaddr_in& addr, socklen_t addrlen) {
+    size_t limit = batch_io_size;
+    if (outbox.depth == 0 || limit == 0) {
+        return sendPacket(sockfd, packet, (const struct sockaddr*)&addr, addrlen);
+    }
+
+    size_t len = encodePacket(packet, outbox.data[outbox.count], WIRE_MAX_PACKET);
+    if (len == 0) {
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR encoding packet (unknown type)");
+        return -1;
+    }
+    return commitOutboxSlot(sockfd, len, addr, addrlen);
+}
+
+ssize_t sendEncoded(int sockfd, const void* data, size_t len, const struct sockaddr_in& addr, socklen_t addrlen) {
+    size_t limit = batch_io_size;
+    if (outbox.depth == 0 || limit == 0 || len > WIRE_MAX_PACKET) {
+        return sendto(sockfd, data, len, 0, (const struct sockaddr*)&addr, addrlen);
+    }
+
+    memcpy(outbox.data[outbox.count], data, len);
+    return commitOutboxSlot(sockfd, len, addr, addrlen);
+}
+
+void flushOutbox() {
+    // Com o backend io_uring o lote inteiro vai numa só submissão
+    if (outbox.count > 0 && uringAvailable() &&
+        uringSendBatch(outbox.fds, outbox.iovecs, outbox.addrs, outbox.addrlens, outbox.count)) {
+        outbox.count = 0;
+        return;
+    }
+
+    struct mmsghdr msgs[BATCH_IO_MAX];
+
+    size_t first = 0;
+    while (first < outbox.count) {
+        // Um sendmmsg por trecho contínuo do mesmo socket
+        size_t last = first + 1;
+        while (last < outbox.count && outbox.fds[last] == outbox.fds[first]) last++;
+
+        size_t n = last - first;
+        for (size_t i = 0; i < n; ++i) {
+            memset(&msgs[i], 0, sizeof(struct mmsghdr));
+            msgs[i].msg_hdr.msg_iov = &outbox.iovecs[first + i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &outbox.addrs[first + i];
+            msgs[i].msg_hdr.msg_namelen = outbox.addrlens[first + i];
+        }
+
+        // sendmmsg pode enviar só parte; em erro o datagrama da vez é descartado
+        // (como um sendto que falhou: o cliente retransmite)
+        size_t sent = 0;
+        while (sent < n) {
+            int r = sendmmsg(outbox.fds[first], msgs + sent, n - sent, 0);
+            if (r < 0) {
+                PIX_LOG_ERROR(LOG_CAT_NET, "ERROR on sendmmsg");
+                sent++;
+            } else {
+                sent += r;
+            }
+        }
+        first = last;
+    }
+    outbox.count = 0;
+}
@@ -0,0 +1,115 @@
+#include "server/config.h"
+#include "common/log.h"
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+// Separa "--nome=valor" em nome e valor
+static bool splitOption(const string& arg, string& name, string& value) {
+    if (arg.rfind("--", 0) != 0) return false;
+
+    size_t eq = arg.find('=');
+    if (eq == string::npos) {
+        name = arg.substr(2);
+        value = "";
+    } else {
+        name = arg.substr(2, eq - 2);
+        value = arg.substr(eq + 1);
+    }
+    return true;
+}
+
+ServerConfig parseServerOptions(int argc, char* argv[], int first) {
+    ServerConfig config;
+
+    for (int i = first; i < argc; ++i) {
+        string name, value;
+        if (!splitOption(argv[i], name, value)) {
+            throw invalid_argument("Unexpected argument: " + string(argv[i]));
+        }
+
+        if (name == "workers") {
+            config.worker_threads = stoul(value);
+        } else if (name == "queue-capacity") {
+            config.worker_queue_capacity = stoul(value);
+            if (config.worker_queue_capacity == 0)
+                throw invalid_argument("--queue-capacity must be > 0");
+        } else if (name == "overload") {
+            if (value == "drop")
+                config.overload_policy = OVERLOAD_DROP;
+            else if (value == "last-ack")
+                config.overload_policy = OVERLOAD_REPLY_LAST_ACK;
+            else
+                throw invalid_argument("--overload must be 'drop' or 'last-ack'");
+        } else if (name == "wal") {
+            if (value.empty()) throw invalid_argument("--wal requires a path");
+            config.wal_path = value;
+        } else if (name == "no-wal") {
+            config.wal_enabled = false;
+        } else if (name == "wal-group-commit-us") {
+            config.wal_group_commit_us = stoul(value);
+        } else if (name == "snapshot-interval") {
+            config.snapshot_interval_s = stoul(value);
+        } else if (name == "replication-batch") {
+            config.replication_batch = stoul(value);
+            if (config.replication_batch == 0 || config.replication_batch > REPLICATION_BATCH_MAX)
+                throw invalid_argument("--replication-batch must be between 1 and " + to_string(REPLICATION_BATCH_MAX));
+        } else if (name == "replication-batch-us") {
+            config.replication_batch_us = stoul(value);
+        } else if (name == "batch-io") {
+            config.batch_io = stoul(value);
+            if (config.batch_io > BATCH_IO_MAX)
+                throw invalid_argument("--batch-io must be between 0 and " + to_string(BATCH_IO_MAX));
+        } else if (name == "reuseport") {
+            config.reuseport_sockets = stoul(value);
+        } else if (name == "io-uring") {
+            if (value != "0" && value != "1") throw invalid_argument("--io-uring must be 0 or 1");
+            config.io_uring = (value == "1");
+        } else if (name == "log") {
+            // Aplicado já aqui: os níveis são globais e valem desde a inicialização
+            if (!logConfigure(value))
+                throw invalid_argument("--log must be LEVEL or CATEGORY=LEVEL[,...] (levels: off, error, warn, "
+                                       "info, debug, trace)");
+        } else {
+            throw invalid_argument("Unknown option: --" + name);
+        }
+    }
+
+    if (config.reuseport_sockets == 0) {
+        unsigned int cores = thread::hardware_concurrency();
+        config.reuseport_sockets = (cores > 0) ? cores : 1;
+    }
+
+    if (config.worker_threads == 0) {
+        unsigned int cores = thread::hardware_concurrency();
+        config.worker_threads = (cores > 0) ? cores : 4;
+    }
+
+    return config;
+}
+
+void printServerOptionsUsage() {
+    cerr << "Options:" << endl;
+    cerr << "  --workers=N          Worker lanes (one thread each, requests sharded by client IP; default: number of cores)" << endl;
+    cerr << "  --queue-capacity=N   Max queued packets, split across lanes (default: "
+         << DEFAULT_WORKER_QUEUE_CAPACITY << ")" << endl;
+    cerr << "  --overload=POLICY    'drop' or 'last-ack' (reply with buffered last ACK, default)" << endl;
+    cerr << "  --wal=PATH           Transaction log file (default: pix_server_<ID>.wal)" << endl;
+    cerr << "  --no-wal             Keep state only in memory" << endl;
+    cerr << "  --wal-group-commit-us=N  Extra wait to batch more records per fsync (default: "
+         << WAL_DEFAULT_GROUP_COMMIT_US << ")" << endl;
+    cerr << "  --snapshot-interval=S  Seconds between snapshots (<wal>.snap), 0 disables (default: "
+         << DEFAULT_SNAPSHOT_INTERVAL_S << ")" << endl;
+    cerr << "  --replication-batch=N  Max transfers per replication datagram (1-" << REPLICATION_BATCH_MAX
+         << ", default: " << REPLICATION_BATCH_MAX << ")" << endl;
+    cerr << "  --replication-batch-us=N  Max wait to fill a replication datagram, 0 sends at once (default: "
+         << REPLICATION_BATCH_DELAY_US << ")" << endl;
+    cerr << "  --batch-io=N         Datagrams per recvmmsg/sendmmsg, 0 uses one recvfrom/sendto each (0-"
+         << BATCH_IO_MAX << ", default: " << DEFAULT_BATCH_IO << ")" << endl;
+    cerr << "  --reuseport=K        K SO_REUSEPORT sockets on the client port, each with a receive thread pinned to a core"
+         << " (0 = number of cores, default: 1)" << endl;
+    cerr << "  --io-uring=0|1       Use the io_uring datagram backend when built with IO_URING=1 (default: 1)" << endl;
+    cerr << "  --log=SPEC           Log levels: 'debug' for every category or e.g. 'election=debug,net=off'" << endl;
+    cerr << "                       (categories: general, net, storage, election, replication, processing, discovery;"
+         << " default: info)" << endl;
+}
@@ -1,168 +1,502 @@
 #include "server/database.h"
 #include "server/interface.h"
+#include "server/wal.h"
+#include "server/snapshot.h"
 
 ServerDatabase server_db;  // Definição da instância global
 
+/* === Partições === */
+
+// Usa os bits altos do hash; a AccountTable de cada partição usa os baixos
+size_t ServerDatabase::shardIndex(uint32_t addr) {
+    return (hashAddr(addr) >> 24) % CLIENT_TABLE_SHARDS;
+}
+
+ClientShard& ServerDatabase::shardFor(uint32_t addr) {
+    return client_shards[shardIndex(addr)];
+}
+
+Client* ServerDatabase::findClient_unsafe(uint32_t addr) {
+    return shardFor(addr).clients.find(addr);
+}
+
+void ServerDatabase::lockPair_unsafe(size_t a, size_t b) {
+    if (a == b) {
+        client_shards[a].lock.write_lock();
+        return;
+    }
+    // Sempre na mesma ordem global: menor índice primeiro
+    client_shards[min(a, b)].lock.write_lock();
+    client_shards[max(a, b)].lock.write_lock();
+}
+
+void ServerDatabase::unlockPair_unsafe(size_t a, size_t b) {
+    client_shards[a].lock.write_unlock();
+    if (a != b) client_shards[b].lock.write_unlock();
+}
+
+static_assert(CLIENT_TABLE_SHARDS <= 64, "shard sets are 64-bit masks");
+
+void ServerDatabase::lockShards_unsafe(uint64_t mask) {
+    for (size_t i = 0; i < CLIENT_TABLE_SHARDS; ++i) {
+        if (mask & (1ull << i)) client_shards[i].lock.write_lock();
+    }
+}
+
+void ServerDatabase::unlockShards_unsafe(uint64_t mask) {
+    for (size_t i = 0; i < CLIENT_TABLE_SHARDS; ++i) {
+        if (mask & (1ull << i)) client_shards[i].lock.write_unlock();
+    }
+}
+
+void ServerDatabase::readLockAllShards() const {
+    for (size_t i = 0; i < CLIENT_TABLE_SHARDS; ++i) client_shards[i].lock.read_lock();
+}
+
+void ServerDatabase::unlockAllShards() const {
+    for (size_t i = 0; i < CLIENT_TABLE_SHARDS; ++i) client_shards[i].lock.read_unlock();
+}
+
+// Soma um delta (com sinal) a um contador parcial. Só é chamado com o lock
+// de escrita da partição, então não há escritores concorrentes: relaxed basta.
+static inline void addToCounter(atomic<uint64_t>& counter, int64_t delta) {
+    counter.fetch_add((uint64_t)delta, memory_order_relaxed);
+}
+
+uint64_t ServerDatabase::appendLog_unsafe(uint8_t type, uint32_t origin_addr, uint32_t dest_addr, uint32_t req_id,
+                                          uint32_t amount, uint32_t balance_origin, uint32_t balance_dest) {
+    if (transaction_log_ == nullptr) return 0;
+
+    WalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = type;
+    record.origin_addr = origin_addr;
+    record.dest_addr = dest_addr;
+    record.req_id = req_id;
+    record.amount = amount;
+    record.balance_origin = balance_origin;
+    record.balance_dest = balance_dest;
+
+    return transaction_log_->append(record);
+}
+
 /* === Transações === */
 
-bool ServerDatabase::makeTransaction(const string& origin_ip, const string& dest_ip, Packet packet) {
+bool ServerDatabase::makeTransaction(uint32_t origin_addr, uint32_t dest_addr, const Packet& packet,
+                                     TransferResult& result) {
+    size_t orig_shard = shardIndex(origin_addr);
+    size_t dest_shard = shardIndex(dest_addr);
+    uint32_t amount = packet.req.value;
+
+    // Duplicidade já foi filtrada pelo processing (raia serializada por cliente)
+    lockPair_unsafe(orig_shard, dest_shard);
+
+    Client* orig = findClient_unsafe(origin_addr);
+    Client* dest = findClient_unsafe(dest_addr);
+
+    result.balance_origin = (orig != nullptr) ? orig->balance : 0;
+    result.balance_dest = (dest != nullptr) ? dest->balance : 0;
+    result.lsn = 0;
+
+    if (orig == nullptr || dest == nullptr) {
+        unlockPair_unsafe(orig_shard, dest_shard);
+        // Se não existe, retorna falso ANTES de tentar ler saldo
+        PIX_LOG_TRACE(LOG_CAT_STORAGE, "Transaction failed: Client not found.");
+        return false;
+    }
+
+    bool enough_balance = (orig->balance >= amount);
+    bool valid_amount = (amount > 0);
+
+    // Validação
+    if (!enough_balance || !valid_amount) {
+        {
+            ClientWriteGuard record(orig);
+            orig->last_req = packet.seqn;
+        }
+        result.lsn = appendLog_unsafe(WAL_LAST_REQ, origin_addr, 0, packet.seqn, 0, 0, 0);
+        unlockPair_unsafe(orig_shard, dest_shard);
+        PIX_LOG_TRACE(LOG_CAT_STORAGE, "Transaction failed: Insufficient funds or invalid amount.");
+        return false;
+    }
+
+    // --- COMMIT ATÔMICO nas duas partições ---
+    {
+        ClientWriteGuard records(orig, dest);
+        orig->balance -= amount;
+        dest->balance += amount;
+        orig->last_req = packet.seqn;
+
+        memset(&orig->last_ack_response, 0, sizeof(Packet));
+        orig->last_ack_response.type = PKT_REQUEST_ACK;
+        orig->last_ack_response.seqn = packet.seqn;
+        orig->last_ack_response.ack.new_balance = orig->balance;
+    }
+
+    result.balance_origin = orig->balance;
+    result.balance_dest = dest->balance;
+
+    addToCounter(client_shards[orig_shard].balance_sum, -(int64_t)amount);
+    addToCounter(client_shards[dest_shard].balance_sum, amount);
+    addToCounter(client_shards[orig_shard].num_transactions, 1);
+    addToCounter(client_shards[orig_shard].total_transferred, amount);
+
+    result.lsn = appendLog_unsafe(WAL_TRANSFER, origin_addr, dest_addr, packet.seqn, amount,
+                                  result.balance_origin, result.balance_dest);
+
+    // O histórico tem lock próprio, curto; pegamos antes de soltar as partições
+    // para que a ordem do histórico siga a ordem dos commits nas contas.
     {
-        WriteGuard client_lock(client_table_lock);
         WriteGuard history_lock(transaction_history_lock);
-        WriteGuard summary_lock(bank_summary_lock); 
-
-        uint32_t amount = packet.req.value;
-        
-        auto it_orig = client_table.find(origin_ip);
-        auto it_dest = client_table.find(dest_ip);
-        bool clients_exist = (it_orig != client_table.end() && it_dest != client_table.end());
-        
-        if (!clients_exist) {
-            // Se não existe, retorna falso ANTES de tentar ler saldo
-            log_message("Transaction failed: Client not found.");
-            return false; 
-        }
+        int tx_id = next_transaction_id.fetch_add(1);
+        transaction_history.emplace_back(tx_id, origin_addr, packet.seqn, dest_addr, amount);
+    }
 
-        if (packet.seqn <= it_orig->second.last_req) {
-             log_message("Transaction rejected inside DB: Duplicate ID detected atomically.");
-             return true;
-        }
+    unlockPair_unsafe(orig_shard, dest_shard);
 
-        bool enough_balance = (it_orig->second.balance >= amount);
-        bool valid_amount = (amount > 0);
-    
-        // Validação
-        if (!clients_exist) {
-            log_message("Transaction failed: Origin or Destination client not found.");
-            updateClientLastReq_unsafe(origin_ip, packet.seqn);
-            updateBankSummary_unsafe();
-            return false;
-        }
-        if (!enough_balance || !valid_amount) {
-            log_message("Transaction failed: Insufficient funds or invalid amount.");
-            updateClientLastReq_unsafe(origin_ip, packet.seqn);
-            updateBankSummary_unsafe();
-            return false;
+#ifdef PIX_DEBUG
+    verifyBankSummary();
+#endif
+
+    return true;
+}
+
+bool ServerDatabase::makeBatchTransaction(uint32_t origin_addr, const BatchRequest& batch, BatchResult& result) {
+    size_t orig_shard = shardIndex(origin_addr);
+    uint32_t last_seqn = batch.seqn + batch.count - 1;
+
+    result.applied = 0;
+    result.transfer_count = 0;
+    result.lsn = 0;
+
+    // Uma aquisição só: as partições da origem e de todos os destinos, em ordem
+    uint64_t mask = 1ull << orig_shard;
+    for (size_t i = 0; i < batch.count; ++i) mask |= 1ull << shardIndex(batch.items[i].dest_addr);
+    lockShards_unsafe(mask);
+
+    Client* orig = findClient_unsafe(origin_addr);
+    if (orig == nullptr) {
+        unlockShards_unsafe(mask);
+        PIX_LOG_TRACE(LOG_CAT_STORAGE, "Batch failed: Client not found.");
+        result.balance_origin = 0;
+        return false;
+    }
+
+    Client* dests[BATCH_REQUEST_MAX];
+    for (size_t i = 0; i < batch.count; ++i) dests[i] = findClient_unsafe(batch.items[i].dest_addr);
+
+    // Lote atômico: valida tudo antes, simulando o saldo da origem item a item
+    bool all_or_nothing = (batch.flags & BATCH_FLAG_ATOMIC) != 0;
+    bool batch_valid = true;
+    if (all_or_nothing) {
+        uint64_t balance = orig->balance;
+        for (size_t i = 0; i < batch.count && batch_valid; ++i) {
+            uint32_t amount = batch.items[i].value;
+            batch_valid = dests[i] != nullptr && amount > 0 && balance >= amount;
+            if (batch_valid && dests[i] != orig) balance -= amount;
         }
+    }
 
-        // --- 3. COMMIT ATÔMICO (Usando lógica _UNSAFE/Inline) ---
-        
-        updateClientBalance_unsafe(origin_ip, -amount);
-        updateClientBalance_unsafe(dest_ip, amount);
+    for (size_t i = 0; i < batch.count && batch_valid; ++i) {
+        Client* dest = dests[i];
+        uint32_t amount = batch.items[i].value;
+        if (dest == nullptr || amount == 0 || orig->balance < amount) continue;
 
-        addTransaction_unsafe(origin_ip, packet.seqn, dest_ip, amount);
+        size_t dest_shard = shardIndex(dest->addr);
+        uint32_t seqn = batch.seqn + (uint32_t)i;
 
-        updateClientLastReq_unsafe(origin_ip, packet.seqn);
+        {
+            ClientWriteGuard records(orig, dest);
+            orig->balance -= amount;
+            dest->balance += amount;
+            orig->last_req = seqn;
+        }
 
-        updateBankSummary_unsafe();
+        addToCounter(client_shards[orig_shard].balance_sum, -(int64_t)amount);
+        addToCounter(client_shards[dest_shard].balance_sum, amount);
+        addToCounter(client_shards[orig_shard].num_transactions, 1);
+        addToCounter(client_shards[orig_shard].total_transferred, amount);
+
+        // Cada item vai ao log e ao fluxo de replicação como uma transferência
+        // comum com o seu ID: o replay e os backups não conhecem lotes
+        result.lsn = appendLog_unsafe(WAL_TRANSFER, origin_addr, dest->addr, seqn, amount, orig->balance,
+                                      dest->balance);
+
+        ReplicationRecord& transfer = result.transfers[result.transfer_count++];
+        transfer.log_index = 0;
+        transfer.seqn = seqn;
+        transfer.origin_addr = origin_addr;
+        transfer.dest_addr = dest->addr;
+        transfer.value = amount;
+        transfer.final_balance_origin = orig->balance;
+        transfer.final_balance_dest = dest->balance;
+
+        result.applied |= 1ull << i;
+    }
 
-        uint32_t balance = getClientBalance_unsafe(origin_ip);
-        
-        Packet final_ack;
-        final_ack.type = PKT_REQUEST_ACK;
-        final_ack.seqn = packet.seqn; 
-        final_ack.ack.new_balance = balance >= 0 ? balance : 0;
+    // O lote inteiro conta como processado, mesmo com itens recusados no fim
+    if (orig->last_req != last_seqn) {
+        result.lsn = appendLog_unsafe(WAL_LAST_REQ, origin_addr, 0, last_seqn, 0, 0, 0);
+    }
 
-        updateClientLastAck_unsafe(origin_ip, final_ack);
+    {
+        ClientWriteGuard record(orig);
+        orig->last_req = last_seqn;
+        memset(&orig->last_ack_response, 0, sizeof(Packet));
+        orig->last_ack_response.type = PKT_REQUEST_ACK;
+        orig->last_ack_response.seqn = last_seqn;
+        orig->last_ack_response.ack.new_balance = orig->balance;
     }
-    
+    result.balance_origin = orig->balance;
+
+    if (result.transfer_count > 0) {
+        WriteGuard history_lock(transaction_history_lock);
+        for (size_t i = 0; i < result.transfer_count; ++i) {
+            const ReplicationRecord& transfer = result.transfers[i];
+            int tx_id = next_transaction_id.fetch_add(1);
+            transaction_history.emplace_back(tx_id, origin_addr, transfer.seqn, transfer.dest_addr, transfer.value);
+        }
+    }
+
+    unlockShards_unsafe(mask);
+
+#ifdef PIX_DEBUG
+    verifyBankSummary();
+#endif
+
+    if (!batch_valid) PIX_LOG_TRACE(LOG_CAT_STORAGE, "Batch refused: an item failed validation (atomic batch).");
     return true;
 }
 
-/* === Tabela de Clientes === */
+void ServerDatabase::applyTransferState_unsafe(size_t orig_shard, Client* orig, size_t dest_shard, Client* dest,
+                                               uint32_t req_id, uint32_t amount, uint32_t final_balance_origin,
+                                               uint32_t final_balance_dest, bool apply_origin, bool apply_dest) {
+    // Aplicação passiva: sobrescreve com os saldos calculados pelo líder.
+    // Deltas calculados um de cada vez (origem e destino podem ser o mesmo cliente).
+    if (apply_origin) {
+        addToCounter(client_shards[orig_shard].balance_sum, (int64_t)final_balance_origin - orig->balance);
+
+        ClientWriteGuard record(orig);
+        orig->balance = final_balance_origin;
+
+        // last_req só avança (uma requisição posterior já pode ter chegado por
+        // outro caminho). Se este backup virar líder, uma retransmissão do
+        // cliente recebe o ACK certo.
+        if (req_id >= orig->last_req) {
+            orig->last_req = req_id;
+            memset(&orig->last_ack_response, 0, sizeof(Packet));
+            orig->last_ack_response.type = PKT_REQUEST_ACK;
+            orig->last_ack_response.seqn = req_id;
+            orig->last_ack_response.ack.new_balance = final_balance_origin;
+            orig->last_ack_response.ack.dest_addr = dest->addr;
+            orig->last_ack_response.ack.value = amount;
+        }
 
-bool ServerDatabase::addClient(const string& ip_address) {
-    WriteGuard write_lock(client_table_lock);
-    bool clientExists = (client_table.find(ip_address) != client_table.end());
+        addToCounter(client_shards[orig_shard].num_transactions, 1);
+        addToCounter(client_shards[orig_shard].total_transferred, amount);
 
-    if (clientExists) {
-        return false;
+        WriteGuard history_lock(transaction_history_lock);
+        int tx_id = next_transaction_id.fetch_add(1);
+        transaction_history.emplace_back(tx_id, orig->addr, req_id, dest->addr, amount);
     }
 
-    client_table.emplace(ip_address, Client(ip_address));
+    if (apply_dest) {
+        addToCounter(client_shards[dest_shard].balance_sum, (int64_t)final_balance_dest - dest->balance);
 
-    return true;
+        ClientWriteGuard record(dest);
+        dest->balance = final_balance_dest;
+    }
 }
 
-// Escrita
-bool ServerDatabase::updateClientLastReq(const string& ip_address, uint32_t req_number) {
-    WriteGuard write_lock(client_table_lock);
-    auto it = client_table.find(ip_address);
+uint64_t ServerDatabase::applyReplicatedTransfer(uint32_t origin_addr, uint32_t dest_addr, uint32_t req_id,
+                                             uint32_t amount, uint32_t final_balance_origin, uint32_t final_balance_dest) {
+    size_t orig_shard = shardIndex(origin_addr);
+    size_t dest_shard = shardIndex(dest_addr);
 
-    if (it != client_table.end()) {
-        it->second.last_req = req_number;
-        return true;
+    lockPair_unsafe(orig_shard, dest_shard);
+
+    // Os saldos são absolutos: uma conta que falta aqui é criada e fica igual à do líder
+    if (!ensureReplicatedClient_unsafe(origin_addr) || !ensureReplicatedClient_unsafe(dest_addr)) {
+        unlockPair_unsafe(orig_shard, dest_shard);
+        PIX_LOG_ERROR(LOG_CAT_STORAGE, "Replicated transfer with an invalid client address.");
+        return 0;
     }
+    Client* orig = findClient_unsafe(origin_addr);
+    Client* dest = findClient_unsafe(dest_addr);
 
-    return false;
+    applyTransferState_unsafe(orig_shard, orig, dest_shard, dest, req_id, amount,
+                              final_balance_origin, final_balance_dest, true, true);
+
+    uint64_t lsn = appendLog_unsafe(WAL_TRANSFER, origin_addr, dest_addr, req_id, amount,
+                                    final_balance_origin, final_balance_dest);
+
+    unlockPair_unsafe(orig_shard, dest_shard);
+
+#ifdef PIX_DEBUG
+    verifyBankSummary();
+#endif
+
+    return lsn;
 }
 
-bool ServerDatabase::updateClientLastReq_unsafe(const string& ip_address, uint32_t req_number) {
-    auto it = client_table.find(ip_address);
+uint64_t ServerDatabase::applyReplicatedBatch(const ReplicationRecord* records, size_t count) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < count; ++i) {
+        mask |= 1ull << shardIndex(records[i].origin_addr);
+        if (isTransferRecord(records[i])) mask |= 1ull << shardIndex(records[i].dest_addr);
+    }
 
-    if (it != client_table.end()) {
-        it->second.last_req = req_number;
-        return true;
+    lockShards_unsafe(mask);
+
+    uint64_t lsn = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const ReplicationRecord& rec = records[i];
+        if (rec.dest_addr == REPLICATION_NEW_CLIENT_DEST) {
+            // Já existir é normal (criado por uma transferência que chegou antes)
+            insertClient_unsafe(rec.origin_addr, &lsn);
+            continue;
+        }
+        if (rec.dest_addr == REPLICATION_QUERY_DEST) {
+            if (ensureReplicatedClient_unsafe(rec.origin_addr)) {
+                uint64_t query_lsn = recordQuery_unsafe(rec.origin_addr, rec.seqn, rec.final_balance_origin);
+                if (query_lsn != 0) lsn = query_lsn;
+            }
+            continue;
+        }
+        if (!ensureReplicatedClient_unsafe(rec.origin_addr) || !ensureReplicatedClient_unsafe(rec.dest_addr)) {
+            PIX_LOG_ERROR(LOG_CAT_STORAGE, "Replicated transfer with an invalid client address.");
+            continue;
+        }
+        Client* orig = findClient_unsafe(rec.origin_addr);
+        Client* dest = findClient_unsafe(rec.dest_addr);
+
+        applyTransferState_unsafe(shardIndex(rec.origin_addr), orig, shardIndex(rec.dest_addr), dest, rec.seqn,
+                                  rec.value, rec.final_balance_origin, rec.final_balance_dest, true, true);
+        lsn = appendLog_unsafe(WAL_TRANSFER, rec.origin_addr, rec.dest_addr, rec.seqn, rec.value,
+                               rec.final_balance_origin, rec.final_balance_dest);
     }
 
-    return false;
+    unlockShards_unsafe(mask);
+
+#ifdef PIX_DEBUG
+    verifyBankSummary();
+#endif
+
+    return lsn;
+}
+
+/* === Tabela de Clientes === */
+
+Client* ServerDatabase::insertClient_unsafe(uint32_t addr, uint64_t* lsn) {
+    ClientShard& shard = shardFor(addr);
+
+    // insert() devolve nullptr se o cliente já existe
+    Client* client = shard.clients.insert(addr);
+    if (client == nullptr) return nullptr;
+
+    addToCounter(shard.balance_sum, client->balance);
+    uint64_t record_lsn = appendLog_unsafe(WAL_NEW_CLIENT, addr, 0, 0, 0, client->balance, 0);
+    if (lsn != nullptr && record_lsn != 0) *lsn = record_lsn;
+    return client;
 }
 
-bool ServerDatabase::updateClientBalance(const string& ip_address, int32_t transaction_value) {
-    WriteGuard write_lock(client_table_lock);
+bool ServerDatabase::ensureReplicatedClient_unsafe(uint32_t addr) {
+    if (findClient_unsafe(addr) != nullptr) return true;
 
-    auto it = client_table.find(ip_address);
-    if (it != client_table.end()) {
-        it->second.balance += transaction_value;
+    PIX_LOG_WARN(LOG_CAT_STORAGE, "Replicated transfer references unknown client %s; creating it",
+                 uint32ToIp(addr).c_str());
+    return insertClient_unsafe(addr) != nullptr;
+}
+
+bool ServerDatabase::addClient(uint32_t addr) {
+    WriteGuard write_lock(shardFor(addr).lock);
+    return insertClient_unsafe(addr) != nullptr;
+}
+
+// Escrita
+bool ServerDatabase::updateClientLastReq(uint32_t addr, uint32_t req_number) {
+    WriteGuard write_lock(shardFor(addr).lock);
+
+    // last_req só avança: uma mensagem atrasada não pode desfazer uma requisição posterior
+    Client* client = findClient_unsafe(addr);
+    if (client != nullptr) {
+        if (req_number > client->last_req) {
+            {
+                ClientWriteGuard record(client);
+                client->last_req = req_number;
+            }
+            appendLog_unsafe(WAL_LAST_REQ, addr, 0, req_number, 0, 0, 0);
+        }
         return true;
     }
 
     return false;
 }
 
-bool ServerDatabase::updateClientBalance_unsafe(const string& ip_address, int32_t transaction_value) {
-    auto it = client_table.find(ip_address);
+uint64_t ServerDatabase::recordQuery(uint32_t addr, uint32_t req_number, uint32_t balance) {
+    WriteGuard write_lock(shardFor(addr).lock);
+    return recordQuery_unsafe(addr, req_number, balance);
+}
 
-    if (it != client_table.end()) {
-        it->second.balance += transaction_value;
-        return true;
+uint64_t ServerDatabase::recordQuery_unsafe(uint32_t addr, uint32_t req_number, uint32_t balance) {
+    Client* client = findClient_unsafe(addr);
+    if (client == nullptr || req_number < client->last_req) {
+        return 0;
     }
 
-    return false;
+    {
+        ClientWriteGuard record(client);
+        client->last_req = req_number;
+
+        memset(&client->last_ack_response, 0, sizeof(Packet));
+        client->last_ack_response.type = PKT_REQUEST_ACK;
+        client->last_ack_response.seqn = req_number;
+        client->last_ack_response.ack.new_balance = balance;
+    }
+
+    return appendLog_unsafe(WAL_QUERY, addr, 0, req_number, 0, balance, 0);
 }
 
-// Escrita
-bool ServerDatabase::updateClientLastAck_unsafe(const string& ip_address, const Packet& ack) {
-    auto it = client_table.find(ip_address);
+bool ServerDatabase::updateClientBalance(uint32_t addr, int32_t transaction_value) {
+    ClientShard& shard = shardFor(addr);
+    WriteGuard write_lock(shard.lock);
 
-    if (it != client_table.end()) {
-        it->second.last_ack_response = ack;
+    Client* client = findClient_unsafe(addr);
+    if (client != nullptr) {
+        {
+            ClientWriteGuard record(client);
+            client->balance += transaction_value;
+        }
+        addToCounter(shard.balance_sum, transaction_value);
         return true;
     }
 
     return false;
 }
 
-bool ServerDatabase::updateClientLastAck(const string& ip_address, const Packet& ack) {
-    WriteGuard write_lock(client_table_lock);
-    
-    auto it = client_table.find(ip_address);
+// Escrita
+bool ServerDatabase::updateClientLastAck(uint32_t addr, const Packet& ack) {
+    WriteGuard write_lock(shardFor(addr).lock);
 
-    if (it != client_table.end()) {
-        it->second.last_ack_response = ack;
+    Client* client = findClient_unsafe(addr);
+    if (client != nullptr) {
+        ClientWriteGuard record(client);
+        client->last_ack_response = ack;
         return true;
     }
 
     return false;
 }
 
-// Leitura 
-Packet ServerDatabase::getClientLastAck(const string& ip_address) {
-    ReadGuard read_lock(client_table_lock);
-    auto it = client_table.find(ip_address);
+// Leituras sem lock: cópia pela versão do registro (ver AccountTable::readClient)
+bool ServerDatabase::getClientSnapshot(uint32_t addr, ClientSnapshot& out) {
+    return shardFor(addr).clients.readClient(addr, out);
+}
 
-    if (it != client_table.end()) {
-        return it->second.last_ack_response;
+Packet ServerDatabase::getClientLastAck(uint32_t addr) {
+    ClientSnapshot snapshot;
+    if (getClientSnapshot(addr, snapshot)) {
+        return snapshot.last_ack_response;
     }
 
     // Retorna um pacote vazio (ou um pacote de erro) se não for encontrado
@@ -172,118 +506,296 @@ Packet ServerDatabase::getClientLastAck(const string& ip_address) {
     return empty_ack;
 }
 
-uint32_t ServerDatabase::getClientBalance(const string& ip_address) {
-    ReadGuard read_lock(client_table_lock);
-    
-    auto it = client_table.find(ip_address);
-    if (it != client_table.end()) {
-        return it->second.balance;
+uint32_t ServerDatabase::getClientBalance(uint32_t addr) {
+    ClientSnapshot snapshot;
+    if (getClientSnapshot(addr, snapshot)) {
+        return snapshot.balance;
     }
 
-    return ERROR; 
+    return ERROR;
 }
 
-uint32_t ServerDatabase::getClientBalance_unsafe(const string& ip_address) {
-    auto it = client_table.find(ip_address);
-    if (it != client_table.end()) {
-        return it->second.balance;
+uint32_t ServerDatabase::getClientLastReq(uint32_t addr) {
+    ClientSnapshot snapshot;
+    if (getClientSnapshot(addr, snapshot)) {
+        return snapshot.last_req;
     }
 
-    return ERROR; 
-}
-
-
-// Leitura
-uint32_t ServerDatabase::getClientLastReq(const string& ip_address) {
-    // Usa ReadGuard para leitura, permitindo alta concorrência.
-    ReadGuard read_lock(client_table_lock);
-
-    auto it = client_table.find(ip_address);
-    if (it != client_table.end()) {
-        return it->second.last_req;
-    }
-    
     // Se o cliente existe (foi adicionado na Descoberta), mas o IP não foi encontrado
     // (o que não deveria acontecer), ou se a tabela estiver sendo inicializada, retornamos 0.
     return 0;
 }
 
-int ServerDatabase::addTransaction(const string& origin_ip, int req_id, const string& destination_ip, uint32_t amount) {
+int ServerDatabase::addTransaction(uint32_t origin_addr, int req_id, uint32_t destination_addr, uint32_t amount) {
     int tx_id = next_transaction_id.fetch_add(1);
     WriteGuard write_lock(transaction_history_lock);
 
-    transaction_history.emplace_back(tx_id, origin_ip, req_id, destination_ip, amount);
+    transaction_history.emplace_back(tx_id, origin_addr, req_id, destination_addr, amount);
 
     return tx_id;
 }
 
+/* === Snapshots e replay === */
+
+void ServerDatabase::captureShard(size_t index, vector<SnapshotClient>& out, SnapshotShardHeader& header) const {
+    const ClientShard& shard = client_shards[index];
+    ReadGuard read_lock(shard.lock);
+
+    // Todo registro que toca esta partição é anexado sob o lock de escrita dela,
+    // então com o lock de leitura o último LSN é um corte exato para a partição.
+    header.cut_lsn = (transaction_log_ != nullptr) ? transaction_log_->lastLsn() : 0;
+    header.num_clients = shard.clients.size();
+    header.num_transactions = shard.num_transactions.load(memory_order_relaxed);
+    header.total_transferred = shard.total_transferred.load(memory_order_relaxed);
+
+    out.clear();
+    out.reserve(shard.clients.size());
+    shard.clients.forEach([&](const Client& client) {
+        SnapshotClient record;
+        memset(&record, 0, sizeof(record));
+        record.addr = client.addr;
+        record.last_req = client.last_req;
+        record.balance = client.balance;
+        record.last_ack_response = client.last_ack_response;
+        out.push_back(record);
+    });
+}
 
-int ServerDatabase::addTransaction_unsafe(const string& origin_ip, int req_id, const string& destination_ip, uint32_t amount) {
-    int tx_id = next_transaction_id.fetch_add(1);
+void ServerDatabase::restoreShard(size_t index, const SnapshotClient* clients, const SnapshotShardHeader& header) {
+    ClientShard& shard = client_shards[index];
+    WriteGuard write_lock(shard.lock);
 
-    transaction_history.emplace_back(tx_id, origin_ip, req_id, destination_ip, amount);
+    shard.clients.reserve(shard.clients.size() + header.num_clients);
 
-    return tx_id;
+    uint64_t balance_sum = 0;
+    for (uint64_t i = 0; i < header.num_clients; ++i) {
+        Client* client = shard.clients.insert(clients[i].addr);
+        if (client == nullptr) continue;
+
+        {
+            ClientWriteGuard record(client);
+            client->last_req = clients[i].last_req;
+            client->balance = clients[i].balance;
+            client->last_ack_response = clients[i].last_ack_response;
+        }
+        balance_sum += client->balance;
+    }
+
+    shard.balance_sum.store(balance_sum, memory_order_relaxed);
+    shard.num_transactions.store(header.num_transactions, memory_order_relaxed);
+    shard.total_transferred.store(header.total_transferred, memory_order_relaxed);
+    shard.restored_lsn = header.cut_lsn;
+
+    // O histórico anterior ao snapshot não é guardado, só contado
+    WriteGuard history_lock(transaction_history_lock);
+    history_base_transactions += header.num_transactions;
+    history_base_transferred += header.total_transferred;
+    next_transaction_id.fetch_add((int)header.num_transactions);
 }
 
-/* Tabela de Resumo Bancário */
+void ServerDatabase::captureSyncState(vector<ReplicationSyncClient>& out, uint64_t& num_transactions,
+                                      uint64_t& total_transferred) const {
+    readLockAllShards();
+
+    num_transactions = 0;
+    total_transferred = 0;
+    out.clear();
+    for (size_t i = 0; i < CLIENT_TABLE_SHARDS; ++i) {
+        const ClientShard& shard = client_shards[i];
+        num_transactions += shard.num_transactions.load(memory_order_relaxed);
+        total_transferred += shard.total_transferred.load(memory_order_relaxed);
+
+        shard.clients.forEach([&](const Client& client) {
+            ReplicationSyncClient record;
+            record.addr = client.addr;
+            record.last_req = client.last_req;
+            record.balance = client.balance;
+            record.ack_seqn = client.last_ack_response.seqn;
+            record.ack_balance = client.last_ack_response.ack.new_balance;
+            record.ack_dest_addr = client.last_ack_response.ack.dest_addr;
+            record.ack_value = client.last_ack_response.ack.value;
+            out.push_back(record);
+        });
+    }
 
-// Leitura
-BankSummary ServerDatabase::getBankSummary() const {
-    ReadGuard read_lock(bank_summary_lock);
-    
-    return bank_summary;
+    unlockAllShards();
 }
 
-// Escrita / Leitura
-void ServerDatabase::updateBankSummary_unsafe() {
-    bank_summary.num_transactions = transaction_history.size();
-    
-    bank_summary.total_transferred = 0;
-    for (const auto& tx : transaction_history) {
-        bank_summary.total_transferred += tx.amount;
+void ServerDatabase::installSyncState(const vector<ReplicationSyncClient>& clients, uint64_t num_transactions,
+                                      uint64_t total_transferred) {
+    const uint64_t all_shards = ~0ull >> (64 - CLIENT_TABLE_SHARDS);
+    lockShards_unsafe(all_shards);
+
+    for (const auto& synced : clients) {
+        if (findClient_unsafe(synced.addr) == nullptr) insertClient_unsafe(synced.addr);
+        Client* client = findClient_unsafe(synced.addr);
+        if (client == nullptr) continue;
+
+        ClientWriteGuard record(client);
+        client->last_req = synced.last_req;
+        client->balance = synced.balance;
+        memset(&client->last_ack_response, 0, sizeof(Packet));
+        client->last_ack_response.type = PKT_REQUEST_ACK;
+        client->last_ack_response.seqn = synced.ack_seqn;
+        client->last_ack_response.ack.new_balance = synced.ack_balance;
+        client->last_ack_response.ack.dest_addr = synced.ack_dest_addr;
+        client->last_ack_response.ack.value = synced.ack_value;
     }
-    
-    bank_summary.total_balance = 0;
-    for (const auto& pair : client_table) {
-        bank_summary.total_balance += pair.second.balance;
+
+    // Totais do líder (na partição 0: o BankSummary só usa a soma); saldos recontados
+    for (size_t i = 0; i < CLIENT_TABLE_SHARDS; ++i) {
+        ClientShard& shard = client_shards[i];
+        uint64_t balance_sum = 0;
+        shard.clients.forEach([&](const Client& client) { balance_sum += client.balance; });
+        shard.balance_sum.store(balance_sum, memory_order_relaxed);
+        shard.num_transactions.store(i == 0 ? num_transactions : 0, memory_order_relaxed);
+        shard.total_transferred.store(i == 0 ? total_transferred : 0, memory_order_relaxed);
     }
+
+    {
+        WriteGuard history_lock(transaction_history_lock);
+        transaction_history.clear();
+        history_base_transactions = num_transactions;
+        history_base_transferred = total_transferred;
+        next_transaction_id.store((int)num_transactions);
+    }
+
+    unlockShards_unsafe(all_shards);
+
+#ifdef PIX_DEBUG
+    verifyBankSummary();
+#endif
 }
 
-// Escrita / Leitura
-void ServerDatabase::updateBankSummary() {
-    ReadGuard client_lock(client_table_lock);
+bool ServerDatabase::applyLogRecord(const WalRecord& record) {
+    size_t orig_shard = shardIndex(record.origin_addr);
+    bool apply_origin = record.lsn > client_shards[orig_shard].restored_lsn;
+
+    switch (record.type) {
+    case WAL_NEW_CLIENT:
+        return apply_origin && addClient(record.origin_addr);
+    case WAL_QUERY:
+        if (apply_origin) recordQuery(record.origin_addr, record.req_id, record.balance_origin);
+        return apply_origin;
+    case WAL_LAST_REQ:
+        return apply_origin && updateClientLastReq(record.origin_addr, record.req_id);
+    case WAL_TRANSFER:
+        break;
+    default:
+        return false;
+    }
+
+    // Origem e destino podem ter sido copiados em momentos diferentes do snapshot
+    size_t dest_shard = shardIndex(record.dest_addr);
+    bool apply_dest = record.lsn > client_shards[dest_shard].restored_lsn;
+    if (!apply_origin && !apply_dest) return false;
+
+    lockPair_unsafe(orig_shard, dest_shard);
+
+    Client* orig = findClient_unsafe(record.origin_addr);
+    Client* dest = findClient_unsafe(record.dest_addr);
+
+    if (orig == nullptr || dest == nullptr) {
+        unlockPair_unsafe(orig_shard, dest_shard);
+        PIX_LOG_WARN(LOG_CAT_STORAGE, "Transaction log references unknown client.");
+        return false;
+    }
+
+    applyTransferState_unsafe(orig_shard, orig, dest_shard, dest, record.req_id, record.amount,
+                              record.balance_origin, record.balance_dest, apply_origin, apply_dest);
+
+    unlockPair_unsafe(orig_shard, dest_shard);
+    return true;
+}
+
+/* Tabela de Resumo Bancário */
+
+// Leitura: soma as parciais sem travar nada. Cada contador é consistente,
+// mas o conjunto pode refletir um commit "no meio" (aceitável para exibição).
+BankSummary ServerDatabase::getBankSummary() const {
+    uint64_t num_transactions = 0;
+    uint64_t total_transferred = 0;
+    uint64_t total_balance = 0;
+
+    for (const auto& shard : client_shards) {
+        num_transactions += shard.num_transactions.load(memory_order_relaxed);
+        total_transferred += shard.total_transferred.load(memory_order_relaxed);
+        total_balance += shard.balance_sum.load(memory_order_relaxed);
+    }
+
+    BankSummary summary;
+    summary.num_transactions = (int)num_transactions;
+    summary.total_transferred = (uint32_t)total_transferred;
+    summary.total_balance = (uint32_t)total_balance;
+    return summary;
+}
+
+// Verificação lenta: varre histórico e clientes com todas as partições travadas
+// (nenhum commit em andamento), então as parciais devem bater exatamente.
+bool ServerDatabase::verifyBankSummary() const {
+    readLockAllShards();
     ReadGuard transaction_lock(transaction_history_lock);
-    WriteGuard summary_lock(bank_summary_lock);
 
-    bank_summary.num_transactions = transaction_history.size();
-    
-    bank_summary.total_transferred = 0;
+    uint64_t expected_transferred = 0;
     for (const auto& tx : transaction_history) {
-        bank_summary.total_transferred += tx.amount;
+        expected_transferred += tx.amount;
     }
-    
-    bank_summary.total_balance = 0;
-    for (const auto& pair : client_table) {
-        bank_summary.total_balance += pair.second.balance;
+
+    bool ok = true;
+    uint64_t counted_transactions = 0;
+    uint64_t counted_transferred = 0;
+
+    for (size_t i = 0; i < CLIENT_TABLE_SHARDS; ++i) {
+        const ClientShard& shard = client_shards[i];
+
+        uint64_t expected_balance = 0;
+        shard.clients.forEach([&](const Client& client) { expected_balance += client.balance; });
+
+        if (expected_balance != shard.balance_sum.load(memory_order_relaxed)) {
+            PIX_LOG_ERROR(LOG_CAT_STORAGE, "BankSummary mismatch: shard %zu balance_sum %llu != rescan %llu", i,
+                          (unsigned long long)shard.balance_sum.load(), (unsigned long long)expected_balance);
+            ok = false;
+        }
+
+        counted_transactions += shard.num_transactions.load(memory_order_relaxed);
+        counted_transferred += shard.total_transferred.load(memory_order_relaxed);
+    }
+
+    // Transações restauradas de um snapshot entram nos contadores, mas não no histórico
+    counted_transactions -= history_base_transactions;
+    counted_transferred -= history_base_transferred;
+
+    if (counted_transactions != transaction_history.size() || counted_transferred != expected_transferred) {
+        PIX_LOG_ERROR(LOG_CAT_STORAGE, "BankSummary mismatch: counters %llu/%llu != rescan %zu/%llu",
+                      (unsigned long long)counted_transactions, (unsigned long long)counted_transferred,
+                      transaction_history.size(), (unsigned long long)expected_transferred);
+        ok = false;
     }
+
+    unlockAllShards();
+    return ok;
 }
 
 uint32_t ServerDatabase::getTotalBalance() const {
-    ReadGuard read_lock(client_table_lock);
+    readLockAllShards();
 
     uint32_t total = 0;
-    for (const auto& pair : client_table) {
-        total += pair.second.balance;
+    for (const auto& shard : client_shards) {
+        shard.clients.forEach([&](const Client& client) { total += client.balance; });
     }
 
+    unlockAllShards();
     return total;
 }
 
-void ServerDatabase::forceClientBalance(const string& ip, uint32_t new_balance) {
-    WriteGuard lock(client_table_lock);
-    auto it = client_table.find(ip);
-    if (it != client_table.end()) {
-        it->second.balance = new_balance; // Sobrescreve sem validar
+void ServerDatabase::forceClientBalance(uint32_t addr, uint32_t new_balance) {
+    ClientShard& shard = shardFor(addr);
+    WriteGuard lock(shard.lock);
+
+    Client* client = findClient_unsafe(addr);
+    if (client != nullptr) {
+        addToCounter(shard.balance_sum, (int64_t)new_balance - client->balance);
+        ClientWriteGuard record(client);
+        client->balance = new_balance; // Sobrescreve sem validar
     }
-}
\ No newline at end of file
+}
@@ -7,47 +7,43 @@ void ServerDiscovery::sendDiscoveryAck(int sockfd, const struct sockaddr_in& cli
     discovery_ack.type = PKT_DISCOVER_ACK;
     discovery_ack.seqn = 0; 
     
-    ssize_t sent_bytes = sendto(sockfd, (const char*)&discovery_ack, sizeof(Packet), 0, 
-                       (const struct sockaddr *) &client_addr, clilen);
+    ssize_t sent_bytes = sendDatagram(sockfd, discovery_ack, client_addr, clilen);
 
     if (sent_bytes < 0) {
-        log_message("ERROR on sendto discovery ACK");
+        PIX_LOG_ERROR(LOG_CAT_DISCOVERY, "ERROR on sendto discovery ACK");
     }
 }
 
 void ServerDiscovery::handleDiscovery(const Packet& packet, const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd) {
     
-    char client_ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-    string client_key = string(client_ip);
-    
-    sendDiscoveryAck(sockfd, client_addr, clilen);
+    uint32_t client_key = client_addr.sin_addr.s_addr;
 
-    // [NOVO] Replica a criação do cliente para os Backups
+    // Aplica localmente (Líder). Cliente novo: a criação entra no fluxo de
+    // replicação antes do ACK da descoberta, então nos backups ela vem antes de
+    // qualquer transferência dele (que só chega depois, com índice maior).
     // Se falhar a replicação, tecnicamente deveríamos falhar a descoberta,
     // mas para simplificar, vamos apenas logar o erro.
-    bool replicated = replication_manager.replicateNewClient(client_key);
-    
-    if (!replicated) {
-        log_message("AVISO: Falha ao replicar novo cliente para backups.");
+    if (server_db.addClient(client_key)) {
+        replication_manager.replicateNewClient(client_key, [](bool replicated) {
+            if (!replicated) {
+                PIX_LOG_WARN(LOG_CAT_DISCOVERY, "AVISO: Falha ao replicar novo cliente para backups.");
+            }
+        });
     }
 
-    // Aplica localmente (Líder)
-    server_db.addClient(client_key);
-    server_db.updateBankSummary();
+    sendDiscoveryAck(sockfd, client_addr, clilen);
 }
 
 void ServerDiscovery::sendServerBroadcast(int sockfd, int my_id, int my_replica_port) {
     // 1. Habilita Broadcast no socket
     int broadcastEnable = 1;
     if (setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, &broadcastEnable, sizeof(broadcastEnable)) < 0) {
-        log_message("ERROR setting socket to broadcast mode");
+        PIX_LOG_ERROR(LOG_CAT_DISCOVERY, "ERROR setting socket to broadcast mode");
         return;
     }
 
     // 2. Monta o pacote
     Packet pkt;
-    memset(&pkt, 0, sizeof(Packet));
     pkt.type = PKT_SERVER_DISCOVER;
     pkt.seqn = 0;
     pkt.server_discovery.id = my_id;
@@ -61,12 +57,12 @@ void ServerDiscovery::sendServerBroadcast(int sockfd, int my_id, int my_replica_
     broadcast_addr.sin_addr.s_addr = htonl(INADDR_BROADCAST);
 
     // 4. Envia
-    ssize_t sent = sendto(sockfd, &pkt, sizeof(Packet), 0, 
+    ssize_t sent = sendPacket(sockfd, pkt, 
                          (struct sockaddr*)&broadcast_addr, sizeof(broadcast_addr));
 
     if (sent < 0) {
-        log_message("ERROR sending server discovery broadcast");
+        PIX_LOG_ERROR(LOG_CAT_DISCOVERY, "ERROR sending server discovery broadcast");
     } else {
-        log_message("Sent SERVER_DISCOVERY broadcast.");
+        PIX_LOG_DEBUG(LOG_CAT_DISCOVERY, "Sent SERVER_DISCOVERY broadcast.");
     }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "server/election.h"
 #include "common/utils.h"
+#include "common/wire.h"
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <cstring>
@@ -20,7 +21,7 @@ void ElectionManager::init(int socket, int id, bool is_leader) {
         current_leader_id = 0; // Desconhecido inicialmente. Servidores começam como follower.
     }
     
-    log_message(("ElectionManager initialized for server ID " + to_string(my_id)).c_str());
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "ElectionManager initialized for server ID %d", my_id);
 }
 
 void ElectionManager::addReplica(int id, string ip, int port) {
@@ -33,7 +34,7 @@ void ElectionManager::addReplica(int id, string ip, int port) {
             // Já conhecemos esse servidor, apenas reativa ele.
             if (!replica.active) {
                 replica.active = true;
-                log_message(("Reactivated known replica ID " + to_string(id)).c_str());
+                PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Reactivated known replica ID %d", id);
             }
             return;
         }
@@ -53,16 +54,16 @@ void ElectionManager::addReplica(int id, string ip, int port) {
     
     replicas.push_back(replica);
     
-    log_message(("Added replica ID " + to_string(id) + " at " + ip + ":" + to_string(port)).c_str());
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Added replica ID %d at %s:%d", id, ip.c_str(), port);
 }
 
 void ElectionManager::setLeaderChangeCallback(ElectionCallback callback) {
     on_leader_change = callback;
 }
 
-void ElectionManager::start() {
+void ElectionManager::start(EventLoop& event_loop) {
     if (running) {
-        log_message("ElectionManager already running.");
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "ElectionManager already running.");
         return;
     }
     
@@ -78,7 +79,7 @@ void ElectionManager::start() {
         }
         lowest_id = my_id;
     } catch (const exception& e) {
-        log_message(("ERROR: " + string(e.what())).c_str());
+        PIX_LOG_ERROR(LOG_CAT_ELECTION, "ERROR: %s", e.what());
         return;
     }
 
@@ -95,14 +96,17 @@ void ElectionManager::start() {
         state = FOLLOWER;
         lock_guard<mutex> lock(heartbeat_mutex);
         last_heartbeat_from_leader = steady_clock::now();
-        log_message(("Starting as FOLLOWER. Expected leader: " + to_string(lowest_id)).c_str());
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Starting as FOLLOWER. Expected leader: %d", lowest_id);
     }
     
-    // Inicia threads de hearbeat e de escuta de eleição
-    heartbeat_thread = thread(&ElectionManager::heartbeatLoop, this);
-    monitor_thread = thread(&ElectionManager::monitorLoop, this);
+    // Timers de heartbeat e de monitoramento da eleição (a primeira volta é imediata)
+    loop = &event_loop;
+    heartbeat_timer = loop->addTimer([this] { onHeartbeatTimer(); });
+    monitor_timer = loop->addTimer([this] { onMonitorTimer(); });
+    loop->armTimer(heartbeat_timer, microseconds(0), milliseconds(HEARTBEAT_INTERVAL_MS));
+    loop->armTimer(monitor_timer, microseconds(0), milliseconds(ELECTION_MONITOR_MS));
     
-    log_message("ElectionManager started.");
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "ElectionManager started.");
 }
 
 void ElectionManager::stop() {
@@ -110,88 +114,88 @@ void ElectionManager::stop() {
     
     running = false;
     
-    if (heartbeat_thread.joinable()) {
-        heartbeat_thread.join();
-    }
-    if (monitor_thread.joinable()) {
-        monitor_thread.join();
+    if (loop != nullptr) {
+        loop->removeTimer(heartbeat_timer);
+        loop->removeTimer(monitor_timer);
+        loop = nullptr;
     }
     
-    log_message("ElectionManager stopped.");
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "ElectionManager stopped.");
 }
 
-// LOOPS DE THREADS
-void ElectionManager::heartbeatLoop() {
-    while (running) {
-        if (state == LEADER) {
-            // Líder envia heartbeats para todos
-            lock_guard<recursive_mutex> lock(replicas_mutex);;
-            
-            Packet hb_packet;
-            memset(&hb_packet, 0, sizeof(Packet));
-            hb_packet.type = PKT_HEARTBEAT;
-            hb_packet.heartbeat.sender_id = my_id;
-            hb_packet.heartbeat.sender_addr = my_addr;
-            hb_packet.heartbeat.sender_port = my_port;
-            hb_packet.heartbeat.is_primary = 1;
-            
-            for (auto& replica : replicas) {
-                ssize_t sent = sendto(sockfd, &hb_packet, sizeof(Packet), 0,
-                                     (struct sockaddr*)&replica.addr, sizeof(replica.addr));
-                if (sent < 0) {
-                    log_message(("Failed to send heartbeat to replica " + to_string(replica.id)).c_str());
-                }
-            }
+// TIMERS
+void ElectionManager::onHeartbeatTimer() {
+    if (state != LEADER) return;
+
+    // Líder envia heartbeats para todos
+    lock_guard<recursive_mutex> lock(replicas_mutex);
+
+    Packet hb_packet;
+    hb_packet.type = PKT_HEARTBEAT;
+    hb_packet.heartbeat.sender_id = my_id;
+    hb_packet.heartbeat.sender_addr = my_addr;
+    hb_packet.heartbeat.sender_port = my_port;
+    hb_packet.heartbeat.is_primary = 1;
+
+    for (auto& replica : replicas) {
+        ssize_t sent = sendPacket(sockfd, hb_packet,
+                             (struct sockaddr*)&replica.addr, sizeof(replica.addr));
+        if (sent < 0) {
+            PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Failed to send heartbeat to replica %d", replica.id);
         }
-        
-        this_thread::sleep_for(milliseconds(HEARTBEAT_INTERVAL_MS));
     }
 }
 
 // Monitora heartbeats, pode inciar eleição e se declara líder de acordo.
-void ElectionManager::monitorLoop() {    
-    while (running) {
-        if (state == FOLLOWER) {
-            steady_clock::time_point last_heartbeat;
-            {
-                lock_guard<mutex> lock(heartbeat_mutex);
-                last_heartbeat = last_heartbeat_from_leader;
-            }
-            
-            auto elapsed = duration_cast<milliseconds>(steady_clock::now() - last_heartbeat).count();
+void ElectionManager::onMonitorTimer() {
+    auto now = steady_clock::now();
 
-            if (elapsed > LEADER_TIMEOUT_MS) {
-                log_message("Leader timeout detected. Starting election...");
-                startElection();
-                last_heartbeat_from_leader = steady_clock::now(); // Reset
-            }
-        } else if (state == CANDIDATE) {
-            if (election_in_progress) {
-                // Timeout de eleição, assume vitória
-                this_thread::sleep_for(milliseconds(ELECTION_TIMEOUT_MS));
-
-                if (election_in_progress) {
-                    log_message("Election timeout. No lower process responded. Becoming leader.");
-                    becomeLeader();
-                }
-            }
-        } else {
-            // LEADER - reseta timeout
-            last_heartbeat_from_leader = steady_clock::now();
+    if (state == FOLLOWER) {
+        steady_clock::time_point last_heartbeat;
+        {
+            lock_guard<mutex> lock(heartbeat_mutex);
+            last_heartbeat = last_heartbeat_from_leader;
         }
-        
-        this_thread::sleep_for(milliseconds(500));
+
+        auto elapsed = duration_cast<milliseconds>(now - last_heartbeat).count();
+
+        if (elapsed > LEADER_TIMEOUT_MS) {
+            PIX_LOG_INFO(LOG_CAT_ELECTION, "Leader timeout detected. Starting election...");
+            startElection();
+            lock_guard<mutex> lock(heartbeat_mutex);
+            last_heartbeat_from_leader = steady_clock::now(); // Reset
+        }
+    } else if (state == CANDIDATE) {
+        steady_clock::time_point started;
+        {
+            lock_guard<mutex> lock(heartbeat_mutex);
+            started = election_started;
+        }
+
+        // Timeout de eleição, assume vitória
+        if (election_in_progress && now - started >= milliseconds(ELECTION_TIMEOUT_MS)) {
+            PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Election timeout. No lower process responded. Becoming leader.");
+            becomeLeader();
+        }
+    } else {
+        // LEADER - reseta timeout
+        lock_guard<mutex> lock(heartbeat_mutex);
+        last_heartbeat_from_leader = now;
     }
 }
 
 // ELEIÇÃO COM ALGORITMO VALENTÃO
 void ElectionManager::startElection() {
     if (election_in_progress) {
-        log_message("Election already in progress. Ignoring.");
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Election already in progress. Ignoring.");
         return;
     }
     
-    log_message("Starting election...");
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Starting election...");
+    {
+        lock_guard<mutex> lock(heartbeat_mutex);
+        election_started = steady_clock::now();
+    }
     state = CANDIDATE;
     election_in_progress = true;
     
@@ -211,7 +215,7 @@ void ElectionManager::startElection() {
     
     if (!found_lower) {
         // Não há processos maiores, torno-me líder imediatamente
-        log_message("No lower processes found. Becoming leader immediately.");
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "No lower processes found. Becoming leader immediately.");
         becomeLeader();
     }
 }
@@ -223,25 +227,24 @@ void ElectionManager::sendElectionMsg(int target_id) {
                       [target_id](const ReplicaInfo& r) { return r.id == target_id; });
     
     if (it == replicas.end()) {
-        log_message(("Replica ID " + to_string(target_id) + " not found.").c_str());
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Replica ID %d not found.", target_id);
         return;
     }
     
     Packet election_packet;
-    memset(&election_packet, 0, sizeof(Packet));
     election_packet.type = PKT_ELECTION;
     election_packet.election.candidate_id = my_id;
     election_packet.election.candidate_addr = my_addr;
     election_packet.election.candidate_port = my_port;
     
-    ssize_t sent = sendto(sockfd, &election_packet, sizeof(Packet), 0,
+    ssize_t sent = sendPacket(sockfd, election_packet,
                          (struct sockaddr*)&it->addr, sizeof(it->addr));
     
     if (sent < 0) {
-        log_message(("Failed to send ELECTION to " + to_string(target_id)).c_str());
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Failed to send ELECTION to %d", target_id);
         markReplicaDead(target_id);
     } else {
-        log_message(("Sent ELECTION to replica " + to_string(target_id)).c_str());
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Sent ELECTION to replica %d", target_id);
     }
 }
 
@@ -254,19 +257,18 @@ void ElectionManager::sendOkMsg(int target_id) {
     if (it == replicas.end()) return;
     
     Packet ok_packet;
-    memset(&ok_packet, 0, sizeof(Packet));
     ok_packet.type = PKT_ELECTION_OK;
     ok_packet.election_ok.responder_id = my_id;
     ok_packet.election_ok.responder_addr = my_addr;
     ok_packet.election_ok.responder_port = my_port;
     
-    ssize_t sent = sendto(sockfd, &ok_packet, sizeof(Packet), 0,
+    ssize_t sent = sendPacket(sockfd, ok_packet,
                          (struct sockaddr*)&it->addr, sizeof(it->addr));
     
     if (sent < 0) {
-        log_message(("Failed to send OK to " + to_string(target_id)).c_str());
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Failed to send OK to %d", target_id);
     } else {
-        log_message(("Sent ELECTION_OK to replica " + to_string(target_id)).c_str());
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Sent ELECTION_OK to replica %d", target_id);
     }
 }
 
@@ -274,7 +276,6 @@ void ElectionManager::announceCoordinator() {
     lock_guard<recursive_mutex> lock(replicas_mutex);;
     
     Packet coord_packet;
-    memset(&coord_packet, 0, sizeof(Packet));
     coord_packet.type = PKT_COORDINATOR;
     coord_packet.coordinator.coordinator_id = my_id;
     coord_packet.coordinator.coordinator_addr = my_addr;
@@ -282,14 +283,14 @@ void ElectionManager::announceCoordinator() {
     
     // Envia para todos (broadcast)
     for (auto& replica : replicas) {
-        ssize_t sent = sendto(sockfd, &coord_packet, sizeof(Packet), 0,
+        ssize_t sent = sendPacket(sockfd, coord_packet,
                              (struct sockaddr*)&replica.addr, sizeof(replica.addr));
         if (sent < 0) {
-            log_message(("Failed to announce COORDINATOR to " + to_string(replica.id)).c_str());
+            PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Failed to announce COORDINATOR to %d", replica.id);
         }
     }
     
-    log_message("Announced COORDINATOR to all replicas.");
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Announced COORDINATOR to all replicas.");
 }
 
 void ElectionManager::becomeLeader() {
@@ -299,7 +300,7 @@ void ElectionManager::becomeLeader() {
     current_leader_id = my_id;
     election_in_progress = false;
     
-    log_message_core(("This instance is now the LEADER (ID " + to_string(my_id) + ")").c_str());
+    PIX_LOG_INFO(LOG_CAT_ELECTION, "This instance is now the LEADER (ID %d)", my_id);
 
     announceCoordinator();
     // Notifica via callback
@@ -311,7 +312,7 @@ void ElectionManager::becomeLeader() {
 void ElectionManager::becomeFollower(int leader_id) {
     if (state == FOLLOWER && current_leader_id == leader_id) return;
     
-    log_message(("Becoming FOLLOWER. New leader: " + to_string(leader_id)).c_str());
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Becoming FOLLOWER. New leader: %d", leader_id);
     state = FOLLOWER;
     current_leader_id = leader_id;
     election_in_progress = false;
@@ -341,7 +342,7 @@ void ElectionManager::markReplicaDead(int replica_id) {
     
     if (it != replicas.end()) {
         it->active = false;
-        log_message(("Marked replica " + to_string(replica_id) + " as DEAD.").c_str());
+        PIX_LOG_INFO(LOG_CAT_ELECTION, "Marked replica %d as DEAD.", replica_id);
     }
 }
 
@@ -349,13 +350,13 @@ void ElectionManager::markReplicaDead(int replica_id) {
 void ElectionManager::handleElectionMessage(const Packet& packet, const struct sockaddr_in& sender) {
     int candidate_id = packet.election.candidate_id;
     
-    log_message(("Received ELECTION from " + to_string(candidate_id)).c_str());
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Received ELECTION from %d", candidate_id);
     
     // Servidor candidato pior do que esse
     if (my_id < candidate_id) {
         if (state == LEADER) { 
              // Já é líder e um subordinado tentou eleição, manda COORDINATOR novamente.
-             log_message(("Subordinate " + to_string(candidate_id) + " tried election. Re-asserting authority.").c_str());
+             PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Subordinate %d tried election. Re-asserting authority.", candidate_id);
              announceCoordinator(); 
         } else {
              // Responde OK e propaga Election para tentar virar líder
@@ -368,11 +369,11 @@ void ElectionManager::handleElectionMessage(const Packet& packet, const struct s
 void ElectionManager::handleOkMessage(const Packet& packet, const struct sockaddr_in& sender) {
     int responder_id = packet.election_ok.responder_id;
     
-    log_message(("Received ELECTION_OK from " + to_string(responder_id)).c_str());
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Received ELECTION_OK from %d", responder_id);
     
     // Alguém com id menor respondeu, então não é líder
     if (state == CANDIDATE) {
-        log_message("Lower process responded. Stepping down from candidacy.");
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Lower process responded. Stepping down from candidacy.");
         state = FOLLOWER;
         election_in_progress = false;
     }
@@ -381,7 +382,7 @@ void ElectionManager::handleOkMessage(const Packet& packet, const struct sockadd
 void ElectionManager::handleCoordinatorMessage(const Packet& packet, const struct sockaddr_in& sender) {
     int coordinator_id = packet.coordinator.coordinator_id;
     
-    log_message(("Received COORDINATOR announcement. New leader: " + to_string(coordinator_id)).c_str());
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Received COORDINATOR announcement. New leader: %d", coordinator_id);
     
     if (coordinator_id != my_id) {
         becomeFollower(coordinator_id);
@@ -400,7 +401,7 @@ void ElectionManager::handleHeartbeatMessage(const Packet& packet, const struct
 
         // Atualiza líder e marca como ativo
         if (current_leader_id != sender_id) {
-            log_message(("Received heartbeat from new leader: " + to_string(sender_id)).c_str());
+            PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Received heartbeat from new leader: %d", sender_id);
             becomeFollower(sender_id);
         }
         
@@ -414,14 +415,13 @@ void ElectionManager::handleHeartbeatMessage(const Packet& packet, const struct
         
         // Envia ACK
         Packet ack_packet;
-        memset(&ack_packet, 0, sizeof(Packet));
         ack_packet.type = PKT_HEARTBEAT_ACK;
         ack_packet.heartbeat.sender_id = my_id;
         ack_packet.heartbeat.sender_addr = my_addr;
         ack_packet.heartbeat.sender_port = my_port;
         ack_packet.heartbeat.is_primary = (state == LEADER) ? 1 : 0;
         
-        sendto(sockfd, &ack_packet, sizeof(Packet), 0,
+        sendPacket(sockfd, ack_packet,
                (struct sockaddr*)&sender, sizeof(sender));
     }
 }
@@ -440,6 +440,6 @@ void ElectionManager::handleHeartbeatAck(const Packet& packet, const struct sock
 
 // Eleição manual para teste.
 void ElectionManager::triggerElection() {
-    log_message("Manual election trigger requested.");
+    PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Manual election trigger requested.");
     startElection();
 }
\ No newline at end of file
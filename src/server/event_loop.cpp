@@ -0,0 +1,141 @@
+#include "server/event_loop.h"
+#include "common/utils.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+
+EventLoop event_loop;
+
+EventLoop::EventLoop() : _stopped(false) {
+    _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_epoll_fd < 0 || _wake_fd < 0) {
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR creating event loop");
+        return;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = _wake_fd;
+    epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fd, &ev);
+}
+
+EventLoop::~EventLoop() {
+    // Os timers são do laço; os sockets observados são de quem chamou watch()
+    for (auto& entry : _watches) {
+        if (entry.second->timer) close(entry.first);
+    }
+    if (_wake_fd >= 0) close(_wake_fd);
+    if (_epoll_fd >= 0) close(_epoll_fd);
+}
+
+void EventLoop::add(int fd, bool timer, EventHandler handler) {
+    auto entry = make_shared<Watch>();
+    entry->fd = fd;
+    entry->timer = timer;
+    entry->handler = move(handler);
+
+    {
+        lock_guard<mutex> lk(_mutex);
+        _watches[fd] = entry;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR adding descriptor to the event loop");
+    }
+}
+
+void EventLoop::watch(int fd, EventHandler on_readable) {
+    add(fd, false, move(on_readable));
+}
+
+void EventLoop::unwatch(int fd) {
+    epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    lock_guard<mutex> lk(_mutex);
+    _watches.erase(fd);
+}
+
+int EventLoop::addTimer(EventHandler on_expire) {
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer < 0) {
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR creating timer");
+        return -1;
+    }
+    add(timer, true, move(on_expire));
+    return timer;
+}
+
+static struct timespec toTimespec(chrono::microseconds us) {
+    struct timespec ts;
+    ts.tv_sec = us.count() / 1000000;
+    ts.tv_nsec = (us.count() % 1000000) * 1000;
+    return ts;
+}
+
+void EventLoop::armTimer(int timer, chrono::microseconds after, chrono::microseconds period) {
+    struct itimerspec spec;
+    spec.it_value = toTimespec(after);
+    spec.it_interval = toTimespec(period);
+
+    // it_value zerado desarmaria o timer: "agora" vira 1ns
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) spec.it_value.tv_nsec = 1;
+
+    timerfd_settime(timer, 0, &spec, nullptr);
+}
+
+void EventLoop::disarmTimer(int timer) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    timerfd_settime(timer, 0, &spec, nullptr);
+}
+
+void EventLoop::removeTimer(int timer) {
+    unwatch(timer);
+    close(timer);
+}
+
+void EventLoop::run() {
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+
+    while (!_stopped) {
+        int n = epoll_wait(_epoll_fd, events, EVENT_LOOP_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno != EINTR) PIX_LOG_ERROR(LOG_CAT_NET, "ERROR on epoll_wait");
+            continue;
+        }
+
+        for (int i = 0; i < n && !_stopped; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == _wake_fd) continue;
+
+            shared_ptr<Watch> entry;
+            {
+                lock_guard<mutex> lk(_mutex);
+                auto it = _watches.find(fd);
+                if (it == _watches.end()) continue;  // Removido nesta volta
+                entry = it->second;
+            }
+
+            if (entry->timer) {
+                // Rearmado (ou desarmado) depois do epoll_wait: nada expirou
+                uint64_t expirations;
+                if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+            }
+            entry->handler();
+        }
+    }
+}
+
+void EventLoop::stop() {
+    _stopped = true;
+    uint64_t one = 1;
+    if (write(_wake_fd, &one, sizeof(one)) < 0) PIX_LOG_ERROR(LOG_CAT_NET, "ERROR waking the event loop");
+}
@@ -3,8 +3,201 @@
 #include "server/database.h"
 #include "common/utils.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 ServerInterface server_interface;
 
+// Registros formatados por rodada (limita a memória do lote e o atraso)
+#define LOG_DRAIN_BATCH 8192
+// Buffer de texto: cada registro vira no máximo ~200 bytes (linha + resumo)
+#define LOG_TEXT_BUFFER (64 * 1024)
+#define LOG_LINE_MAX 256
+// Medição inicial da frequência do contador
+#define LOG_CLOCK_CALIBRATION_MS 10
+
+// Anel SPSC de uma thread produtora. head só é escrito por ela e tail só pelo
+// consumidor, cada um na sua linha de cache.
+struct LogRing {
+    alignas(64) atomic<uint64_t> head{0};
+    uint64_t cached_tail = 0;  // última tail vista pelo produtor
+    alignas(64) atomic<uint64_t> tail{0};
+    alignas(64) atomic<uint64_t> dropped{0};
+    LogRecord records[LOG_RING_SIZE];
+};
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+// Contador de ciclos invariante da CPU (x86); nas demais arquiteturas, o
+// relógio monotônico em ns. Convertido para hora de parede só na formatação.
+static inline uint64_t readLogClock() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* === Formatação sem alocação === */
+
+static char* appendText(char* p, const char* text) {
+    while (*text) *p++ = *text++;
+    return p;
+}
+
+static char* appendU32(char* p, uint32_t v) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    while (n > 0) *p++ = digits[--n];
+    return p;
+}
+
+static char* appendU64(char* p, uint64_t v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    while (n > 0) *p++ = digits[--n];
+    return p;
+}
+
+// IPv4 em network byte order, como uint32ToIp (sem string)
+static char* appendAddr(char* p, uint32_t addr) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&addr);
+    for (int i = 0; i < 4; ++i) {
+        if (i > 0) *p++ = '.';
+        p = appendU32(p, bytes[i]);
+    }
+    return p;
+}
+
+// Converte o contador para hora de parede e guarda o texto do segundo atual
+class LogClock {
+private:
+    uint64_t _base_ticks;
+    uint64_t _base_mono_ns;
+    time_t _base_wall;
+    long _base_wall_ns;
+    double _ticks_per_ns;
+
+    time_t _cached_second;
+    char _cached_text[32];
+
+public:
+    LogClock() : _base_ticks(0), _base_mono_ns(0), _base_wall(0), _base_wall_ns(0), _ticks_per_ns(1), _cached_second(-1) {
+        _cached_text[0] = '\0';
+    }
+
+    void calibrate() {
+        struct timespec wall;
+        clock_gettime(CLOCK_REALTIME, &wall);
+        _base_ticks = readLogClock();
+        _base_mono_ns = monotonicNs();
+        _base_wall = wall.tv_sec;
+        _base_wall_ns = wall.tv_nsec;
+
+        this_thread::sleep_for(chrono::milliseconds(LOG_CLOCK_CALIBRATION_MS));
+        refine();
+    }
+
+    // A frequência é medida contra o relógio monotônico desde a base: quanto
+    // mais tempo passa, mais precisa
+    void refine() {
+        uint64_t ticks = readLogClock() - _base_ticks;
+        uint64_t ns = monotonicNs() - _base_mono_ns;
+        if (ns > 0 && ticks > 0) _ticks_per_ns = (double)ticks / ns;
+    }
+
+    // "YYYY-MM-DD HH:MM:SS" do instante do registro
+    const char* text(uint64_t ticks) {
+        int64_t delta_ticks = (int64_t)(ticks - _base_ticks);
+        int64_t ns = (int64_t)(delta_ticks / _ticks_per_ns) + _base_wall_ns;
+        time_t second = _base_wall + (time_t)(ns / 1000000000);
+        if (ns < 0) second -= 1;
+
+        if (second != _cached_second) {
+            struct tm tm {};
+            localtime_r(&second, &tm);
+            strftime(_cached_text, sizeof(_cached_text), "%Y-%m-%d %H:%M:%S", &tm);
+            _cached_second = second;
+        }
+        return _cached_text;
+    }
+};
+
+static char* appendSummary(char* p) {
+    BankSummary summary = server_db.getBankSummary();
+    p = appendText(p, "num_transactions ");
+    p = appendU64(p, (uint64_t)summary.num_transactions);
+    p = appendText(p, " total_transferred ");
+    p = appendU32(p, summary.total_transferred);
+    p = appendText(p, " total_balance ");
+    p = appendU32(p, summary.total_balance);
+    *p++ = '\n';
+    return p;
+}
+
+static char* formatRecord(char* p, const LogRecord& record, LogClock& clock) {
+    p = appendText(p, clock.text(record.tsc));
+    p = appendText(p, " client ");
+    p = appendAddr(p, record.origin_addr);
+
+    switch (record.type) {
+        case LOG_EVENT_BATCH:
+            p = appendText(p, " batch id_req ");
+            p = appendU32(p, record.seqn);
+            p = appendText(p, "..");
+            p = appendU32(p, record.last_seqn);
+            p = appendText(p, " applied ");
+            p = appendU32(p, record.value);
+            *p++ = '/';
+            p = appendU32(p, record.count);
+            p = appendText(p, " new_balance ");
+            p = appendU32(p, record.balance);
+            break;
+
+        case LOG_EVENT_DUPLICATE:
+            if (record.duplicate) p = appendText(p, " DUP!!");
+            [[fallthrough]];  // mesmo formato da requisição
+        default:
+            p = appendText(p, " id_req ");
+            p = appendU32(p, record.seqn);
+            p = appendText(p, " dest ");
+            p = appendAddr(p, record.dest_addr);
+            p = appendText(p, " value ");
+            p = appendU32(p, record.value);
+            break;
+    }
+    *p++ = '\n';
+
+    // Resumo atualizado depois de cada operação
+    return appendSummary(p);
+}
+
+/* === ServerInterface === */
+
 ServerInterface::ServerInterface() {}
 ServerInterface::~ServerInterface() { stop(); }
 
@@ -15,57 +208,180 @@ void ServerInterface::start() {
 }
 
 void ServerInterface::stop() {
-    if (!running_) return;
-    {
-        lock_guard<mutex> lk(m_);
-        running_ = false;
-    }
-    cv_.notify_all();
+    if (!running_.exchange(false)) return;
+    wakeConsumer();
     if (th_.joinable()) th_.join();
 }
 
-void ServerInterface::notifyUpdate(const string& logline) {
-    {
-        lock_guard<mutex> lk(m_);
-        if (!logline.empty()) msgs_.push(logline);
+LogRing* ServerInterface::localRing() {
+    thread_local LogRing* ring = nullptr;
+    thread_local bool registered = false;
+    if (registered) return ring;
+
+    lock_guard<mutex> lk(rings_mutex_);
+    size_t index = ring_count_.load(memory_order_relaxed);
+    if (index < LOG_MAX_RINGS) {
+        rings_[index].reset(new LogRing());
+        ring = rings_[index].get();
+        ring_count_.store(index + 1, memory_order_release);
+    }
+    registered = true;
+    return ring;
+}
+
+void ServerInterface::push(const LogRecord& record) {
+    LogRing* ring = localRing();
+    if (ring == nullptr) {
+        unregistered_drops_.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    uint64_t head = ring->head.load(memory_order_relaxed);
+    if (head - ring->cached_tail >= LOG_RING_SIZE) {
+        ring->cached_tail = ring->tail.load(memory_order_acquire);
+        if (head - ring->cached_tail >= LOG_RING_SIZE) {
+            ring->dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+    }
+
+    ring->records[head & (LOG_RING_SIZE - 1)] = record;
+    ring->head.store(head + 1, memory_order_release);
+
+    // Par do fence em run: ou a interface vê o registro, ou nós vemos a flag
+    atomic_thread_fence(memory_order_seq_cst);
+    if (consumer_waiting_.load(memory_order_relaxed)) wakeConsumer();
+}
+
+void ServerInterface::wakeConsumer() {
+    wake_seq_.fetch_add(1, memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wake_seq_), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Algum anel com registro ainda não lido (só a interface chama)
+bool ServerInterface::hasPending() const {
+    size_t count = ring_count_.load(memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        const LogRing& ring = *rings_[i];
+        if (ring.head.load(memory_order_acquire) != ring.tail.load(memory_order_relaxed)) return true;
     }
-    cv_.notify_one();
+    return false;
+}
+
+void ServerInterface::logRequest(uint32_t origin_addr, uint32_t seqn, uint32_t dest_addr, uint32_t value) {
+    LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.tsc = readLogClock();
+    record.type = LOG_EVENT_REQUEST;
+    record.origin_addr = origin_addr;
+    record.dest_addr = dest_addr;
+    record.seqn = seqn;
+    record.value = value;
+    push(record);
+}
+
+void ServerInterface::logDuplicate(uint32_t origin_addr, uint32_t seqn, uint32_t dest_addr, uint32_t value,
+                                   bool duplicate) {
+    LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.tsc = readLogClock();
+    record.type = LOG_EVENT_DUPLICATE;
+    record.duplicate = duplicate ? 1 : 0;
+    record.origin_addr = origin_addr;
+    record.dest_addr = dest_addr;
+    record.seqn = seqn;
+    record.value = value;
+    push(record);
+}
+
+void ServerInterface::logBatch(uint32_t origin_addr, uint32_t first_seqn, uint32_t last_seqn, uint32_t applied,
+                               uint16_t count, uint32_t balance) {
+    LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.tsc = readLogClock();
+    record.type = LOG_EVENT_BATCH;
+    record.count = count;
+    record.origin_addr = origin_addr;
+    record.seqn = first_seqn;
+    record.last_seqn = last_seqn;
+    record.value = applied;
+    record.balance = balance;
+    push(record);
 }
 
 void ServerInterface::run() {
+    LogClock clock;
+    clock.calibrate();
+
+    static char text[LOG_TEXT_BUFFER];
+    vector<LogRecord> batch;
+    batch.reserve(LOG_DRAIN_BATCH);
+    uint64_t dropped_reported = 0;
+
     // Mensagem inicial com dados do BankSummary (executada UMA vez na inicialização)
     {
-        auto summary = server_db.getBankSummary();
-        cout << get_timestamp_str()
-                  << " num_transactions " << summary.num_transactions
-                  << " total_transferred " << summary.total_transferred
-                  << " total_balance " << summary.total_balance
-                  << endl;
+        char* p = appendText(text, clock.text(readLogClock()));
+        *p++ = ' ';
+        p = appendSummary(p);
+        fwrite(text, 1, p - text, stdout);
+        fflush(stdout);
     }
 
-    unique_lock<mutex> lk(m_);
-    while (running_) {
-        cv_.wait(lk, [&]{ return !running_ || !msgs_.empty(); });
-        
-        while (!msgs_.empty()) {
-            auto line = msgs_.front(); msgs_.pop();
-            lk.unlock();
-
-            // Imprime linha de log (ex.: req, dup, etc.)
-            if (!line.empty()) {
-                ostringstream oss;
-                oss << get_timestamp_str() << " " << line;
-                cout << oss.str() << endl;
+    for (;;) {
+        // Lê 'running' antes de drenar: depois do stop, uma última rodada completa
+        bool running = running_.load(memory_order_acquire);
+
+        batch.clear();
+        uint64_t dropped = unregistered_drops_.load(memory_order_relaxed);
+        size_t count = ring_count_.load(memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) {
+            LogRing& ring = *rings_[i];
+            dropped += ring.dropped.load(memory_order_relaxed);
+
+            uint64_t tail = ring.tail.load(memory_order_relaxed);
+            uint64_t head = ring.head.load(memory_order_acquire);
+            while (tail != head && batch.size() < LOG_DRAIN_BATCH) {
+                batch.push_back(ring.records[tail & (LOG_RING_SIZE - 1)]);
+                tail++;
             }
+            ring.tail.store(tail, memory_order_release);
+        }
+
+        if (batch.empty() && dropped == dropped_reported) {
+            if (!running) break;
 
-            // Imprime resumo atualizado
-            auto summary = server_db.getBankSummary();
-            ostringstream summary_oss;
-            summary_oss << "num_transactions " << summary.num_transactions
-                       << " total_transferred " << summary.total_transferred
-                       << " total_balance " << summary.total_balance;
-            cout << summary_oss.str() << endl;
-            lk.lock();
+            // Lê a sequência antes de avisar: um wake depois disso a muda e o
+            // futex não dorme. Descartes sem registro novo saem no próximo.
+            uint32_t seq = wake_seq_.load(memory_order_acquire);
+            consumer_waiting_.store(true, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (!hasPending() && running_.load(memory_order_relaxed))
+                syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wake_seq_), FUTEX_WAIT_PRIVATE, seq, nullptr,
+                        nullptr, 0);
+            consumer_waiting_.store(false, memory_order_relaxed);
+            continue;
         }
+
+        // Cada anel já está em ordem; entre threads, ordena pelo instante
+        stable_sort(batch.begin(), batch.end(),
+                    [](const LogRecord& a, const LogRecord& b) { return a.tsc < b.tsc; });
+        clock.refine();
+
+        char* p = text;
+        for (const LogRecord& record : batch) {
+            if (p + LOG_LINE_MAX > text + sizeof(text)) {
+                fwrite(text, 1, p - text, stdout);
+                p = text;
+            }
+            p = formatRecord(p, record, clock);
+        }
+        if (dropped != dropped_reported) {
+            p = appendText(p, "log: ");
+            p = appendU64(p, dropped - dropped_reported);
+            p = appendText(p, " events dropped (ring full)\n");
+            dropped_reported = dropped;
+        }
+        fwrite(text, 1, p - text, stdout);
+        fflush(stdout);
     }
-}
\ No newline at end of file
+}
@@ -1,22 +1,24 @@
 #include "server/locks.h"
 
-// === RWLock ===
-#include <pthread.h>
-#include <stdexcept>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
 
-RWLock::RWLock() : _readers(0), _writers_waiting(0), _writer_active(false) {
+// === CondvarRWLock ===
+CondvarRWLock::CondvarRWLock() : _readers(0), _writers_waiting(0), _writer_active(false) {
     if (pthread_mutex_init(&_mutex, nullptr) != 0)
         throw runtime_error("Failed to initialize mutex");
     if (pthread_cond_init(&_cond, nullptr) != 0)
         throw runtime_error("Failed to initialize condition variable");
 }
 
-RWLock::~RWLock() {
+CondvarRWLock::~CondvarRWLock() {
     pthread_mutex_destroy(&_mutex);
     pthread_cond_destroy(&_cond);
 }
 
-void RWLock::read_lock() {
+void CondvarRWLock::read_lock() {
     pthread_mutex_lock(&_mutex);
 
     // Espera até que não haja escritor ativo ou esperando
@@ -28,7 +30,7 @@ void RWLock::read_lock() {
     pthread_mutex_unlock(&_mutex);
 }
 
-void RWLock::write_lock() {
+void CondvarRWLock::write_lock() {
     pthread_mutex_lock(&_mutex);
 
     _writers_waiting++;
@@ -43,7 +45,7 @@ void RWLock::write_lock() {
     pthread_mutex_unlock(&_mutex);
 }
 
-void RWLock::unlock() {
+void CondvarRWLock::unlock() {
     pthread_mutex_lock(&_mutex);
 
     if (_writer_active) {
@@ -60,20 +62,44 @@ void RWLock::unlock() {
     pthread_mutex_unlock(&_mutex);
 }
 
-// === ReadGuard ===
-ReadGuard::ReadGuard(RWLock& lock) : _lock(lock) {
-    _lock.read_lock();
+// === DistributedRWLock ===
+static void futexWait(atomic<uint32_t>* word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
 }
 
-ReadGuard::~ReadGuard() {
-    _lock.unlock();
+static void futexWakeAll(atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
 }
 
-// === WriteGuard ===
-WriteGuard::WriteGuard(RWLock& lock) : _lock(lock) {
-    _lock.write_lock();
+void DistributedRWLock::readWait() {
+    // Gira um pouco (seções de escrita são curtas) e depois dorme no futex,
+    // marcando a flag para o escritor saber que precisa acordar alguém
+    unsigned spins = 0;
+    for (;;) {
+        uint32_t state = _writer.load(memory_order_acquire);
+        if (state == 0) return;
+        if (spins < SPIN_BEFORE_YIELD) {
+            spins++;
+            cpu_relax();
+            continue;
+        }
+        if (state == 1 && !_writer.compare_exchange_weak(state, 2, memory_order_acq_rel)) continue;
+        futexWait(&_writer, 2);
+    }
+}
+
+void DistributedRWLock::write_lock() {
+    _writers.lock();
+    _writer.store(1, memory_order_seq_cst);
+
+    // Leitores novos já veem a flag; espera os que estão dentro saírem
+    for (size_t i = 0; i < DRW_LOCK_SLOTS; ++i) {
+        unsigned spins = 0;
+        while (_slots[i].readers.load(memory_order_seq_cst) != 0) spin_wait(spins);
+    }
 }
 
-WriteGuard::~WriteGuard() {
-    _lock.unlock();
-}
\ No newline at end of file
+void DistributedRWLock::write_unlock() {
+    if (_writer.exchange(0, memory_order_release) == 2) futexWakeAll(&_writer);
+    _writers.unlock();
+}
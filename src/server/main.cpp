@@ -4,24 +4,43 @@
 #include "server/interface.h"
 #include "server/election.h"
 #include "server/replication.h"
+#include "server/ack_demux.h"
+#include "server/worker_pool.h"
+#include "server/config.h"
+#include "server/wal.h"
+#include "server/snapshot.h"
+#include "server/batch_io.h"
+#include "server/event_loop.h"
+#include "server/uring_io.h"
 #include "common/utils.h"
 #include "common/protocol.h"
+#include "common/wire.h"
 #include <stdexcept>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 
-int setupServerSocket(int port)
+// reuseport: vários sockets na mesma porta; o kernel distribui os
+// remetentes entre eles pelo hash do fluxo (IP e porta de origem)
+int setupServerSocket(int port, bool reuseport = false)
 {
     // Cria um socket UDP
     int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0)
     {
-        log_message("ERROR opening server socket");
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR opening server socket");
         throw runtime_error("Failed to open socket.");
     }
 
     // Permite reutilizar a porta
     int optval = 1;
     setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval, sizeof(int));
+    if (reuseport && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, (const void *)&optval, sizeof(int)) < 0)
+    {
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR setting SO_REUSEPORT");
+        close(sockfd);
+        throw runtime_error("Failed to enable SO_REUSEPORT.");
+    }
 
     // Configura o endereço do servidor
     struct sockaddr_in serv_addr;
@@ -33,27 +52,73 @@ int setupServerSocket(int port)
     // Faz bind do socket à porta especificada
     if (bind(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
     {
-        log_message("ERROR on binding server socket");
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR on binding server socket");
         close(sockfd);
         throw runtime_error("Failed to bind socket.");
     }
     return sockfd;
 }
 
+// Fixa a thread num núcleo (os receptores dos sockets SO_REUSEPORT)
+static void pinThreadToCore(pthread_t thread, size_t core)
+{
+    unsigned int cores = thread::hardware_concurrency();
+    if (cores == 0)
+        return;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core % cores, &cpuset);
+    if (pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset) != 0)
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR pinning receive thread to a core");
+}
+
 void onLeaderChange(uint32_t new_leader_id, bool i_am_leader)
 {
     if (i_am_leader)
     {
-        log_message("=== I AM NOW THE PRIMARY (LEADER) ===");
+        PIX_LOG_DEBUG(LOG_CAT_ELECTION, "=== I AM NOW THE PRIMARY (LEADER) ===");
         replication_manager.setLeader(true);
     }
     else
     {
-        log_message(("=== New leader elected: ID " + to_string(new_leader_id) + " ===").c_str());
+        PIX_LOG_INFO(LOG_CAT_ELECTION, "=== New leader elected: ID %u ===", new_leader_id);
         replication_manager.setLeader(false);
     }
 }
 
+static OverloadPolicy overload_policy = OVERLOAD_REPLY_LAST_ACK;
+
+// Executado pelas threads do WorkerPool
+void runPacketJob(const PacketJob &job, ServerProcessing &processing_handler)
+{
+    if (job.packet.type == PKT_REQUEST)
+        processing_handler.handleRequest(job.packet, job.addr, job.addrlen, job.sockfd);
+    else if (job.packet.type == PKT_BATCH_REQUEST && job.batch)
+        processing_handler.handleBatchRequest(*job.batch, job.addr, job.addrlen, job.sockfd);
+    else
+        replication_manager.handleReplicationMessage(job.packet, job.addr);
+}
+
+// Enfileira no pool, na raia do IP de origem da operação. O job guarda cópias
+// do pacote e do remetente, pois o buffer 'received_packet' será sobrescrito
+// rapidamente pela leitura do socket.
+bool submitPacketJob(const Packet &packet, const struct sockaddr_in &client_addr, socklen_t clilen, int sockfd)
+{
+    // Requisição: o próprio remetente é a origem.
+    // Replicação: a origem vem no pacote, assim o backup aplica as operações
+    // de um cliente na mesma ordem em que o líder as enviou.
+    uint32_t key = (packet.type == PKT_REQUEST) ? client_addr.sin_addr.s_addr
+                                                : packet.rep.origin_addr;
+
+    PacketJob job;
+    job.packet = packet;
+    job.addr = client_addr;
+    job.addrlen = clilen;
+    job.sockfd = sockfd;
+    return worker_pool.trySubmit(key, job);
+}
+
 void handlePacket(const Packet &packet,
                   const struct sockaddr_in &client_addr,
                   socklen_t clilen,
@@ -61,12 +126,6 @@ void handlePacket(const Packet &packet,
                   ServerDiscovery &discovery_handler,
                   ServerProcessing &processing_handler)
 {
-
-    // Criamos cópias dos dados de I/O para garantir que a thread não use dados antigos.
-    // pois o buffer 'received_packet' será sobrescrito rapidamente pelo runServerLoop.
-    Packet packet_copy = packet;
-    struct sockaddr_in client_addr_copy = client_addr;
-
     // DESCOBERTA DE SERVIDORES
     if (packet.type == PKT_SERVER_DISCOVER || packet.type == PKT_SERVER_DISCOVER_ACK)
     {
@@ -91,14 +150,13 @@ void handlePacket(const Packet &packet,
         if (packet.type == PKT_SERVER_DISCOVER)
         {
             Packet ack;
-            memset(&ack, 0, sizeof(Packet));
             ack.type = PKT_SERVER_DISCOVER_ACK;
             ack.server_discovery.id = election_manager.getMyId();
             ack.server_discovery.replica_port = remote_port;
 
-            sendto(sockfd, &ack, sizeof(Packet), 0, (struct sockaddr *)&client_addr, clilen);
+            sendDatagram(sockfd, ack, client_addr, clilen);
 
-            // log_message(("Discovered new server ID " + to_string(remote_id) + ". Sent ACK.").c_str());
+            // PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Discovered new server ID %d. Sent ACK.", remote_id);
         }
         return;
     }
@@ -124,7 +182,7 @@ void handlePacket(const Packet &packet,
             election_manager.handleHeartbeatAck(packet, client_addr);
             break;
         default:
-            log_message("Unknown election message type.");
+            PIX_LOG_DEBUG(LOG_CAT_ELECTION, "Unknown election message type.");
             break;
         }
         return;
@@ -142,7 +200,7 @@ void handlePacket(const Packet &packet,
         }
         else
         {
-            log_message("Received PKT_DISCOVER but I'm not the leader. Ignoring.");
+            PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Received PKT_DISCOVER but I'm not the leader. Ignoring.");
         }
         break;
 
@@ -150,14 +208,17 @@ void handlePacket(const Packet &packet,
         // Apenas o líder processa requisições de cliente
         if (election_manager.isLeader())
         {
-            // Processar transações em nova thread (uma thread por requisição)
-            thread([packet_copy, client_addr_copy, clilen, sockfd, &processing_handler]()
-                   { processing_handler.handleRequest(packet_copy, client_addr_copy, clilen, sockfd); })
-                .detach();
+            // Processar transações no pool (raia serializada por cliente)
+            if (!submitPacketJob(packet, client_addr, clilen, sockfd))
+            {
+                // Sobrecarga: fila cheia. O cliente retransmite após o timeout.
+                if (overload_policy == OVERLOAD_REPLY_LAST_ACK)
+                    processing_handler.replyWithLastAck(packet, client_addr, clilen, sockfd);
+            }
         }
         else
         {
-            log_message("Received PKT_REQUEST but I'm not the leader. Ignoring.");
+            PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Received PKT_REQUEST but I'm not the leader. Ignoring.");
         }
         break;
 
@@ -165,48 +226,176 @@ void handlePacket(const Packet &packet,
     case PKT_REP_CLIENT_REQ:
     case PKT_REP_QUERY_REQ:
         // Recebimento de replicação (Backup recebendo do Líder)
-        // Lançamos em thread para manter o padrão não-bloqueante da main
-        thread([packet_copy, client_addr_copy]()
-               { replication_manager.handleReplicationMessage(packet_copy, client_addr_copy); })
-            .detach();
+        // Enfileiramos no pool para manter o padrão não-bloqueante da main.
+        // Em sobrecarga o pacote é descartado (o líder não recebe o ACK).
+        if (!submitPacketJob(packet, client_addr, clilen, sockfd))
+        {
+            PIX_LOG_DEBUG(LOG_CAT_PROCESSING, "Worker queue full. Dropping replication message.");
+        }
+        break;
+
+    case PKT_REP_SYNC_REQ:
+        // Backup atrás do fluxo pedindo o estado (Líder): raro, tratado aqui mesmo
+        replication_manager.handleSyncRequest(packet, client_addr);
         break;
 
     case PKT_REPLICATION_ACK:
     case PKT_REP_CLIENT_ACK:
     case PKT_REP_QUERY_ACK:
-        // ACK de replicação recebido pelo Líder.
+        // ACK de replicação recebido pelo Líder: esta é a única thread que lê o
+        // socket de réplicas, e o demultiplexador entrega o ACK a quem o espera
+        // (rápido, tratado aqui mesmo)
+        if (!ack_demux.deliver(packet, client_addr))
+        {
+            PIX_LOG_DEBUG(LOG_CAT_REPLICATION, "Replication ACK with no waiter (late or duplicate). Ignoring.");
+        }
         break;
 
     default:
-        log_message("Received packet with unknown type. Ignoring.");
+        PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Received packet with unknown type. Ignoring.");
         break;
     }
 }
 
-void runServerLoop(int sockfd, ServerDiscovery &discovery_handler, ServerProcessing &processing_handler)
+// Um datagrama recebido por qualquer um dos sockets do servidor
+static void dispatchDatagram(const uint8_t *data, size_t len, const struct sockaddr_in &client_addr,
+                             socklen_t clilen, int sockfd, ServerDiscovery &discovery_handler,
+                             ServerProcessing &processing_handler)
 {
-    Packet received_packet;
-    struct sockaddr_in client_addr;
-    socklen_t clilen = sizeof(client_addr);
+    WireView view(data, len);
+    if (!view.valid())
+    {
+        PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Received malformed or unsupported-version datagram. Ignoring.");
+        return;
+    }
+
+    // Quadro de replicação em lote (Backup recebendo do Líder): aplicado aqui
+    // mesmo, em ordem, lido direto do buffer; o ACK sai quando o lote estiver em disco
+    if (view.type() == PKT_REPLICATION_BATCH)
+    {
+        replication_manager.handleReplicationBatch(ReplicationBatchView(view), client_addr);
+        return;
+    }
+
+    // Estado do líder em partes (Backup se sincronizando): tratado aqui mesmo
+    if (view.type() == PKT_REP_SYNC_DATA)
+    {
+        replication_manager.handleSyncData(ReplicationSyncView(view), client_addr);
+        return;
+    }
 
-    while (true)
+    // Lote de transferências do cliente: vai para a raia do cliente, como um PKT_REQUEST
+    if (view.type() == PKT_BATCH_REQUEST)
     {
-        memset(&received_packet, 0, sizeof(Packet));
+        if (!election_manager.isLeader())
+        {
+            PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Received PKT_BATCH_REQUEST but I'm not the leader. Ignoring.");
+            return;
+        }
+
+        auto batch = make_shared<BatchRequest>();
+        if (!decodeBatchRequest(view, *batch))
+        {
+            PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Received malformed batch request. Ignoring.");
+            return;
+        }
+
+        PacketJob job;
+        job.packet.type = PKT_BATCH_REQUEST;
+        job.packet.seqn = batch->seqn;
+        job.addr = client_addr;
+        job.addrlen = clilen;
+        job.sockfd = sockfd;
+        job.batch = move(batch);
+        if (!worker_pool.trySubmit(client_addr.sin_addr.s_addr, job))
+        {
+            // Sobrecarga: o cliente retransmite o lote
+            PIX_LOG_DEBUG(LOG_CAT_PROCESSING, "Worker queue full. Dropping batch request.");
+        }
+        return;
+    }
+
+    Packet packet;
+    if (!decodePacket(view, packet))
+    {
+        PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Received packet with unknown type. Ignoring.");
+        return;
+    }
+
+    // Delega o processamento baseado no tipo do pacote
+    handlePacket(packet, client_addr, clilen, sockfd, discovery_handler, processing_handler);
+}
+
+// Registra o socket no laço de eventos. A cada vez que ele fica legível é lido
+// um lote (--batch-io=N: um recvmmsg, e as respostas do lote saem juntas num
+// sendmmsg) ou um datagrama (recvfrom); o que sobrar dispara de novo. Com o
+// backend io_uring o laço observa o anel e recebe o que o multishot já leu.
+static void watchServerSocket(EventLoop &loop, int sockfd, ServerDiscovery &discovery_handler,
+                              ServerProcessing &processing_handler)
+{
+    // io_uring (make IO_URING=1): o laço observa o fd do anel, não o socket
+    if (uringAvailable())
+    {
+        auto ring = make_shared<UringReceiver>();
+        if (ring->open(sockfd))
+        {
+            loop.watch(ring->ringFd(), [ring, sockfd, &discovery_handler, &processing_handler]()
+            {
+                OutboxScope outbox;
+                ring->drain([&](const uint8_t *data, size_t len, const struct sockaddr_in &sender,
+                                socklen_t senderlen)
+                {
+                    dispatchDatagram(data, len, sender, senderlen, sockfd, discovery_handler,
+                                     processing_handler);
+                });
+            });
+            return;
+        }
+        PIX_LOG_INFO(LOG_CAT_NET, "io_uring receive unavailable, falling back to epoll");
+    }
+
+    size_t batch = batchIoSize();
+    if (batch > 0)
+    {
+        auto receiver = make_shared<DatagramReceiver>(batch);
+        loop.watch(sockfd, [receiver, sockfd, &discovery_handler, &processing_handler]()
+        {
+            int n = receiver->receive(sockfd, MSG_DONTWAIT);
+            if (n < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    PIX_LOG_ERROR(LOG_CAT_NET, "ERROR on recvmmsg");
+                return;
+            }
+
+            OutboxScope outbox;
+            for (int i = 0; i < n; ++i)
+            {
+                dispatchDatagram(receiver->data(i), receiver->length(i), receiver->sender(i),
+                                 receiver->senderLen(i), sockfd, discovery_handler, processing_handler);
+            }
+        });
+        return;
+    }
+
+    auto received = make_shared<WireDatagram>();
+    loop.watch(sockfd, [received, sockfd, &discovery_handler, &processing_handler]()
+    {
+        struct sockaddr_in client_addr;
+        socklen_t clilen = sizeof(client_addr);
 
         // Recebe pacote de qualquer cliente (ou outro servidor)
-        ssize_t n = recvfrom(sockfd, (char *)&received_packet, sizeof(Packet), 0,
+        ssize_t n = recvfrom(sockfd, received->bytes, sizeof(WireDatagram), MSG_DONTWAIT,
                              (struct sockaddr *)&client_addr, &clilen);
-
         if (n < 0)
         {
-            log_message("ERROR on recvfrom");
-            continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                PIX_LOG_ERROR(LOG_CAT_NET, "ERROR on recvfrom");
+            return;
         }
 
-        // Delega o processamento baseado no tipo do pacote
-        handlePacket(received_packet, client_addr, clilen, sockfd,
-                     discovery_handler, processing_handler);
-    }
+        dispatchDatagram(received->bytes, (size_t)n, client_addr, clilen, sockfd, discovery_handler, processing_handler);
+    });
 }
 
 // O servidor deve ser iniciado com: ./servidor <CLIENT_PORT>
@@ -214,10 +403,12 @@ int main(int argc, char *argv[])
 {
     if (argc < 2)
     {
-        cerr << "Usage: " << argv[0] << " <CLIENT_PORT> [REPLICA_PORT]" << endl;
+        cerr << "Usage: " << argv[0] << " <CLIENT_PORT> [REPLICA_PORT] [--options]" << endl;
         cerr << "  CLIENT_PORT: Port for client connections" << endl;
         cerr << "  REPLICA_PORT: Port for replica communication (default: CLIENT_PORT+1000)" << endl;
         cerr << "" << endl;
+        printServerOptionsUsage();
+        cerr << "" << endl;
         cerr << "Note: Server ID will be automatically derived from the last byte of the IP address." << endl;
         return 1;
     }
@@ -225,11 +416,25 @@ int main(int argc, char *argv[])
     int client_port;
     int replica_port;
     int server_id;
+    ServerConfig config;
 
     try
     {
         client_port = stoi(argv[1]);
-        replica_port = (argc >= 3) ? stoi(argv[2]) : (client_port + 1000);
+
+        // REPLICA_PORT é opcional; as flags começam com "--"
+        int first_option = 2;
+        if (argc >= 3 && string(argv[2]).rfind("--", 0) != 0)
+        {
+            replica_port = stoi(argv[2]);
+            first_option = 3;
+        }
+        else
+        {
+            replica_port = client_port + 1000;
+        }
+
+        config = parseServerOptions(argc, argv, first_option);
     }
     catch (const exception &e)
     {
@@ -253,14 +458,17 @@ int main(int argc, char *argv[])
             return 1;
         }
         
-        log_message("Starting Server");
-        log_message(("My IP: " + my_ip).c_str());
-        log_message(("Server ID (from IP): " + to_string(server_id)).c_str());
-        log_message(("Client Port: " + to_string(client_port)).c_str());
-        log_message(("Replica Port: " + to_string(replica_port)).c_str());
-
-        // Configura sockets
-        int client_sockfd = setupServerSocket(client_port);
+        PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Starting Server");
+        PIX_LOG_DEBUG(LOG_CAT_GENERAL, "My IP: %s", my_ip.c_str());
+        PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Server ID (from IP): %d", server_id);
+        PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Client Port: %d", client_port);
+        PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Replica Port: %d", replica_port);
+
+        // Configura sockets. Com --reuseport=K, K sockets na porta de clientes:
+        // os pacotes de um cliente caem sempre no mesmo socket (e na mesma raia)
+        vector<int> client_sockfds;
+        for (size_t i = 0; i < config.reuseport_sockets; ++i)
+            client_sockfds.push_back(setupServerSocket(client_port, config.reuseport_sockets > 1));
         int replica_sockfd = setupServerSocket(replica_port);
 
         election_manager.init(replica_sockfd, server_id, false); // Todos iniciam como follower
@@ -268,6 +476,44 @@ int main(int argc, char *argv[])
 
         // Inicializa replication_manager (todos iniciam como NOT leader)
         replication_manager.init(replica_sockfd, server_id, false);
+        replication_manager.setBatching(config.replication_batch, config.replication_batch_us);
+        setBatchIo(config.batch_io);
+        setUringIo(config.io_uring);
+        if (uringAvailable())
+            PIX_LOG_INFO(LOG_CAT_NET, "Using the io_uring datagram backend");
+        replication_manager.start(event_loop);
+        ack_demux.start();
+
+        // Reconstrói o banco a partir do snapshot + log de transações (antes de aceitar tráfego)
+        if (config.wal_enabled)
+        {
+            string wal_path = config.wal_path.empty() ? "pix_server_" + to_string(server_id) + ".wal"
+                                                      : config.wal_path;
+            if (!transaction_log.open(wal_path, config.wal_group_commit_us))
+            {
+                cerr << "ERROR: Could not open transaction log " << wal_path << endl;
+                return 1;
+            }
+
+            string snapshot_path = wal_path + ".snap";
+            SnapshotInfo snapshot;
+            uint64_t after_lsn = 0;
+            if (SnapshotManager::load(snapshot_path, server_db, snapshot))
+            {
+                after_lsn = snapshot.start_lsn;
+                transaction_log.reserveLsn(snapshot.last_lsn);
+                PIX_LOG_INFO(LOG_CAT_STORAGE, "Snapshot %s: restored %zu clients up to LSN %llu", snapshot_path.c_str(),
+                             snapshot.num_clients, (unsigned long long)snapshot.start_lsn);
+            }
+
+            size_t replayed = transaction_log.replay(server_db, after_lsn);
+            server_db.attachLog(&transaction_log);
+            transaction_log.start();
+
+            PIX_LOG_INFO(LOG_CAT_STORAGE, "Transaction log %s: replayed %zu records", wal_path.c_str(), replayed);
+
+            snapshot_manager.start(snapshot_path, server_db, transaction_log, config.snapshot_interval_s);
+        }
 
         // INICIA MÓDULOS
         server_interface.start();
@@ -276,33 +522,62 @@ int main(int argc, char *argv[])
         ServerDiscovery discovery_handler;
         ServerProcessing processing_handler;
 
+        // Pool de workers compartilhado por todos os sockets
+        overload_policy = config.overload_policy;
+        worker_pool.start(config.worker_threads, config.worker_queue_capacity,
+                          [&processing_handler](const PacketJob &job)
+                          { runPacketJob(job, processing_handler); });
+
         // Cliente falso para testes (estado inicial comum)
         const string FAKE_CLIENT_IP = "10.0.0.2";
-        if (server_db.addClient(FAKE_CLIENT_IP))
+        if (server_db.addClient(ipToUint32(FAKE_CLIENT_IP)))
         {
-            server_db.updateBankSummary();
-            log_message(("Added fake client " + FAKE_CLIENT_IP).c_str());
+            PIX_LOG_DEBUG(LOG_CAT_GENERAL, "Added fake client %s", FAKE_CLIENT_IP.c_str());
         }
 
-        // Crie uma thread separada para lidar com mensagens entre servidores (Eleição/Replicação)
-        thread replicationThread([replica_sockfd, &discovery_handler, &processing_handler]()
-                                 { runServerLoop(replica_sockfd, discovery_handler, processing_handler); });
-        replicationThread.detach();
-
-        // Espera a thread subir
-        this_thread::sleep_for(chrono::milliseconds(100));
+        // O laço de eventos da thread principal atende o socket de réplicas
+        // (Eleição/Replicação), o primeiro socket de clientes e os timers.
+        // As respostas que chegarem antes de run() esperam no buffer do socket.
+        watchServerSocket(event_loop, replica_sockfd, discovery_handler, processing_handler);
+        watchServerSocket(event_loop, client_sockfds[0], discovery_handler, processing_handler);
 
         // Chamada limpa e semântica
         discovery_handler.sendServerBroadcast(replica_sockfd, server_id, replica_port);
 
-        election_manager.start(); // Aqui o Bully determina quem é líder!
+        election_manager.start(event_loop); // Aqui o Bully determina quem é líder!
+
+        // Os demais sockets de clientes: um laço de eventos próprio cada, fixo num núcleo
+        for (size_t i = 1; i < client_sockfds.size(); ++i)
+        {
+            int sockfd = client_sockfds[i];
+            thread receiver([sockfd, &discovery_handler, &processing_handler]()
+                            {
+                                EventLoop loop;
+                                watchServerSocket(loop, sockfd, discovery_handler, processing_handler);
+                                loop.run();
+                            });
+            pinThreadToCore(receiver.native_handle(), i);
+            receiver.detach();
+        }
+        if (client_sockfds.size() > 1)
+        {
+            // Por último: threads criadas depois herdariam o núcleo
+            pinThreadToCore(pthread_self(), 0);
+            PIX_LOG_INFO(LOG_CAT_NET, "Receiving client traffic on %zu SO_REUSEPORT sockets", client_sockfds.size());
+        }
 
-        // A thread principal fica no loop ouvindo clientes
-        runServerLoop(client_sockfd, discovery_handler, processing_handler);
+        // A thread principal fica no laço de eventos
+        event_loop.run();
 
         election_manager.stop();
+        worker_pool.stop();
+        replication_manager.stop();
+        ack_demux.stop();
+        snapshot_manager.stop();
+        transaction_log.stop();
         server_interface.stop();
-        close(client_sockfd);
+        for (int sockfd : client_sockfds)
+            close(sockfd);
         close(replica_sockfd);
     }
     catch (const exception &e)
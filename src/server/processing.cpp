@@ -3,60 +3,274 @@
 using namespace std;
 
 void sendResponseAck(int sockfd, const struct sockaddr_in& client_addr, socklen_t clilen, 
-                     uint32_t seqn_to_send, uint32_t balance, const string& origin_ip,  uint32_t dest_addr, uint32_t value, bool is_query, bool is_dup_oor) {
+                     uint32_t seqn_to_send, uint32_t balance, uint32_t dest_addr, uint32_t value, bool is_query, bool is_dup_oor) {
+    // Só os campos do ACK vão no fio: sem zerar o Packet inteiro
     Packet ack_packet;
-    memset(&ack_packet, 0, sizeof(Packet));
     ack_packet.type = PKT_REQUEST_ACK;
     ack_packet.seqn = seqn_to_send; 
     ack_packet.ack.new_balance = balance; 
     ack_packet.ack.dest_addr = dest_addr;
     ack_packet.ack.value = value;
 
-    ssize_t sent_bytes = sendto(sockfd, &ack_packet, sizeof(Packet), 0,
-                                (const struct sockaddr*)&client_addr, clilen);
+    ssize_t sent_bytes = sendDatagram(sockfd, ack_packet, client_addr, clilen);
                        
     if (sent_bytes < 0) {
-        log_message(("ERROR sending ACK for ID " + to_string(seqn_to_send) + " to client.").c_str());
+        PIX_LOG_ERROR(LOG_CAT_PROCESSING, "ERROR sending ACK for ID %u to client.", seqn_to_send);
     }
 }
 
+static void sendBatchAck(int sockfd, const struct sockaddr_in& client_addr, socklen_t clilen, const BatchAck& ack) {
+    uint8_t buf[WIRE_BATCH_ACK_MAX];
+    size_t len = encodeBatchAck(ack, buf, sizeof(buf));
+    if (len == 0 || sendEncoded(sockfd, buf, len, client_addr, clilen) < 0) {
+        PIX_LOG_ERROR(LOG_CAT_PROCESSING, "ERROR sending batch ACK for ID %u to client.", ack.seqn);
+    }
+}
+
+// ACK de uma transferência que espera duas coisas: a confirmação do fluxo de
+// replicação e o registro no disco. Quem chegar por último envia.
+struct ServerProcessing::PendingTransferAck {
+    uint32_t seqn;
+    ReadyAck ack;
+    atomic<int> remaining{2};
+};
+
+void ServerProcessing::startInflight(uint32_t origin_addr, uint32_t seqn) {
+    lock_guard<mutex> lock(inflight_mutex);
+    inflight[origin_addr][seqn].ready = false;
+}
+
+bool ServerProcessing::hasInflight(uint32_t origin_addr) {
+    lock_guard<mutex> lock(inflight_mutex);
+    return inflight.count(origin_addr) != 0;
+}
+
+void ServerProcessing::finishInflight(uint32_t origin_addr, uint32_t seqn, const ReadyAck& ack) {
+    vector<pair<uint32_t, ReadyAck>> to_send;
+    {
+        lock_guard<mutex> lock(inflight_mutex);
+        auto& pending = inflight[origin_addr];
+        ReadyAck& slot = pending[seqn];
+        slot = ack;
+        slot.ready = true;
+
+        // Uma consulta replica mais rápido que uma transferência anterior vai
+        // ao disco: o ACK dela espera, para o cliente poder confirmar em bloco
+        auto it = pending.begin();
+        while (it != pending.end() && it->second.ready) {
+            to_send.emplace_back(it->first, it->second);
+            it = pending.erase(it);
+        }
+        if (pending.empty()) inflight.erase(origin_addr);
+    }
+
+    // Envio fora do lock
+    for (const auto& [ack_seqn, ready] : to_send) {
+        if (ready.batch_count > 0) {
+            BatchAck batch_ack;
+            batch_ack.seqn = ack_seqn - ready.batch_count + 1;
+            batch_ack.count = ready.batch_count;
+            batch_ack.new_balance = ready.balance;
+            batch_ack.applied = ready.batch_applied;
+            sendBatchAck(ready.sockfd, ready.client_addr, ready.clilen, batch_ack);
+            continue;
+        }
+        sendResponseAck(ready.sockfd, ready.client_addr, ready.clilen, ack_seqn, ready.balance,
+                        ready.dest_addr, ready.value, ready.value == 0, false);
+    }
+}
+
+bool ServerProcessing::holdEarly(uint32_t origin_addr, uint32_t last_processed_seqn, const Packet& packet,
+                                 const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd) {
+    // Além da janela do cliente não é adiantamento, é um cliente perdido
+    if (packet.seqn - last_processed_seqn > REQUEST_WINDOW_MAX) return false;
+
+    lock_guard<mutex> lock(early_mutex);
+    auto& held = early_requests[origin_addr];
+    auto it = held.find(packet.seqn);
+    if (it == held.end()) {
+        if (held.size() >= REQUEST_WINDOW_MAX) return false;
+        early_total.fetch_add(1, memory_order_relaxed);
+    }
+    // Retransmissão de uma já guardada só atualiza o endereço de resposta
+    held[packet.seqn] = EarlyRequest{packet, client_addr, clilen, sockfd};
+    return true;
+}
+
+bool ServerProcessing::takeEarly(uint32_t origin_addr, uint32_t seqn, EarlyRequest& out) {
+    if (early_total.load(memory_order_relaxed) == 0) return false;
+
+    lock_guard<mutex> lock(early_mutex);
+    auto client_it = early_requests.find(origin_addr);
+    if (client_it == early_requests.end()) return false;
+
+    auto& held = client_it->second;
+    bool found = false;
+    // Descarta as que já ficaram para trás (processadas por uma retransmissão)
+    while (!held.empty() && held.begin()->first <= seqn) {
+        if (held.begin()->first == seqn) {
+            out = held.begin()->second;
+            found = true;
+        }
+        held.erase(held.begin());
+        early_total.fetch_sub(1, memory_order_relaxed);
+    }
+    if (held.empty()) early_requests.erase(client_it);
+    return found;
+}
+
+void ServerProcessing::replyWithLastAck(const Packet& packet, const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd) {
+    uint32_t origin_addr = client_addr.sin_addr.s_addr;
+
+    // ACKs ainda em voo cobrem esta retransmissão quando saírem
+    if (hasInflight(origin_addr)) return;
+
+    // last_req, ACK bufferizado e saldo de uma mesma versão da conta, sem lock
+    ClientSnapshot snapshot;
+    if (!server_db.getClientSnapshot(origin_addr, snapshot)) memset(&snapshot, 0, sizeof(snapshot));
+    uint32_t last_processed_seqn = snapshot.last_req;
+    const Packet& buffered_ack = snapshot.last_ack_response;
+
+    uint32_t balance;
+    if (buffered_ack.seqn == last_processed_seqn) {
+        balance = buffered_ack.ack.new_balance;
+    } else {
+        balance = snapshot.balance;
+    }
+
+    // Mesmo formato da resposta a duplicatas: o cliente vê o último ID processado e retransmite
+    sendResponseAck(sockfd, client_addr, clilen, last_processed_seqn, balance,
+                    packet.req.dest_addr, packet.req.value, packet.req.value == 0, true);
+}
 
 void ServerProcessing::handleRequest(const Packet& packet, const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd) {
-    
+    processRequest(packet, client_addr, clilen, sockfd);
+    if (packet.type == PKT_REQUEST) drainEarly(client_addr.sin_addr.s_addr);
+}
+
+void ServerProcessing::drainEarly(uint32_t origin_addr) {
+    // A última requisição pode ter preenchido a lacuna: segue com as adiantadas, em ordem
+    EarlyRequest next;
+    while (takeEarly(origin_addr, server_db.getClientLastReq(origin_addr) + 1, next)) {
+        processRequest(next.packet, next.client_addr, next.clilen, next.sockfd);
+    }
+}
+
+void ServerProcessing::handleBatchRequest(const BatchRequest& batch, const struct sockaddr_in& client_addr,
+                                          socklen_t clilen, int sockfd) {
+    if (batch.count == 0 || batch.count > BATCH_REQUEST_MAX) return;
+    if (!replication_manager.isLeader()) return;
+
+    uint32_t origin_addr = client_addr.sin_addr.s_addr;
+    uint32_t last_seqn = batch.seqn + batch.count - 1;
+    uint32_t last_processed_seqn = server_db.getClientLastReq(origin_addr);
+
+    // Lote repetido ou fora de ordem: não é executado de novo
+    if (batch.seqn != last_processed_seqn + 1) {
+        // Respostas ainda em voo cobrem a retransmissão quando saírem
+        if (hasInflight(origin_addr)) return;
+
+        // Retransmissão do último lote: a mesma resposta, com o resultado por item
+        {
+            lock_guard<mutex> lock(inflight_mutex);
+            auto it = last_batch_ack.find(origin_addr);
+            if (it != last_batch_ack.end() && it->second.seqn == batch.seqn && it->second.count == batch.count &&
+                last_seqn == last_processed_seqn) {
+                BatchAck cached = it->second;
+                sendBatchAck(sockfd, client_addr, clilen, cached);
+                return;
+            }
+        }
+
+        // Senão, como uma requisição duplicada/fora de ordem: o último ID processado
+        Packet packet;
+        packet.type = PKT_REQUEST;
+        packet.seqn = batch.seqn;
+        packet.req.dest_addr = 0;
+        packet.req.value = 0;
+        replyWithLastAck(packet, client_addr, clilen, sockfd);
+        return;
+    }
+
+    // Uma aquisição de locks para o lote inteiro
+    BatchResult result;
+    if (!server_db.makeBatchTransaction(origin_addr, batch, result)) return;
+
+    ReadyAck ack{true, sockfd, client_addr, clilen, result.balance_origin, 0, 0, batch.count, result.applied};
+    {
+        lock_guard<mutex> lock(inflight_mutex);
+        last_batch_ack[origin_addr] = BatchAck{batch.seqn, batch.count, result.balance_origin, result.applied};
+    }
+
+    if (result.transfer_count == 0) {
+        // Nada efetivado: só o avanço de last_req, respondido em ordem
+        finishInflight(origin_addr, last_seqn, ack);
+    } else {
+        // Uma rodada de replicação para o lote e o registro do último item no
+        // disco: como numa transferência, quem chegar por último responde
+        auto pending = make_shared<PendingTransferAck>();
+        pending->seqn = last_seqn;
+        pending->ack = ack;
+
+        auto arrive = [this, pending, origin_addr]() {
+            if (pending->remaining.fetch_sub(1) != 1) return;
+            finishInflight(origin_addr, pending->seqn, pending->ack);
+        };
+
+        startInflight(origin_addr, last_seqn);
+
+        replication_manager.replicateStates(result.transfers, result.transfer_count, [arrive](bool replicated) {
+            if (!replicated) {
+                PIX_LOG_WARN(LOG_CAT_PROCESSING, "AVISO: Falha ao replicar lote para backups.");
+            }
+            arrive();
+        });
+
+        transaction_log.whenDurable(result.lsn, arrive);
+    }
+
+    server_interface.logBatch(origin_addr, batch.seqn, last_seqn, result.transfer_count, batch.count,
+                              result.balance_origin);
+
+    drainEarly(origin_addr);
+}
+
+void ServerProcessing::processRequest(const Packet& packet, const struct sockaddr_in& client_addr, socklen_t clilen, int sockfd) {
     if (packet.type != PKT_REQUEST) {
-        log_message("Received non-request packet. Ignoring.");
+        PIX_LOG_DEBUG(LOG_CAT_PROCESSING, "Received non-request packet. Ignoring.");
         return;
     }
-    char client_ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-    string origin_ip_str(client_ip);
-    
-    char dest_ip_str[INET_ADDRSTRLEN];
-    struct in_addr dest_addr;
-    dest_addr.s_addr = packet.req.dest_addr;
-    inet_ntop(AF_INET, &dest_addr, dest_ip_str, INET_ADDRSTRLEN);
-    string dest_ip_str_cpp(dest_ip_str);
+    // Contas são identificadas pelo IP em uint32_t (sem conversão para string no caminho quente)
+    uint32_t origin_addr = client_addr.sin_addr.s_addr;
+    uint32_t dest_addr = packet.req.dest_addr;
     
     uint32_t final_balance = 0; 
     bool is_query = (packet.req.value == 0);
     
     // --- 1. VERIFICAÇÃO DE DUPLICIDADE/SEQUÊNCIA (CRÍTICO) ---
-    uint32_t last_processed_seqn = server_db.getClientLastReq(origin_ip_str);
+    // Todas as requisições deste cliente rodam em ordem na mesma raia do
+    // WorkerPool, então last_req não muda entre esta leitura e o commit.
+    uint32_t last_processed_seqn = server_db.getClientLastReq(origin_addr);
     uint32_t received_seqn = packet.seqn;
     
     Packet buffered_ack;
     bool duplicate_packet = (received_seqn <= last_processed_seqn);
     bool out_of_order_packet = (received_seqn > last_processed_seqn + 1);
 
+    // Chegou antes das anteriores (janela do cliente): espera a lacuna
+    if (out_of_order_packet && holdEarly(origin_addr, last_processed_seqn, packet, client_addr, clilen, sockfd)) {
+        return;
+    }
+
     if (duplicate_packet || out_of_order_packet) {
-        string log_prefix = duplicate_packet ? " DUP!!" : "";
-        string dup_msg = "client " + origin_ip_str + 
-                        log_prefix + 
-                        " id_req " + to_string(received_seqn) +
-                        " dest " + dest_ip_str_cpp + 
-                        " value " + to_string(packet.req.value);
-
-        buffered_ack = server_db.getClientLastAck(origin_ip_str);
+        // Há requisições ainda esperando replicação/disco: o ACK bufferizado não
+        // pode sair antes. Os ACKs delas (cumulativos) saem quando concluírem.
+        if (hasInflight(origin_addr)) return;
+
+        // ACK bufferizado e saldo numa leitura só (sem lock)
+        ClientSnapshot snapshot;
+        if (!server_db.getClientSnapshot(origin_addr, snapshot)) memset(&snapshot, 0, sizeof(snapshot));
+        buffered_ack = snapshot.last_ack_response;
         
         uint32_t ack_dest_addr = packet.req.dest_addr;
         uint32_t ack_value = packet.req.value;
@@ -64,16 +278,15 @@ void ServerProcessing::handleRequest(const Packet& packet, const struct sockaddr
         if (buffered_ack.seqn == last_processed_seqn) {
              final_balance = buffered_ack.ack.new_balance;
         } else {
-             uint32_t balance = server_db.getClientBalance(origin_ip_str);
-             final_balance = (balance >= 0 ? balance : 0);
+             final_balance = snapshot.balance;
         }
 
         // Envio do ACK: Usa o last_processed_seqn como ID de resposta
         sendResponseAck(sockfd, client_addr, clilen, last_processed_seqn, final_balance, 
-                        origin_ip_str, ack_dest_addr, ack_value, is_query, true);
+                        ack_dest_addr, ack_value, is_query, true);
 
         // Notifica a interface sobre o pacote duplicado/fora de ordem
-        server_interface.notifyUpdate(dup_msg);
+        server_interface.logDuplicate(origin_addr, received_seqn, dest_addr, packet.req.value, duplicate_packet);
 
         return;
     }
@@ -81,30 +294,30 @@ void ServerProcessing::handleRequest(const Packet& packet, const struct sockaddr
 
     // 2. EXECUÇÃO (received_seqn == last_processed_seqn + 1)
     if (is_query) {
-        uint32_t balance = server_db.getClientBalance(origin_ip_str);
+        uint32_t balance = server_db.getClientBalance(origin_addr);
         
         if (balance >= 0) {
             final_balance = balance;
             
-            server_db.updateClientLastReq(origin_ip_str, received_seqn);
+            // Avança last_req e bufferiza o ACK da consulta (vai para o log de transações)
+            server_db.recordQuery(origin_addr, received_seqn, final_balance);
 
-            bool replicated = replication_manager.replicateQuery(
-                origin_ip_str, 
-                packet.seqn
-            );
+            // O ACK sai quando um backup confirmar a consulta (ou no prazo), sem
+            // segurar a raia enquanto isso
+            startInflight(origin_addr, received_seqn);
 
-            if (!replicated) {
-                log_message("AVISO: Falha ao replicar QUERY para backups.");
-            }
-            
-            // Cria e bufferiza ACK
-            Packet query_ack;
-            query_ack.type = PKT_REQUEST_ACK;
-            query_ack.seqn = received_seqn;
-            query_ack.ack.new_balance = final_balance;
-            query_ack.ack.dest_addr = packet.req.dest_addr;
-            query_ack.ack.value = packet.req.value;
-            server_db.updateClientLastAck(origin_ip_str, query_ack);
+            ReadyAck ack{true, sockfd, client_addr, clilen, final_balance, packet.req.dest_addr, packet.req.value, 0, 0};
+            replication_manager.replicateQuery(
+                origin_addr, 
+                packet.seqn,
+                final_balance,
+                [this, origin_addr, received_seqn, ack](bool replicated) {
+                    if (!replicated) {
+                        PIX_LOG_WARN(LOG_CAT_PROCESSING, "AVISO: Falha ao replicar QUERY para backups.");
+                    }
+                    finishInflight(origin_addr, received_seqn, ack);
+                }
+            );
         }
     } else {
 
@@ -114,45 +327,52 @@ void ServerProcessing::handleRequest(const Packet& packet, const struct sockaddr
 
         // 1. O Líder Executa localmente primeiro!
         // (Sua makeTransaction já valida saldo e cliente, então se falhar, retorna false)
-        bool success = server_db.makeTransaction(origin_ip_str, dest_ip_str_cpp, packet);
+        TransferResult result;
+        bool success = server_db.makeTransaction(origin_addr, dest_addr, packet, result);
+        uint32_t bal_orig = result.balance_origin;
+        uint32_t bal_dest = result.balance_dest;
 
         if (!success) {
-            log_message("Transação recusada localmente (Saldo/Cliente). Não vou replicar.");
-            // Manda "NACK" pro cliente
-            uint32_t current_bal = server_db.getClientBalance(origin_ip_str);
-            sendResponseAck(sockfd, client_addr, clilen, received_seqn, current_bal, 
-                            origin_ip_str, packet.req.dest_addr, packet.req.value, false, false);
+            PIX_LOG_TRACE(LOG_CAT_PROCESSING, "Transação recusada localmente (Saldo/Cliente). Não vou replicar.");
+            // Manda "NACK" pro cliente (bal_orig é o saldo atual), depois dos ACKs
+            // das anteriores ainda em voo
+            finishInflight(origin_addr, received_seqn,
+                           ReadyAck{true, sockfd, client_addr, clilen, bal_orig, packet.req.dest_addr, packet.req.value, 0, 0});
             return;
         }
 
-        // 2. Coletar o "Estado Atualizado"
-        uint32_t bal_orig = server_db.getClientBalance(origin_ip_str);
-        uint32_t bal_dest = server_db.getClientBalance(dest_ip_str_cpp);
+        // 2. O "Estado Atualizado" (saldos finais) já vem do commit.
+        // 3. Replicar o estado sem bloquear a raia: o ACK ao cliente sai quando a
+        //    entrada for confirmada por um backup E estiver no disco local.
+        //    Enquanto isso a raia segue com as próximas requisições.
+        auto pending = make_shared<PendingTransferAck>();
+        pending->seqn = received_seqn;
+        pending->ack = ReadyAck{true, sockfd, client_addr, clilen, bal_orig, packet.req.dest_addr, packet.req.value, 0, 0};
+
+        auto arrive = [this, pending, origin_addr]() {
+            if (pending->remaining.fetch_sub(1) != 1) return;
+
+            // 4. Responder ao Cliente (em ordem com as outras do cliente)
+            finishInflight(origin_addr, pending->seqn, pending->ack);
+        };
+
+        startInflight(origin_addr, received_seqn);
 
-        // 3. Replicar o estado
-        // Criamos uma nova função que aceita os saldos
-        bool replicated = replication_manager.replicateState(
-            origin_ip_str, dest_ip_str_cpp, 
+        replication_manager.replicateState(
+            origin_addr, dest_addr, 
             packet.req.value, packet.seqn,
-            bal_orig, bal_dest
+            bal_orig, bal_dest,
+            [arrive](bool replicated) {
+                if (!replicated) {
+                    PIX_LOG_WARN(LOG_CAT_PROCESSING, "AVISO: Falha ao replicar estado para backups.");
+                }
+                arrive();
+            }
         );
 
-        if (!replicated) {
-            log_message("AVISO: Falha ao replicar estado para backups.");
-        }
-        
-        // 4. Responder ao Cliente
-        final_balance = bal_orig;
-        sendResponseAck(sockfd, client_addr, clilen, received_seqn, final_balance, 
-                            origin_ip_str, packet.req.dest_addr, packet.req.value, is_query, false);
+        // Group commit: vários commits em andamento dividem o mesmo fsync
+        transaction_log.whenDurable(result.lsn, arrive);
     }
-    
-    sendResponseAck(sockfd, client_addr, clilen, received_seqn, final_balance, 
-                            origin_ip_str, packet.req.dest_addr, packet.req.value, is_query, false);
-
-    string msg_log = "client " + origin_ip_str + 
-                     " id_req " + to_string(packet.seqn) +
-                     " dest " + dest_ip_str_cpp + 
-                     " value " + to_string(packet.req.value);
-    server_interface.notifyUpdate(msg_log);
+
+    server_interface.logRequest(origin_addr, packet.seqn, dest_addr, packet.req.value);
 }
\ No newline at end of file
@@ -1,14 +1,120 @@
 #include "server/replication.h"
+#include "server/wal.h"
+#include "server/ack_demux.h"
+#include "server/batch_io.h"
+#include "server/snapshot.h"
 
 ReplicationManager replication_manager;
 
-ReplicationManager::ReplicationManager() : my_id(-1), sockfd(-1), is_leader_flag(false) {}
+ReplicationManager::ReplicationManager()
+    : my_id(-1), sockfd(-1), is_leader_flag(false), window_base(1), next_log_index(1), log_epoch(0),
+      next_unsent_index(1), batch_max(REPLICATION_BATCH_MAX), batch_delay(REPLICATION_BATCH_DELAY_US),
+      loop(nullptr), tick_timer(-1), batch_timer(-1), running(false), applied_epoch(0), applied_index(0), applied_lsn(0),
+      syncing(false), sync_request_id(0), sync_leader_addr{}, sync_index(0), sync_parts(0), sync_received(0),
+      sync_num_transactions(0), sync_total_transferred(0) {}
+
+ReplicationManager::~ReplicationManager() { stop(); }
 
 void ReplicationManager::init(int socket, int id, bool is_leader)
 {
     this->sockfd = socket;
     this->my_id = id;
-    this->is_leader_flag = is_leader;
+
+    // Com a janela, até REPLICATION_WINDOW entradas (e seus ACKs) chegam de uma vez
+    int buffer_size = REPLICATION_SOCKET_BUFFER;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+    // Os ACKs cumulativos do fluxo chegam pelo demultiplexador
+    ack_demux.setStreamHandler(PKT_REPLICATION_ACK, [this](const Packet &ack, const struct sockaddr_in &sender_addr)
+                               { handleReplicationAck(ack, sender_addr); });
+
+    setLeader(is_leader);
+}
+
+void ReplicationManager::start(EventLoop &event_loop)
+{
+    bool expected = false;
+    if (!running.compare_exchange_strong(expected, true))
+        return;
+
+    loop = &event_loop;
+    tick_timer = loop->addTimer([this] { onTick(); });
+    batch_timer = loop->addTimer([this] { onBatchDeadline(); });
+    loop->armTimer(tick_timer, chrono::milliseconds(REPLICATION_TICK_MS), chrono::milliseconds(REPLICATION_TICK_MS));
+}
+
+void ReplicationManager::stop()
+{
+    bool expected = true;
+    if (!running.compare_exchange_strong(expected, false))
+        return;
+
+    window_cv.notify_all();
+
+    // Chamado depois que o laço parou: os timers não disparam mais
+    vector<pair<ReplicationCallback, bool>> done;
+    {
+        lock_guard<mutex> lock(replicas_mutex);
+        loop->removeTimer(tick_timer);
+        loop->removeTimer(batch_timer);
+        loop = nullptr;
+        resetWindow_unsafe(done);
+    }
+    for (auto &d : done)
+        d.first(d.second);
+}
+
+void ReplicationManager::setLeader(bool status)
+{
+    vector<pair<ReplicationCallback, bool>> done;
+    {
+        lock_guard<mutex> lock(replicas_mutex);
+
+        // Entradas da época anterior não serão mais confirmadas
+        resetWindow_unsafe(done);
+
+        if (status)
+        {
+            // Época nova e diferente da de qualquer líder anterior: os backups
+            // recomeçam a contagem de índices ao vê-la
+            uint32_t epoch = (uint32_t)chrono::system_clock::now().time_since_epoch().count() ^ ((uint32_t)my_id << 24);
+            log_epoch = (epoch != 0) ? epoch : 1;
+        }
+
+        is_leader_flag = status;
+    }
+    window_cv.notify_all();
+
+    for (auto &d : done)
+        d.first(d.second);
+}
+
+void ReplicationManager::resetWindow_unsafe(vector<pair<ReplicationCallback, bool>> &done)
+{
+    for (auto &entry : window)
+    {
+        if (entry.on_done)
+            done.emplace_back(move(entry.on_done), false);
+    }
+    window.clear();
+    window_base = 1;
+    next_log_index = 1;
+    next_unsent_index = 1;
+
+    for (auto &r : replicas)
+    {
+        r.acked_index = 0;
+        r.base_index = 0;
+        r.syncing = false;
+        r.dup_acks = 0;
+    }
+}
+
+void ReplicationManager::setBatching(size_t max_records, uint32_t delay_us)
+{
+    lock_guard<mutex> lock(replicas_mutex);
+    batch_max = max<size_t>(1, min<size_t>(max_records, REPLICATION_BATCH_MAX));
+    batch_delay = chrono::microseconds(delay_us);
 }
 
 void ReplicationManager::addReplica(int id, string ip, int port)
@@ -16,10 +122,21 @@ void ReplicationManager::addReplica(int id, string ip, int port)
     lock_guard<mutex> lock(replicas_mutex);
 
     // 1. VERIFICAÇÃO DE DUPLICIDADE
-    for (const auto &r : replicas)
+    for (auto &r : replicas)
     {
         if (r.id == id)
         {
+            // Réplica que tinha saído do fluxo voltou (reiniciou e se anunciou).
+            // Recebe só as entradas novas; pelo índice base nos quadros ela vê
+            // que está atrás e pede o estado antes de voltar a confirmar
+            if (!r.active)
+            {
+                r.active = true;
+                r.acked_index = next_log_index - 1;
+                r.base_index = r.acked_index;
+                r.syncing = (r.acked_index > 0);
+                r.dup_acks = 0;
+            }
             return;
         }
     }
@@ -30,6 +147,10 @@ void ReplicationManager::addReplica(int id, string ip, int port)
     r.ip = ip;
     r.port = port;
     r.active = true;
+    r.acked_index = next_log_index - 1;
+    r.base_index = r.acked_index;
+    r.syncing = (r.acked_index > 0);
+    r.dup_acks = 0;
 
     memset(&r.addr, 0, sizeof(r.addr));
     r.addr.sin_family = AF_INET;
@@ -40,191 +161,417 @@ void ReplicationManager::addReplica(int id, string ip, int port)
 }
 
 // LÓGICA DO LÍDER
-bool ReplicationManager::replicateState(const string& origin_ip, const string& dest_ip, 
-                                        uint32_t amount, uint32_t seqn,
-                                        uint32_t final_bal_orig, uint32_t final_bal_dest) {
-    if (!is_leader_flag) return false;
-
-    Packet pkt;
-    memset(&pkt, 0, sizeof(Packet));
-    pkt.type = PKT_REPLICATION_REQ;
-    pkt.seqn = seqn;
-    pkt.rep.origin_addr = ipToUint32(origin_ip);
-    pkt.rep.dest_addr   = ipToUint32(dest_ip);
-    pkt.rep.value       = amount;
-    pkt.rep.final_balance_origin = final_bal_orig;
-    pkt.rep.final_balance_dest   = final_bal_dest;
-
-    int sent_count = 0;
-    // Envia para todas as réplicas
-    for (const auto &r : replicas)
+uint32_t ReplicationManager::replicateState(uint32_t origin_addr, uint32_t dest_addr,
+                                            uint32_t amount, uint32_t seqn,
+                                            uint32_t final_bal_orig, uint32_t final_bal_dest,
+                                            ReplicationCallback on_done) {
+    ReplicationRecord record;
+    record.log_index = 0;
+    record.seqn = seqn;
+    record.origin_addr = origin_addr;
+    record.dest_addr = dest_addr;
+    record.value = amount;
+    record.final_balance_origin = final_bal_orig;
+    record.final_balance_dest = final_bal_dest;
+    return replicateStates(&record, 1, move(on_done));
+}
+
+uint32_t ReplicationManager::replicateStates(const ReplicationRecord *records, size_t count,
+                                             ReplicationCallback on_done) {
+    unique_lock<mutex> lock(replicas_mutex);
+
+    // Sem backups (ou não sou mais líder): nada a esperar
+    if (count == 0 || !is_leader_flag || !hasActiveReplicas_unsafe())
     {
-        if (r.active)
-        {
-            sendto(sockfd, &pkt, sizeof(Packet), 0, (struct sockaddr *)&r.addr, sizeof(r.addr));
-            sent_count++;
-        }
+        lock.unlock();
+        on_done(is_leader_flag);
+        return 0;
+    }
+
+    // Controle de fluxo: com a janela cheia, espera os backups confirmarem
+    // (antes, libera as respostas que esta thread acumulou)
+    if (window.size() + count > REPLICATION_WINDOW)
+        flushOutbox();
+    window_cv.wait(lock, [&] { return window.size() + count <= REPLICATION_WINDOW || !running || !is_leader_flag; });
+    if (!is_leader_flag)
+    {
+        lock.unlock();
+        on_done(false);
+        return 0;
+    }
+
+    return appendEntries_unsafe(records, count, move(on_done));
+}
+
+uint32_t ReplicationManager::appendEntries_unsafe(const ReplicationRecord *records, size_t count,
+                                                  ReplicationCallback on_done)
+{
+    auto now = chrono::steady_clock::now();
+
+    // O ACK dos backups é cumulativo: basta o callback na última entrada
+    for (size_t i = 0; i < count; ++i)
+    {
+        ReplicationEntry entry;
+        entry.record = records[i];
+        entry.record.log_index = next_log_index++;
+        entry.first_sent = entry.last_sent = now;
+        entry.retries = 0;
+        if (i + 1 == count)
+            entry.on_done = move(on_done);
+        window.push_back(move(entry));
     }
+    uint32_t index = next_log_index - 1;
 
-    if (sent_count <= 1)
-        return true; // Se não tiver nenhum outro servidor, não replica.
+    // Quadro cheio (ou sem espera configurada): sai agora, sob o lock, na ordem
+    // dos índices. Senão, o timer do quadro o envia no prazo.
+    size_t unsent = next_log_index - next_unsent_index;
+    if (unsent >= batch_max || batch_delay.count() == 0 || loop == nullptr)
+    {
+        flush_unsafe(now);
+    }
+    else if (unsent == count)
+    {
+        batch_deadline = now + batch_delay;
+        loop->armTimer(batch_timer, batch_delay);
+    }
+    return index;
+}
 
-    int acks_received = 0;
-    Packet response;
-    struct sockaddr_in from_addr;
-    socklen_t len = sizeof(from_addr);
+void ReplicationManager::sendFrames_unsafe(const ReplicaInfo &r, size_t first, size_t last)
+{
+    uint8_t frame[WIRE_MAX_DATAGRAM];
 
-    // Configura o timeout para o select (200ms)
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 200000;
+    while (first < last)
+    {
+        size_t count = min(last - first, batch_max);
+
+        // Os registros são codificados direto da janela para o datagrama
+        WireWriter writer(frame, sizeof(frame), PKT_REPLICATION_BATCH);
+        writer.u32(log_epoch);
+        writer.u16((uint16_t)count);
+        for (size_t i = 0; i < count; ++i)
+            encodeRecord(writer, window[first + i].record);
+        writer.u32(r.base_index);
+
+        sendto(sockfd, frame, writer.finish(), 0, (struct sockaddr *)&r.addr, sizeof(r.addr));
+        first += count;
+    }
+}
 
-    // Configura o conjunto de descritores para o select
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(sockfd, &readfds);
+void ReplicationManager::flush_unsafe(chrono::steady_clock::time_point now)
+{
+    if (next_unsent_index == next_log_index)
+        return;
 
-    // O select espera até que o socket tenha dados para ler OU o tempo acabe.
-    int rv = select(sockfd + 1, &readfds, NULL, NULL, &tv);
+    size_t first = next_unsent_index - window_base;
+    for (const auto &r : replicas)
+    {
+        if (r.active)
+            sendFrames_unsafe(r, first, window.size());
+    }
+    for (size_t i = first; i < window.size(); ++i)
+        window[i].last_sent = now;
+    next_unsent_index = next_log_index;
+}
 
-    if (rv > 0)
+void ReplicationManager::handleReplicationAck(const Packet &pkt, const struct sockaddr_in &sender_addr)
+{
+    vector<pair<ReplicationCallback, bool>> done;
     {
-        // Chegou dados, tenta ler sem bloquear (MSG_DONTWAIT)
-        ssize_t n = recvfrom(sockfd, &response, sizeof(Packet), MSG_DONTWAIT, (struct sockaddr *)&from_addr, &len);
+        lock_guard<mutex> lock(replicas_mutex);
 
-        if (n > 0 && response.type == PKT_REPLICATION_ACK && response.seqn == seqn)
+        if (!is_leader_flag || pkt.rep.log_epoch != log_epoch)
+            return;  // ACK de outra época
+
+        for (auto &r : replicas)
         {
-            acks_received++;
+            if (r.addr.sin_addr.s_addr == sender_addr.sin_addr.s_addr && r.addr.sin_port == sender_addr.sin_port)
+            {
+                auto now = chrono::steady_clock::now();
+                if (r.syncing)
+                {
+                    // ACKs de antes da sincronização não dizem nada; o do corte a encerra
+                    if (pkt.rep.log_index < r.acked_index)
+                        break;
+                    r.syncing = false;
+                    PIX_LOG_INFO(LOG_CAT_REPLICATION, "Replica %d synchronized at log index %u", r.id,
+                                 pkt.rep.log_index);
+                }
+
+                if (pkt.rep.log_index > r.acked_index)
+                {
+                    r.acked_index = pkt.rep.log_index;
+                    r.dup_acks = 0;
+
+                    // Recuperação guiada pelos ACKs: se a próxima entrada já deveria
+                    // ter sido confirmada, a lacuna seguinte é reenviada sem esperar o RTO
+                    size_t next = r.acked_index + 1 - window_base;
+                    if (r.acked_index + 1 >= window_base && r.acked_index + 1 < next_unsent_index &&
+                        now - window[next].last_sent >= chrono::milliseconds(REPLICATION_RTO_MS))
+                    {
+                        resendFrom_unsafe(r, REPLICATION_RETRANSMIT_BURST, now);
+                    }
+                }
+                else if (r.active && r.acked_index + 1 < next_unsent_index && ++r.dup_acks >= REPLICATION_DUP_ACKS)
+                {
+                    // O backup está recebendo entradas depois de uma lacuna: reenvia a que falta
+                    r.dup_acks = 0;
+                    resendFrom_unsafe(r, 1, now);
+                }
+                break;
+            }
         }
+
+        collectCompleted_unsafe(done);
     }
+    window_cv.notify_all();
 
-    return (acks_received >= 1);
+    for (auto &d : done)
+        d.first(d.second);
 }
 
-bool ReplicationManager::replicateNewClient(const string &client_ip)
+void ReplicationManager::collectCompleted_unsafe(vector<pair<ReplicationCallback, bool>> &done)
 {
-    if (!is_leader_flag)
-        return false;
-
-    Packet pkt;
-    memset(&pkt, 0, sizeof(Packet));
-    pkt.type = PKT_REP_CLIENT_REQ;
-    pkt.seqn = 0; // ID irrelevante para criação
+    // Maior índice confirmado por algum backup sincronizado, e o menor entre os
+    // ativos (quem está se sincronizando ainda recebe as entradas da janela)
+    uint32_t max_acked = 0;
+    uint32_t min_acked = UINT32_MAX;
+    bool any_synced = false;
+    for (const auto &r : replicas)
+    {
+        if (!r.active)
+            continue;
+        min_acked = min(min_acked, r.acked_index);
+        if (r.syncing)
+            continue;
+        max_acked = max(max_acked, r.acked_index);
+        any_synced = true;
+    }
 
-    // Usa o campo 'origin_addr' para guardar o IP do novo cliente
-    pkt.rep.origin_addr = ipToUint32(client_ip);
-    pkt.rep.dest_addr = 0;
-    pkt.rep.value = 0;
+    // Só backups se sincronizando: como sem backups, nada a esperar
+    if (!any_synced)
+        max_acked = UINT32_MAX;
 
-    int sent_count = 0;
+    // Basta um backup confirmar para responder ao cliente (como antes, acks >= 1)
+    for (size_t i = 0; i < window.size() && window_base + i <= max_acked; ++i)
+    {
+        if (window[i].on_done)
+            done.emplace_back(move(window[i].on_done), true);
+        window[i].on_done = nullptr;
+    }
 
-    // Envia para todas as réplicas
-    for (const auto &r : replicas)
+    // Sai da janela quando todos os ativos confirmaram (e o cliente já foi respondido)
+    while (!window.empty() && !window.front().on_done && window_base <= min_acked)
     {
-        if (r.active)
-        {
-            sendto(sockfd, &pkt, sizeof(Packet), 0, (struct sockaddr *)&r.addr, sizeof(r.addr));
-            sent_count++;
-        }
+        window.pop_front();
+        window_base++;
     }
+}
 
-    if (sent_count <= 1)
-        return true; // Sem outros servidores não necessita replicação
+// Reenvia para 'r' até 'count' quadros a partir da primeira entrada que ele não
+// confirmou. As seguintes provavelmente já estão no buffer de reordenação do backup.
+// Entradas que ainda não saíram ficam para o próximo quadro.
+void ReplicationManager::resendFrom_unsafe(const ReplicaInfo &r, size_t count, chrono::steady_clock::time_point now)
+{
+    size_t first = (r.acked_index + 1 > window_base) ? r.acked_index + 1 - window_base : 0;
+    size_t last = min(first + count * batch_max, (size_t)(next_unsent_index - window_base));
+    if (first >= last)
+        return;
 
-    // Configura a espera pelo ACK
-    int acks_received = 0;
-    Packet response;
-    struct sockaddr_in from_addr;
-    socklen_t len = sizeof(from_addr);
+    for (size_t i = first; i < last; ++i)
+        window[i].last_sent = now;
+    sendFrames_unsafe(r, first, last);
+}
 
-    // Configura o timeout para o select (200ms)
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 200000;
+// Timer do quadro em formação: envia o que juntou até o prazo
+void ReplicationManager::onBatchDeadline()
+{
+    lock_guard<mutex> lock(replicas_mutex);
+    if (next_unsent_index == next_log_index || loop == nullptr)
+        return;
 
-    // Configura o conjunto de descritores para o select
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(sockfd, &readfds);
+    // O timer pode ser de um quadro anterior (que saiu cheio): espera o prazo do atual
+    auto now = chrono::steady_clock::now();
+    if (now < batch_deadline)
+    {
+        loop->armTimer(batch_timer, chrono::duration_cast<chrono::microseconds>(batch_deadline - now));
+        return;
+    }
+    flush_unsafe(now);
+}
 
-    // O select espera até que o socket tenha dados para ler OU o tempo acabe.
-    int rv = select(sockfd + 1, &readfds, NULL, NULL, &tv);
+// A cada REPLICATION_TICK_MS: prazos dos clientes e retransmissões
+void ReplicationManager::onTick()
+{
+    if (!is_leader_flag)
+    {
+        // Backup: pedido de sincronização sem resposta completa é repetido
+        lock_guard<mutex> lock(apply_mutex);
+        if (syncing)
+            requestSync_unsafe(chrono::steady_clock::now());
+    }
 
-    if (rv > 0)
+    vector<pair<ReplicationCallback, bool>> done;
     {
-        // Chegaram dados, tenta ler sem bloquear (MSG_DONTWAIT)
-        ssize_t n = recvfrom(sockfd, &response, sizeof(Packet), MSG_DONTWAIT, (struct sockaddr *)&from_addr, &len);
+        lock_guard<mutex> lock(replicas_mutex);
+        auto now = chrono::steady_clock::now();
 
-        // Verifica se é ACK de CRIAÇÃO DE CLIENTE (PKT_REP_CLIENT_ACK)
-        if (n > 0 && response.type == PKT_REP_CLIENT_ACK)
+        // Prazo do cliente: responde sem a confirmação, mas segue retransmitindo
+        for (auto &entry : window)
         {
-            acks_received++;
+            if (entry.on_done && now - entry.first_sent >= chrono::milliseconds(REPLICATION_ACK_TIMEOUT_MS))
+            {
+                done.emplace_back(move(entry.on_done), false);
+                entry.on_done = nullptr;
+            }
         }
+
+        for (auto &r : replicas)
+        {
+            if (!r.active || r.acked_index + 1 < window_base || r.acked_index + 1 >= next_unsent_index)
+                continue;
+
+            ReplicationEntry &hole = window[r.acked_index + 1 - window_base];
+            if (now - hole.last_sent < chrono::milliseconds(REPLICATION_RTO_MS))
+                continue;
+
+            if (++hole.retries > REPLICATION_MAX_RETRIES)
+            {
+                // Não responde: sai do fluxo até se anunciar de novo
+                r.active = false;
+                PIX_LOG_WARN(LOG_CAT_REPLICATION,
+                             "Replica %d stopped acknowledging at log index %u; removed from the replication stream",
+                             r.id, r.acked_index + 1);
+                continue;
+            }
+            resendFrom_unsafe(r, REPLICATION_RETRANSMIT_BURST, now);
+        }
+
+        collectCompleted_unsafe(done);
     }
+    window_cv.notify_all();
 
-    return (acks_received >= 1);
+    for (auto &d : done)
+        d.first(d.second);
 }
 
-bool ReplicationManager::replicateQuery(const string &client_ip, uint32_t seqn)
+bool ReplicationManager::hasActiveReplicas_unsafe() const
 {
-    if (!is_leader_flag)
-        return false;
-
-    Packet pkt;
-    memset(&pkt, 0, sizeof(Packet));
-    pkt.type = PKT_REP_QUERY_REQ;   // Define o tipo correto para QUERY
-    pkt.seqn = seqn;                // O ID da requisição é crucial aqui
-    pkt.rep.origin_addr = ipToUint32(client_ip);
-    pkt.rep.dest_addr = 0;          // Não usado em query
-    pkt.rep.value = 0;
-
-    int sent_count = 0;
-
-    // 1. Envia para todas as réplicas ativas
     for (const auto &r : replicas)
     {
         if (r.active)
-        {
-            sendto(sockfd, &pkt, sizeof(Packet), 0, (struct sockaddr *)&r.addr, sizeof(r.addr));
-            sent_count++;
-        }
+            return true;
     }
+    return false;
+}
+
+// A criação entra no fluxo ordenado, como uma transferência: chega aos backups
+// antes de qualquer transferência do cliente e é retransmitida até ser confirmada
+void ReplicationManager::replicateNewClient(uint32_t client_addr, ReplicationCallback on_done)
+{
+    ReplicationRecord record;
+    memset(&record, 0, sizeof(record));
+    record.origin_addr = client_addr;
+    record.dest_addr = REPLICATION_NEW_CLIENT_DEST;
 
-    // Se não houver réplicas (ou só o líder na rede), retorna
-    if (sent_count <= 1)
-        return true; 
+    unique_lock<mutex> lock(replicas_mutex);
 
-    // 2. Espera pelos ACKs
-    int acks_received = 0;
-    Packet response;
-    struct sockaddr_in from_addr;
-    socklen_t len = sizeof(from_addr);
+    // Sem outros servidores não necessita replicação
+    if (!is_leader_flag || !hasActiveReplicas_unsafe())
+    {
+        lock.unlock();
+        on_done(is_leader_flag);
+        return;
+    }
 
-    // Timeout de 200ms
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 200000;
+    // Sem esperar espaço na janela: roda no laço de eventos, que é quem entrega
+    // os ACKs (uma entrada a mais cabe no buffer de reordenação dos backups)
+    appendEntries_unsafe(&record, 1, move(on_done));
+}
+
+// A consulta vai no fluxo ordenado: se fosse avulsa, poderia chegar ao backup
+// antes de uma transferência anterior do cliente ainda no quadro em formação
+void ReplicationManager::replicateQuery(uint32_t client_addr, uint32_t seqn, uint32_t balance,
+                                        ReplicationCallback on_done)
+{
+    ReplicationRecord record;
+    memset(&record, 0, sizeof(record));
+    record.seqn = seqn;
+    record.origin_addr = client_addr;
+    record.dest_addr = REPLICATION_QUERY_DEST;
+    record.final_balance_origin = balance;
+    replicateStates(&record, 1, move(on_done));
+}
 
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(sockfd, &readfds);
+// O estado é copiado com replicas_mutex travado: nenhuma entrada nova entra no
+// fluxo durante a cópia, então ela contém tudo até o corte. Pode conter também
+// transferências efetivadas mas ainda não anexadas; o backup as reconhece pelo
+// last_req de cada conta.
+void ReplicationManager::handleSyncRequest(const Packet &pkt, const struct sockaddr_in &sender_addr)
+{
+    lock_guard<mutex> lock(replicas_mutex);
 
-    int rv = select(sockfd + 1, &readfds, NULL, NULL, &tv);
+    if (!is_leader_flag || pkt.rep.log_epoch != log_epoch)
+        return;
 
-    if (rv > 0)
+    for (auto &r : replicas)
     {
-        // Tenta ler a resposta
-        ssize_t n = recvfrom(sockfd, &response, sizeof(Packet), MSG_DONTWAIT, (struct sockaddr *)&from_addr, &len);
+        if (r.addr.sin_addr.s_addr != sender_addr.sin_addr.s_addr || r.addr.sin_port != sender_addr.sin_port)
+            continue;
+
+        // Fora da confirmação dos clientes até o ACK do corte; as entradas
+        // seguintes continuam indo (e sendo retransmitidas) a partir dele
+        uint32_t cut_index = next_log_index - 1;
+        r.active = true;
+        r.syncing = true;
+        r.acked_index = cut_index;
+        r.base_index = cut_index;
+        r.dup_acks = 0;
+
+        PIX_LOG_INFO(LOG_CAT_REPLICATION, "Replica %d is behind at log index %u; sending state at log index %u",
+                     r.id, pkt.rep.log_index, cut_index);
+        sendSync_unsafe(r, pkt.seqn, cut_index);
+        return;
+    }
+}
 
-        // Verifica se é o ACK de QUERY com o mesmo seqn
-        if (n > 0 && response.type == PKT_REP_QUERY_ACK && response.seqn == seqn)
-        {
-            acks_received++;
-        }
+void ReplicationManager::sendSync_unsafe(const ReplicaInfo &r, uint32_t request_id, uint32_t cut_index)
+{
+    vector<ReplicationSyncClient> clients;
+    uint64_t num_transactions;
+    uint64_t total_transferred;
+    server_db.captureSyncState(clients, num_transactions, total_transferred);
+
+    size_t parts = max<size_t>(1, (clients.size() + REPLICATION_SYNC_CHUNK - 1) / REPLICATION_SYNC_CHUNK);
+    if (parts > UINT16_MAX)
+    {
+        PIX_LOG_ERROR(LOG_CAT_REPLICATION, "State too large to send to replica %d (%zu clients)", r.id,
+                      clients.size());
+        return;
     }
 
-    // Retorna true se pelo menos 1 backup confirmou
-    return (acks_received >= 1);
+    uint8_t frame[WIRE_MAX_DATAGRAM];
+    for (size_t part = 0; part < parts; ++part)
+    {
+        size_t first = part * REPLICATION_SYNC_CHUNK;
+        size_t count = min<size_t>(REPLICATION_SYNC_CHUNK, clients.size() - min(first, clients.size()));
+
+        WireWriter writer(frame, sizeof(frame), PKT_REP_SYNC_DATA);
+        writer.u32(log_epoch);
+        writer.u32(request_id);
+        writer.u32(cut_index);
+        writer.u16((uint16_t)part);
+        writer.u16((uint16_t)parts);
+        writer.u32((uint32_t)(num_transactions >> 32));
+        writer.u32((uint32_t)num_transactions);
+        writer.u32((uint32_t)(total_transferred >> 32));
+        writer.u32((uint32_t)total_transferred);
+        writer.u16((uint16_t)count);
+        for (size_t i = 0; i < count; ++i)
+            encodeSyncClient(writer, clients[first + i]);
+
+        sendto(sockfd, frame, writer.finish(), 0, (struct sockaddr *)&r.addr, sizeof(r.addr));
+    }
 }
 
 // LÓGICA DO BACKUP
@@ -237,74 +584,280 @@ void ReplicationManager::handleReplicationMessage(const Packet &pkt, const struc
 
     if (pkt.type == PKT_REP_CLIENT_REQ)
     {
-        string client_ip = uint32ToIp(pkt.rep.origin_addr);
-
+        // Líder de versão anterior (o atual cria o cliente pelo fluxo de replicação).
         // Aplica no DB Local do Backup
-        server_db.addClient(client_ip);
-        server_db.updateBankSummary();
-        // Envia ACK de volta
+        server_db.addClient(pkt.rep.origin_addr);
+        // Envia ACK de volta, com a chave (seqn, cliente) que o líder espera
         Packet ack;
         ack.type = PKT_REP_CLIENT_ACK;
-        sendto(sockfd, &ack, sizeof(Packet), 0, (struct sockaddr *)&sender_addr, sizeof(sender_addr));
+        ack.seqn = pkt.seqn;
+        ack.rep.origin_addr = pkt.rep.origin_addr;
+        sendDatagram(sockfd, ack, sender_addr, sizeof(sender_addr));
     }
 
     if (pkt.type == PKT_REP_QUERY_REQ){
-        // Converter uint32 para string antes de passar ao banco
-        string client_ip = uint32ToIp(pkt.rep.origin_addr);
-        
+        // Líder de versão anterior (o atual manda a consulta pelo fluxo de replicação).
         // Atualiza apenas o número de sequência
-        server_db.updateClientLastReq(client_ip, pkt.seqn);
+        server_db.updateClientLastReq(pkt.rep.origin_addr, pkt.seqn);
         
         Packet ack;
-        memset(&ack, 0, sizeof(Packet));
         ack.type = PKT_REP_QUERY_ACK;
-        ack.seqn = pkt.seqn; // Devolve o seqn para o Líder validar
+        ack.seqn = pkt.seqn; // Devolve o seqn e o cliente para o Líder validar
+        ack.rep.origin_addr = pkt.rep.origin_addr;
         
-        sendto(sockfd, &ack, sizeof(Packet), 0, (struct sockaddr *)&sender_addr, sizeof(sender_addr));
+        sendDatagram(sockfd, ack, sender_addr, sizeof(sender_addr));
         return;
     }
 
     if (pkt.type != PKT_REPLICATION_REQ)
         return;
 
-    // 1. Converte dados de volta (Uint32 -> String)
-    string origin_ip = uint32ToIp(pkt.rep.origin_addr);
-    string dest_ip = uint32ToIp(pkt.rep.dest_addr);
+    // Transferência avulsa: um quadro de um registro só
+    ReplicationRecord record;
+    record.log_index = pkt.rep.log_index;
+    record.seqn = pkt.seqn;
+    record.origin_addr = pkt.rep.origin_addr;
+    record.dest_addr = pkt.rep.dest_addr;
+    record.value = pkt.rep.value;
+    record.final_balance_origin = pkt.rep.final_balance_origin;
+    record.final_balance_dest = pkt.rep.final_balance_dest;
+    acceptRecords(pkt.rep.log_epoch, 0, &record, 1, sender_addr);
+}
+
+void ReplicationManager::handleReplicationBatch(const ReplicationBatchView &batch,
+                                                const struct sockaddr_in &sender_addr)
+{
+    if (is_leader_flag)
+        return;
+
+    if (!batch.valid())
+    {
+        PIX_LOG_DEBUG(LOG_CAT_REPLICATION, "Truncated replication batch. Ignoring.");
+        return;
+    }
 
-    // Verifica se já processamos essa requisição antes de tentar aplicar no banco
-    uint32_t last_processed = server_db.getClientLastReq(origin_ip);
+    ReplicationRecord records[REPLICATION_BATCH_MAX];
+    for (size_t i = 0; i < batch.count(); ++i)
+        records[i] = batch.record(i);
+    acceptRecords(batch.epoch(), batch.baseIndex(), records, batch.count(), sender_addr);
+}
+
+// Transferências chegam numeradas e são aplicadas estritamente na ordem do
+// líder (os saldos replicados são absolutos: fora de ordem, um saldo antigo
+// sobrescreveria um novo). O ACK é cumulativo: tudo até applied_index, um só
+// por quadro recebido. Nenhuma entrada é pulada: atrás do fluxo, o backup pede
+// o estado ao líder e só confirma o que de fato aplicou.
+void ReplicationManager::acceptRecords(uint32_t epoch, uint32_t base_index, const ReplicationRecord *records,
+                                       size_t count, const struct sockaddr_in &sender_addr)
+{
+    uint64_t ack_lsn;
+    uint32_t ack_index;
+    uint32_t ack_epoch;
+    vector<ReplicationRecord> applied;
 
-    if (pkt.seqn <= last_processed)
     {
-        // Já processado, apenas envia o ACK novamente para garantir que o Líder receba.
-        log_message("Mensagem de atualização duplicada. Atualização já efetuada");
+        lock_guard<mutex> lock(apply_mutex);
+        auto now = chrono::steady_clock::now();
+
+        // Novo líder: a contagem recomeça
+        if (epoch != applied_epoch)
+        {
+            applied_epoch = epoch;
+            applied_index = 0;
+            reorder_buffer.clear();
+            sync_included.clear();
+            resetSync_unsafe();
+        }
+        sync_leader_addr = sender_addr;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (records[i].log_index <= applied_index)
+            {
+                // Já aplicado (retransmissão): só confirma de novo
+                PIX_LOG_TRACE(LOG_CAT_REPLICATION, "Mensagem de atualização duplicada. Atualização já efetuada");
+            }
+            else if (reorder_buffer.size() < 2 * REPLICATION_WINDOW)
+            {
+                if (reorder_buffer.empty())
+                    gap_since = now;
+                reorder_buffer.emplace(records[i].log_index, records[i]);
+            }
+        }
+
+        // Entrou (ou voltou) no meio da época, ou a lacuna não se fechou a
+        // tempo: o líder não vai mandar essas entradas, então pede o estado
+        if (base_index > applied_index ||
+            (!reorder_buffer.empty() && reorder_buffer.begin()->first != applied_index + 1 &&
+             now - gap_since >= chrono::milliseconds(REPLICATION_GAP_TIMEOUT_MS)))
+        {
+            requestSync_unsafe(now);
+        }
+
+        applyContiguous_unsafe(now, applied);
+
+        // Mesmo sem nada novo, o ACK cobre entradas anteriores que podem não estar em disco
+        ack_lsn = applied_lsn;
+        ack_index = applied_index;
+        ack_epoch = applied_epoch;
+    }
+
+    finishApply(applied, ack_lsn, ack_index, ack_epoch, sender_addr);
+}
+
+// APLICAÇÃO PASSIVA DO ESTADO, em ordem: o trecho contínuo inteiro de uma vez,
+// com as partições envolvidas travadas uma única vez
+void ReplicationManager::applyContiguous_unsafe(chrono::steady_clock::time_point now,
+                                                vector<ReplicationRecord> &applied)
+{
+    while (!reorder_buffer.empty() && reorder_buffer.begin()->first == applied_index + 1)
+    {
+        const ReplicationRecord &record = reorder_buffer.begin()->second;
+
+        // Já contida no estado recebido do líder (efetivada antes do corte)
+        auto included = sync_included.find(record.origin_addr);
+        if (included != sync_included.end() && record.seqn <= included->second)
+        {
+            PIX_LOG_TRACE(LOG_CAT_REPLICATION, "Entry %u already in the synchronized state", record.log_index);
+        }
+        else
+        {
+            if (included != sync_included.end())
+                sync_included.erase(included);
+            applied.push_back(record);
+        }
+
+        applied_index++;
+        reorder_buffer.erase(reorder_buffer.begin());
+        gap_since = now;
+    }
+    if (!applied.empty())
+        applied_lsn = max(applied_lsn, server_db.applyReplicatedBatch(applied.data(), applied.size()));
+}
+
+void ReplicationManager::finishApply(const vector<ReplicationRecord> &applied, uint64_t ack_lsn, uint32_t ack_index,
+                                     uint32_t ack_epoch, const struct sockaddr_in &leader_addr)
+{
+    for (const auto &entry : applied)
+    {
+        if (!isTransferRecord(entry))
+            continue;
+        server_interface.logRequest(entry.origin_addr, entry.seqn, entry.dest_addr, entry.value);
+    }
+
+    // Só confirma ao líder depois que o backup também tem as transferências em
+    // disco. Sem bloquear quem recebeu o quadro: os callbacks rodam em ordem de
+    // LSN, então os ACKs cumulativos saem em ordem.
+    int fd = sockfd;
+    transaction_log.whenDurable(ack_lsn, [fd, leader_addr, ack_index, ack_epoch]()
+    {
         Packet ack;
-        memset(&ack, 0, sizeof(Packet));
         ack.type = PKT_REPLICATION_ACK;
-        ack.seqn = pkt.seqn;
-        sendto(sockfd, &ack, sizeof(Packet), 0, (struct sockaddr *)&sender_addr, sizeof(sender_addr));
+        ack.rep.log_index = ack_index;
+        ack.rep.log_epoch = ack_epoch;
+        sendDatagram(fd, ack, leader_addr, sizeof(leader_addr));
+    });
+}
+
+void ReplicationManager::requestSync_unsafe(chrono::steady_clock::time_point now)
+{
+    if (syncing && now - sync_requested < chrono::milliseconds(REPLICATION_SYNC_RETRY_MS))
+        return;
+
+    if (!syncing)
+        PIX_LOG_WARN(LOG_CAT_REPLICATION, "Behind the replication stream at log index %u; requesting the leader's state",
+                     applied_index);
+
+    // Cada pedido tem um número novo: partes de um pedido anterior não se misturam
+    resetSync_unsafe();
+    syncing = true;
+    sync_request_id++;
+    sync_requested = now;
+
+    Packet req;
+    memset(&req, 0, sizeof(req));
+    req.type = PKT_REP_SYNC_REQ;
+    req.seqn = sync_request_id;
+    req.rep.log_index = applied_index;
+    req.rep.log_epoch = applied_epoch;
+    sendDatagram(sockfd, req, sync_leader_addr, sizeof(sync_leader_addr));
+}
+
+void ReplicationManager::resetSync_unsafe()
+{
+    syncing = false;
+    sync_parts = 0;
+    sync_received = 0;
+    sync_have.clear();
+    sync_clients.clear();
+}
+
+void ReplicationManager::handleSyncData(const ReplicationSyncView &sync, const struct sockaddr_in &sender_addr)
+{
+    if (is_leader_flag)
+        return;
+
+    if (!sync.valid())
+    {
+        PIX_LOG_DEBUG(LOG_CAT_REPLICATION, "Truncated state transfer. Ignoring.");
         return;
     }
 
-    // APLICAÇÃO PASSIVA DO ESTADO
-    // O Backup usa "applyState"
-    server_db.forceClientBalance(origin_ip, pkt.rep.final_balance_origin);
-    server_db.forceClientBalance(dest_ip, pkt.rep.final_balance_dest);
-    server_db.addTransaction_unsafe(origin_ip, pkt.seqn, dest_ip, pkt.rep.value);
-    server_db.updateClientLastReq_unsafe(origin_ip, pkt.seqn);
-    server_db.updateBankSummary_unsafe();
-
-    string msg_log = "client " + origin_ip + 
-                     " id_req " + to_string(pkt.seqn) +
-                     " dest " + dest_ip + 
-                     " value " + to_string(pkt.rep.value);
-    
-    server_interface.notifyUpdate(msg_log);
-
-    // Envia ACK
-    Packet ack;
-    memset(&ack, 0, sizeof(Packet));
-    ack.type = PKT_REPLICATION_ACK;
-    ack.seqn = pkt.seqn; 
-    sendto(sockfd, &ack, sizeof(Packet), 0, (struct sockaddr*)&sender_addr, sizeof(sender_addr));
-}
\ No newline at end of file
+    uint64_t ack_lsn;
+    uint32_t ack_index;
+    uint32_t ack_epoch;
+    vector<ReplicationRecord> applied;
+
+    {
+        lock_guard<mutex> lock(apply_mutex);
+
+        // Parte de um pedido já respondido, abandonado ou de outra época
+        if (!syncing || sync.epoch() != applied_epoch || sync.requestId() != sync_request_id)
+            return;
+
+        if (sync_parts == 0)
+        {
+            sync_parts = sync.parts();
+            sync_index = sync.syncIndex();
+            sync_num_transactions = sync.numTransactions();
+            sync_total_transferred = sync.totalTransferred();
+            sync_have.assign(sync_parts, false);
+        }
+        if (sync.parts() != sync_parts || sync.syncIndex() != sync_index || sync_have[sync.part()])
+            return;
+
+        sync_have[sync.part()] = true;
+        sync_received++;
+        for (size_t i = 0; i < sync.count(); ++i)
+            sync_clients.push_back(sync.client(i));
+
+        // Uma parte perdida: o pedido é repetido pelo timer
+        if (sync_received < sync_parts)
+            return;
+
+        server_db.installSyncState(sync_clients, sync_num_transactions, sync_total_transferred);
+
+        sync_included.clear();
+        for (const auto &c : sync_clients)
+            sync_included[c.addr] = c.last_req;
+
+        PIX_LOG_INFO(LOG_CAT_REPLICATION, "Installed the leader's state at log index %u (%zu clients)", sync_index,
+                     sync_clients.size());
+
+        // O estado instalado não passa pelo WAL: só confirma o corte com ele em disco
+        if (!snapshot_manager.writeNow())
+            PIX_LOG_WARN(LOG_CAT_REPLICATION, "No snapshot of the synchronized state; it is not durable");
+
+        applied_index = sync_index;
+        reorder_buffer.erase(reorder_buffer.begin(), reorder_buffer.upper_bound(sync_index));
+        resetSync_unsafe();
+
+        applyContiguous_unsafe(chrono::steady_clock::now(), applied);
+
+        ack_lsn = applied_lsn;
+        ack_index = applied_index;
+        ack_epoch = applied_epoch;
+    }
+
+    finishApply(applied, ack_lsn, ack_index, ack_epoch, sender_addr);
+}
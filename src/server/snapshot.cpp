@@ -0,0 +1,211 @@
+#include "server/snapshot.h"
+#include "server/database.h"
+#include "server/wal.h"
+#include "common/utils.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <chrono>
+
+SnapshotManager snapshot_manager;
+
+static bool writeAll(int fd, const void* data, size_t len) {
+    const char* bytes = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, bytes, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += n;
+        len -= n;
+    }
+    return true;
+}
+
+// fsync do diretório, para o rename sobreviver a uma queda
+static void syncParentDir(const string& path) {
+    size_t slash = path.rfind('/');
+    string dir = (slash == string::npos) ? "." : path.substr(0, slash == 0 ? 1 : slash);
+
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+/* === Gravação === */
+
+bool SnapshotManager::write(const string& path, const ServerDatabase& db, TransactionLog* log) {
+    string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        PIX_LOG_ERROR(LOG_CAT_STORAGE, "ERROR: could not create snapshot %s: %s", tmp_path.c_str(), strerror(errno));
+        return false;
+    }
+
+    SnapshotFileHeader file_header;
+    memset(&file_header, 0, sizeof(file_header));
+    file_header.magic = SNAPSHOT_MAGIC;
+    file_header.version = SNAPSHOT_VERSION;
+    file_header.num_shards = (uint32_t)ServerDatabase::shardCount();
+    // Antes de copiar qualquer partição: tudo até aqui está em todas elas
+    file_header.start_lsn = (log != nullptr) ? log->lastLsn() : 0;
+
+    // Cabeçalho provisório; o definitivo (com CRC e tamanho) vai no final
+    bool ok = writeAll(fd, &file_header, sizeof(file_header));
+
+    uint64_t last_lsn = file_header.start_lsn;
+    uint32_t crc = 0;
+    vector<SnapshotClient> clients;
+
+    // Uma partição por vez: só ela fica travada (para leitura) durante a cópia
+    for (size_t i = 0; ok && i < ServerDatabase::shardCount(); ++i) {
+        SnapshotShardHeader shard_header;
+        db.captureShard(i, clients, shard_header);
+        last_lsn = max(last_lsn, shard_header.cut_lsn);
+
+        size_t clients_size = clients.size() * sizeof(SnapshotClient);
+        crc = crc32(&shard_header, sizeof(shard_header), crc);
+        crc = crc32(clients.data(), clients_size, crc);
+        file_header.payload_size += sizeof(shard_header) + clients_size;
+
+        ok = writeAll(fd, &shard_header, sizeof(shard_header)) && writeAll(fd, clients.data(), clients_size);
+    }
+
+    file_header.crc = crc;
+    ok = ok && pwrite(fd, &file_header, sizeof(file_header), 0) == (ssize_t)sizeof(file_header);
+
+    // O snapshot não pode estar à frente do log em disco: se o servidor cair,
+    // os LSNs não duráveis seriam reutilizados e pulados no próximo replay.
+    if (ok && log != nullptr) log->waitDurable(last_lsn);
+
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        PIX_LOG_ERROR(LOG_CAT_STORAGE, "ERROR writing snapshot %s: %s", path.c_str(), strerror(errno));
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    syncParentDir(path);
+    return true;
+}
+
+/* === Leitura === */
+
+bool SnapshotManager::load(const string& path, ServerDatabase& db, SnapshotInfo& info) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;  // Ainda não há snapshot
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotFileHeader)) {
+        close(fd);
+        PIX_LOG_WARN(LOG_CAT_STORAGE, "Snapshot %s is truncated, ignoring it", path.c_str());
+        return false;
+    }
+
+    size_t size = st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        PIX_LOG_ERROR(LOG_CAT_STORAGE, "ERROR: could not map snapshot %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const uint8_t* base = static_cast<const uint8_t*>(map);
+    const SnapshotFileHeader* file_header = reinterpret_cast<const SnapshotFileHeader*>(base);
+    const uint8_t* payload = base + sizeof(SnapshotFileHeader);
+
+    // Valida tudo antes de tocar no banco
+    bool valid = file_header->magic == SNAPSHOT_MAGIC && file_header->version == SNAPSHOT_VERSION &&
+                 file_header->num_shards == ServerDatabase::shardCount() &&
+                 file_header->payload_size == size - sizeof(SnapshotFileHeader) &&
+                 crc32(payload, file_header->payload_size) == file_header->crc;
+
+    if (!valid) {
+        munmap(map, size);
+        PIX_LOG_WARN(LOG_CAT_STORAGE, "Snapshot %s is invalid or from another version, ignoring it", path.c_str());
+        return false;
+    }
+
+    info.start_lsn = file_header->start_lsn;
+    info.last_lsn = file_header->start_lsn;
+    info.num_clients = 0;
+
+    const uint8_t* cursor = payload;
+    for (size_t i = 0; i < file_header->num_shards; ++i) {
+        const SnapshotShardHeader* shard_header = reinterpret_cast<const SnapshotShardHeader*>(cursor);
+        const SnapshotClient* clients = reinterpret_cast<const SnapshotClient*>(cursor + sizeof(SnapshotShardHeader));
+
+        db.restoreShard(i, clients, *shard_header);
+
+        info.last_lsn = max(info.last_lsn, shard_header->cut_lsn);
+        info.num_clients += shard_header->num_clients;
+        cursor += sizeof(SnapshotShardHeader) + shard_header->num_clients * sizeof(SnapshotClient);
+    }
+
+    munmap(map, size);
+    return true;
+}
+
+/* === Thread periódica === */
+
+SnapshotManager::SnapshotManager() : _db(nullptr), _log(nullptr), _interval_s(0), _running(false) {}
+
+SnapshotManager::~SnapshotManager() { stop(); }
+
+void SnapshotManager::start(const string& path, ServerDatabase& db, TransactionLog& log, unsigned int interval_s) {
+    {
+        lock_guard<mutex> lk(_write_mutex);
+        _path = path;
+        _db = &db;
+        _log = &log;
+    }
+    if (interval_s == 0) return;
+
+    bool expected = false;
+    if (!_running.compare_exchange_strong(expected, true)) return;
+
+    _interval_s = interval_s;
+    _thread = thread(&SnapshotManager::snapshotLoop, this);
+}
+
+void SnapshotManager::stop() {
+    bool expected = true;
+    if (_running.compare_exchange_strong(expected, false)) {
+        {
+            lock_guard<mutex> lk(_mutex);
+        }
+        _cv.notify_all();
+        if (_thread.joinable()) _thread.join();
+    }
+}
+
+void SnapshotManager::snapshotLoop() {
+    while (true) {
+        {
+            unique_lock<mutex> lk(_mutex);
+            _cv.wait_for(lk, chrono::seconds(_interval_s), [&] { return !_running; });
+            if (!_running) break;
+        }
+
+        writeNow();
+    }
+}
+
+bool SnapshotManager::writeNow() {
+    lock_guard<mutex> lk(_write_mutex);
+    if (_db == nullptr) return false;
+
+    auto start = chrono::steady_clock::now();
+    if (!write(_path, *_db, _log)) return false;
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+    PIX_LOG_INFO(LOG_CAT_STORAGE, "Snapshot written to %s (%lld ms)", _path.c_str(), (long long)elapsed.count());
+    return true;
+}
@@ -0,0 +1,389 @@
+#include "server/uring_io.h"
+#include "common/utils.h"
+#include <atomic>
+
+#ifdef PIX_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+// Grupo do anel de buffers fornecidos (um por anel de recepção)
+#define URING_BUFFER_GROUP 0
+// Cada buffer: cabeçalho do recvmsg multishot + endereço + datagrama
+#define URING_RECV_BUFFER_SIZE \
+    ((sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + sizeof(WireDatagram) + 63) & ~(size_t)63)
+
+// Entrada i do anel de buffers. Não usa io_uring_buf_ring::bufs: em C++ o
+// __DECLARE_FLEX_ARRAY do cabeçalho desloca o vetor em 8 bytes.
+static inline struct io_uring_buf* ringBuf(void* buf_ring, unsigned i) {
+    return (struct io_uring_buf*)buf_ring + i;
+}
+
+static atomic<uint64_t> enter_calls(0);
+static atomic<bool> uring_enabled(true);
+// RECVMSG multishot aceito pelo kernel: -1 ainda não testado, 0 não, 1 sim
+static atomic<int> multishot_supported(-1);
+
+// Anel mapeado do kernel: fila de submissão (SQ) e de conclusão (CQ)
+struct UringRing {
+    int fd = -1;
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_len = 0;
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_len = 0;
+    struct io_uring_sqe* sqes = (struct io_uring_sqe*)MAP_FAILED;
+    size_t sqes_len = 0;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_flags;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned sq_entries;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    unsigned to_submit = 0;
+};
+
+static void ringClose(UringRing& r) {
+    if (r.sqes != MAP_FAILED) munmap(r.sqes, r.sqes_len);
+    if (r.cq_ptr != MAP_FAILED && r.cq_ptr != r.sq_ptr) munmap(r.cq_ptr, r.cq_len);
+    if (r.sq_ptr != MAP_FAILED) munmap(r.sq_ptr, r.sq_len);
+    if (r.fd >= 0) close(r.fd);
+    r = UringRing();
+}
+
+// cq_entries = 0 usa o padrão do kernel (o dobro das entradas da SQ)
+static bool ringSetup(UringRing& r, unsigned entries, unsigned cq_entries = 0) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    if (cq_entries > 0) {
+        p.flags |= IORING_SETUP_CQSIZE;
+        p.cq_entries = cq_entries;
+    }
+
+    r.fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r.fd < 0) return false;
+
+    r.sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r.cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) r.sq_len = r.cq_len = (r.sq_len > r.cq_len) ? r.sq_len : r.cq_len;
+
+    r.sq_ptr = mmap(nullptr, r.sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, IORING_OFF_SQ_RING);
+    if (r.sq_ptr == MAP_FAILED) {
+        ringClose(r);
+        return false;
+    }
+    r.cq_ptr = single_mmap ? r.sq_ptr
+                           : mmap(nullptr, r.cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd,
+                                  IORING_OFF_CQ_RING);
+    r.sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r.sqes = (struct io_uring_sqe*)mmap(nullptr, r.sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                        r.fd, IORING_OFF_SQES);
+    if (r.cq_ptr == MAP_FAILED || r.sqes == MAP_FAILED) {
+        ringClose(r);
+        return false;
+    }
+
+    char* sq = (char*)r.sq_ptr;
+    r.sq_head = (unsigned*)(sq + p.sq_off.head);
+    r.sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    r.sq_flags = (unsigned*)(sq + p.sq_off.flags);
+    r.sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    r.sq_array = (unsigned*)(sq + p.sq_off.array);
+    r.sq_entries = p.sq_entries;
+
+    char* cq = (char*)r.cq_ptr;
+    r.cq_head = (unsigned*)(cq + p.cq_off.head);
+    r.cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    r.cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    r.cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    return true;
+}
+
+// Próxima entrada livre da SQ (zerada), ou nullptr com a fila cheia
+static struct io_uring_sqe* ringGetSqe(UringRing& r) {
+    unsigned tail = *r.sq_tail;
+    if (tail - __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE) >= r.sq_entries) return nullptr;
+
+    unsigned index = tail & *r.sq_mask;
+    struct io_uring_sqe* sqe = &r.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    r.sq_array[index] = index;
+    return sqe;
+}
+
+// Publica a entrada preenchida por último em ringGetSqe
+static void ringPublish(UringRing& r) {
+    __atomic_store_n(r.sq_tail, *r.sq_tail + 1, __ATOMIC_RELEASE);
+    r.to_submit++;
+}
+
+// Submete o que foi publicado e, com wait_nr > 0 (ou get_events), espera
+// essas conclusões e traz para a CQ as que transbordaram
+static int ringEnter(UringRing& r, unsigned wait_nr, bool get_events = false) {
+    unsigned flags = (wait_nr > 0 || get_events) ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    do {
+        enter_calls.fetch_add(1, memory_order_relaxed);
+        ret = (int)syscall(__NR_io_uring_enter, r.fd, r.to_submit, wait_nr, flags, nullptr, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret > 0) r.to_submit -= (unsigned)ret;
+    return ret;
+}
+
+bool uringAvailable() {
+    static const bool supported = [] {  // Testado uma vez (o resultado não muda)
+        UringRing probe;
+        bool ok = ringSetup(probe, 2);
+        ringClose(probe);
+        return ok;
+    }();
+    return uring_enabled && supported;
+}
+
+void setUringIo(bool enabled) { uring_enabled = enabled; }
+
+/* === Recepção === */
+
+UringReceiver::UringReceiver()
+    : _ring(nullptr), _sockfd(-1), _buffers((char*)MAP_FAILED), _buf_ring(MAP_FAILED), _armed(false) {
+    memset(&_msg, 0, sizeof(_msg));
+}
+
+UringReceiver::~UringReceiver() {
+    if (_ring != nullptr) {
+        ringClose(*_ring);
+        delete _ring;
+    }
+    if (_buf_ring != MAP_FAILED) munmap(_buf_ring, URING_RECV_BUFFERS * sizeof(struct io_uring_buf));
+    if (_buffers != MAP_FAILED) munmap(_buffers, URING_RECV_BUFFERS * URING_RECV_BUFFER_SIZE);
+}
+
+bool UringReceiver::open(int sockfd) {
+    if (!uringAvailable() || multishot_supported == 0) return false;
+
+    _sockfd = sockfd;
+    // Uma conclusão por buffer em uso, com folga para as de erro/rearme
+    _ring = new UringRing();
+    if (!ringSetup(*_ring, 8, 2 * URING_RECV_BUFFERS)) return false;
+
+    _buffers = (char*)mmap(nullptr, URING_RECV_BUFFERS * URING_RECV_BUFFER_SIZE, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    _buf_ring = mmap(nullptr, URING_RECV_BUFFERS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (_buffers == MAP_FAILED || _buf_ring == MAP_FAILED) return false;
+
+    // Registra o anel de buffers fornecidos no grupo URING_BUFFER_GROUP
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)_buf_ring;
+    reg.ring_entries = URING_RECV_BUFFERS;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (syscall(__NR_io_uring_register, _ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        PIX_LOG_ERROR(LOG_CAT_NET, "ERROR registering io_uring buffer ring");
+        return false;
+    }
+
+    struct io_uring_buf_ring* br = (struct io_uring_buf_ring*)_buf_ring;
+    for (uint16_t bid = 0; bid < URING_RECV_BUFFERS; ++bid) {
+        struct io_uring_buf* buf = ringBuf(_buf_ring, bid);
+        buf->addr = (uint64_t)(uintptr_t)(_buffers + (size_t)bid * URING_RECV_BUFFER_SIZE);
+        buf->len = URING_RECV_BUFFER_SIZE;
+        buf->bid = bid;
+    }
+    __atomic_store_n(&br->tail, (uint16_t)URING_RECV_BUFFERS, __ATOMIC_RELEASE);
+
+    // O multishot só lê o tamanho do endereço e do controle deste msghdr
+    _msg.msg_namelen = sizeof(struct sockaddr_in);
+    _msg.msg_controllen = 0;
+
+    arm();
+    if (!_armed) return false;
+
+    // Testado uma vez, no primeiro socket: sem o multishot (kernel anterior ao
+    // 6.0) a entrada é recusada já na submissão, com -EINVAL e sem F_MORE, e
+    // rearmar a cada conclusão giraria para sempre. O chamador usa o recvmmsg.
+    if (multishot_supported < 0) {
+        ringEnter(*_ring, 0, true);
+        bool refused = false;
+        unsigned tail = __atomic_load_n(_ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (unsigned head = *_ring->cq_head; head != tail; ++head) {
+            struct io_uring_cqe* cqe = &_ring->cqes[head & *_ring->cq_mask];
+            if (cqe->res < 0 && cqe->res != -ENOBUFS && !(cqe->flags & IORING_CQE_F_MORE)) refused = true;
+        }
+        multishot_supported = refused ? 0 : 1;
+        if (refused) PIX_LOG_WARN(LOG_CAT_NET, "Kernel refused io_uring multishot receive");
+    }
+    return multishot_supported == 1;
+}
+
+int UringReceiver::ringFd() const { return _ring != nullptr ? _ring->fd : -1; }
+
+void UringReceiver::arm() {
+    struct io_uring_sqe* sqe = ringGetSqe(*_ring);
+    if (sqe == nullptr) return;
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = _sockfd;
+    sqe->addr = (uint64_t)(uintptr_t)&_msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    ringPublish(*_ring);
+
+    _armed = ringEnter(*_ring, 0) >= 0;
+    if (!_armed) PIX_LOG_ERROR(LOG_CAT_NET, "ERROR arming io_uring multishot receive");
+}
+
+// Devolve o buffer ao anel (visível ao kernel quando o tail for publicado)
+void UringReceiver::recycle(uint16_t bid) {
+    struct io_uring_buf_ring* br = (struct io_uring_buf_ring*)_buf_ring;
+    uint16_t tail = br->tail;
+    struct io_uring_buf* buf = ringBuf(_buf_ring, tail & (URING_RECV_BUFFERS - 1));
+    buf->addr = (uint64_t)(uintptr_t)(_buffers + (size_t)bid * URING_RECV_BUFFER_SIZE);
+    buf->len = URING_RECV_BUFFER_SIZE;
+    buf->bid = bid;
+    __atomic_store_n(&br->tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+}
+
+size_t UringReceiver::drain(const UringDatagramHandler& handler) {
+    size_t delivered = 0;
+    unsigned head = *_ring->cq_head;
+    unsigned tail = __atomic_load_n(_ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head) {
+        struct io_uring_cqe* cqe = &_ring->cqes[head & *_ring->cq_mask];
+
+        // Sem F_MORE o multishot terminou (ex.: acabaram os buffers): repostar
+        if (!(cqe->flags & IORING_CQE_F_MORE)) _armed = false;
+        if (cqe->res < 0) {
+            if (cqe->res != -ENOBUFS) PIX_LOG_ERROR(LOG_CAT_NET, "ERROR on io_uring receive");
+            continue;
+        }
+        if (!(cqe->flags & IORING_CQE_F_BUFFER)) continue;
+
+        uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        char* buf = _buffers + (size_t)bid * URING_RECV_BUFFER_SIZE;
+        struct io_uring_recvmsg_out* out = (struct io_uring_recvmsg_out*)buf;
+        char* name = buf + sizeof(struct io_uring_recvmsg_out);
+        char* payload = name + _msg.msg_namelen + _msg.msg_controllen;
+
+        if (!(out->flags & MSG_TRUNC) && out->namelen >= sizeof(struct sockaddr_in)) {
+            struct sockaddr_in sender;
+            memcpy(&sender, name, sizeof(sender));
+
+            handler((const uint8_t*)payload, out->payloadlen, sender, sizeof(sender));
+            delivered++;
+        }
+        recycle(bid);
+    }
+    __atomic_store_n(_ring->cq_head, head, __ATOMIC_RELEASE);
+
+    // Conclusões que não couberam na CQ só voltam com um enter; o fd do anel
+    // continua legível até lá e o laço de eventos chama drain de novo
+    if (__atomic_load_n(_ring->sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW) ringEnter(*_ring, 0, true);
+
+    if (!_armed) arm();
+    return delivered;
+}
+
+/* === Envio === */
+
+// Anel de envio da thread, com os msghdr que as entradas apontam
+struct UringSender {
+    UringRing ring;
+    bool tried = false;
+    bool ok = false;
+    struct msghdr msgs[URING_SEND_ENTRIES];
+
+    ~UringSender() {
+        if (ok) ringClose(ring);
+    }
+};
+
+static thread_local UringSender sender;
+
+bool uringSendBatch(const int* fds, const struct iovec* datagrams, const struct sockaddr_in* addrs,
+                    const socklen_t* addrlens, size_t n) {
+    if (!sender.tried) {
+        sender.tried = true;
+        sender.ok = uringAvailable() && ringSetup(sender.ring, URING_SEND_ENTRIES);
+    }
+    if (!sender.ok) return false;
+
+    size_t first = 0;
+    while (first < n) {
+        size_t count = 0;
+        for (; first + count < n && count < URING_SEND_ENTRIES; ++count) {
+            struct io_uring_sqe* sqe = ringGetSqe(sender.ring);
+            if (sqe == nullptr) break;
+
+            size_t i = first + count;
+            memset(&sender.msgs[count], 0, sizeof(struct msghdr));
+            sender.msgs[count].msg_name = (void*)&addrs[i];
+            sender.msgs[count].msg_namelen = addrlens[i];
+            sender.msgs[count].msg_iov = (struct iovec*)&datagrams[i];
+            sender.msgs[count].msg_iovlen = 1;
+
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = fds[i];
+            sqe->addr = (uint64_t)(uintptr_t)&sender.msgs[count];
+            sqe->len = 1;
+            ringPublish(sender.ring);
+        }
+
+        // Uma chamada submete o lote e espera as conclusões (os msghdr são reusados)
+        unsigned completed = 0;
+        if (ringEnter(sender.ring, (unsigned)count) < 0) {
+            PIX_LOG_ERROR(LOG_CAT_NET, "ERROR on io_uring_enter (send)");
+            return false;
+        }
+        while (completed < count) {
+            unsigned head = *sender.ring.cq_head;
+            unsigned tail = __atomic_load_n(sender.ring.cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head, ++completed) {
+                if (sender.ring.cqes[head & *sender.ring.cq_mask].res < 0) PIX_LOG_ERROR(LOG_CAT_NET, "ERROR on io_uring send");
+            }
+            __atomic_store_n(sender.ring.cq_head, head, __ATOMIC_RELEASE);
+            if (completed < count) ringEnter(sender.ring, (unsigned)(count - completed));
+        }
+        first += count;
+    }
+    return true;
+}
+
+uint64_t uringEnterCalls() { return enter_calls.load(memory_order_relaxed); }
+
+#else  // Sem PIX_IO_URING: sempre o caminho epoll + recvmmsg/sendmmsg
+
+struct UringRing {};
+
+bool uringAvailable() { return false; }
+void setUringIo(bool) {}
+
+UringReceiver::UringReceiver() : _ring(nullptr), _sockfd(-1), _buffers(nullptr), _buf_ring(nullptr), _armed(false) {}
+UringReceiver::~UringReceiver() {}
+bool UringReceiver::open(int) { return false; }
+int UringReceiver::ringFd() const { return -1; }
+void UringReceiver::arm() {}
+void UringReceiver::recycle(uint16_t) {}
+size_t UringReceiver::drain(const UringDatagramHandler&) { return 0; }
+
+bool uringSendBatch(const int*, const struct iovec*, const struct sockaddr_in*, const socklen_t*, size_t) {
+    return false;
+}
+
+uint64_t uringEnterCalls() { return 0; }
+
+#endif
@@ -0,0 +1,264 @@
+#include "server/wal.h"
+#include "server/database.h"
+#include "server/batch_io.h"
+#include "common/utils.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
+
+TransactionLog transaction_log;
+
+// O CRC cobre todos os bytes após o próprio campo
+static uint32_t recordCrc(const WalRecord& record) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record) + sizeof(record.crc);
+    return crc32(bytes, sizeof(WalRecord) - sizeof(record.crc));
+}
+
+/* === TransactionLog === */
+
+TransactionLog::TransactionLog()
+    : _fd(-1), _next_lsn(1), _durable_lsn(0), _good_offset(0), _group_commit_us(WAL_DEFAULT_GROUP_COMMIT_US), _running(false) {}
+
+TransactionLog::~TransactionLog() { stop(); }
+
+bool TransactionLog::open(const string& path, unsigned int group_commit_us) {
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (_fd < 0) {
+        PIX_LOG_ERROR(LOG_CAT_STORAGE, "ERROR: could not open transaction log %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    _path = path;
+    _group_commit_us = group_commit_us;
+
+    struct stat st;
+    _good_offset = (fstat(_fd, &st) == 0) ? st.st_size : 0;
+    return true;
+}
+
+// LSNs são contínuos e os registros têm tamanho fixo, então o registro 'lsn'
+// está em (lsn - 1) * sizeof(WalRecord). Confere antes de confiar no offset.
+off_t TransactionLog::offsetOf(uint64_t lsn) const {
+    if (lsn == 0) return 0;
+
+    off_t offset = (off_t)(lsn - 1) * sizeof(WalRecord);
+    WalRecord rec;
+    if (pread(_fd, &rec, sizeof(rec), offset) == (ssize_t)sizeof(rec) &&
+        rec.crc == recordCrc(rec) && rec.lsn == lsn) {
+        return offset;
+    }
+    return 0;  // Log não bate com o esperado: varre desde o início
+}
+
+size_t TransactionLog::replay(ServerDatabase& db, uint64_t after_lsn) {
+    if (_fd < 0) return 0;
+
+    size_t applied = 0;
+    off_t offset = offsetOf(after_lsn);
+    uint64_t last_lsn = 0;
+    WalRecord records[256];
+
+    while (true) {
+        ssize_t n = pread(_fd, records, sizeof(records), offset);
+        if (n <= 0) break;
+
+        size_t count = n / sizeof(WalRecord);
+        size_t valid = 0;
+        for (; valid < count; ++valid) {
+            const WalRecord& rec = records[valid];
+            if (rec.crc != recordCrc(rec) || rec.lsn <= last_lsn) break;
+            last_lsn = rec.lsn;
+
+            if (rec.lsn <= after_lsn) continue;  // Já coberto por um snapshot
+
+            if (db.applyLogRecord(rec)) applied++;
+        }
+
+        offset += valid * sizeof(WalRecord);
+
+        // Registro inválido ou incompleto: é a cauda de uma escrita interrompida
+        if (valid < count || (size_t)n % sizeof(WalRecord) != 0) break;
+    }
+
+    struct stat st;
+    if (fstat(_fd, &st) == 0 && st.st_size > offset) {
+        PIX_LOG_WARN(LOG_CAT_STORAGE, "Transaction log: discarding %lld bytes of torn tail",
+                     (long long)(st.st_size - offset));
+        if (ftruncate(_fd, offset) != 0) {
+            PIX_LOG_ERROR(LOG_CAT_STORAGE, "ERROR: could not truncate transaction log tail");
+        }
+    }
+    if (fstat(_fd, &st) == 0) _good_offset = st.st_size;
+
+    lock_guard<mutex> lk(_mutex);
+    _next_lsn = max(_next_lsn, last_lsn + 1);
+    _durable_lsn = _next_lsn - 1;
+
+    return applied;
+}
+
+void TransactionLog::reserveLsn(uint64_t lsn) {
+    lock_guard<mutex> lk(_mutex);
+    if (_next_lsn <= lsn) {
+        _next_lsn = lsn + 1;
+        _durable_lsn = lsn;
+    }
+}
+
+void TransactionLog::start() {
+    if (_fd < 0) return;
+
+    bool expected = false;
+    if (!_running.compare_exchange_strong(expected, true)) return;
+    _writer = thread(&TransactionLog::writerLoop, this);
+}
+
+void TransactionLog::stop() {
+    bool expected = true;
+    if (_running.compare_exchange_strong(expected, false)) {
+        _work_cv.notify_all();
+        if (_writer.joinable()) _writer.join();
+    }
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+uint64_t TransactionLog::append(WalRecord record) {
+    lock_guard<mutex> lk(_mutex);
+    if (_fd < 0) return 0;
+
+    record.lsn = _next_lsn++;
+    _pending.push_back(record);
+    _work_cv.notify_one();
+    return record.lsn;
+}
+
+void TransactionLog::waitDurable(uint64_t lsn) {
+    if (lsn == 0) return;
+
+    unique_lock<mutex> lk(_mutex);
+    _durable_cv.wait(lk, [&] { return _durable_lsn >= lsn || !_running; });
+}
+
+void TransactionLog::whenDurable(uint64_t lsn, function<void()> callback) {
+    {
+        lock_guard<mutex> lk(_mutex);
+        if (lsn > _durable_lsn && _running) {
+            _durable_callbacks.emplace(lsn, move(callback));
+            return;
+        }
+    }
+    callback();
+}
+
+// Chama (sem o lock) os callbacks cujo LSN já está em disco
+void TransactionLog::runDurableCallbacks(unique_lock<mutex>& lk) {
+    vector<function<void()>> ready;
+    auto end = _running ? _durable_callbacks.upper_bound(_durable_lsn) : _durable_callbacks.end();
+    for (auto it = _durable_callbacks.begin(); it != end; ++it) ready.push_back(move(it->second));
+    _durable_callbacks.erase(_durable_callbacks.begin(), end);
+
+    if (ready.empty()) return;
+    lk.unlock();
+    {
+        // Os ACKs liberados por este fsync saem juntos
+        OutboxScope outbox;
+        for (auto& callback : ready) callback();
+    }
+    lk.lock();
+}
+
+uint64_t TransactionLog::durableLsn() const {
+    lock_guard<mutex> lk(_mutex);
+    return _durable_lsn;
+}
+
+uint64_t TransactionLog::lastLsn() const {
+    lock_guard<mutex> lk(_mutex);
+    return _next_lsn - 1;
+}
+
+bool TransactionLog::writeBatch(vector<WalRecord>& batch) {
+    for (auto& record : batch) record.crc = recordCrc(record);
+
+    const char* data = reinterpret_cast<const char*>(batch.data());
+    size_t remaining = batch.size() * sizeof(WalRecord);
+
+    while (remaining > 0) {
+        ssize_t n = write(_fd, data, remaining);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            PIX_LOG_ERROR(LOG_CAT_STORAGE, "ERROR writing transaction log: %s", strerror(errno));
+            return false;
+        }
+        data += n;
+        remaining -= n;
+    }
+
+    // Um único fsync para o lote inteiro (group commit)
+    if (fdatasync(_fd) != 0) {
+        PIX_LOG_ERROR(LOG_CAT_STORAGE, "ERROR syncing transaction log: %s", strerror(errno));
+        return false;
+    }
+    _good_offset += batch.size() * sizeof(WalRecord);
+    return true;
+}
+
+// Um lote que falhou pode ter deixado um registro pela metade no fim do arquivo;
+// o replay pararia nele e perderia tudo o que viesse depois. Volta ao fim do
+// último lote bom e reescreve o lote inteiro. Se não der, para o servidor: os
+// LSNs do lote nunca ficam duráveis e nenhum ACK pendente pode sair.
+void TransactionLog::writeBatchOrDie(vector<WalRecord>& batch) {
+    for (int attempt = 1; !writeBatch(batch); ++attempt) {
+        if (attempt > WAL_WRITE_RETRIES || ftruncate(_fd, _good_offset) != 0) {
+            PIX_LOG_ERROR(LOG_CAT_STORAGE, "FATAL: transaction log unusable after %d attempts, stopping server",
+                          attempt);
+            abort();
+        }
+        PIX_LOG_WARN(LOG_CAT_STORAGE, "Transaction log batch failed, retrying from offset %lld (attempt %d/%d)",
+                     (long long)_good_offset, attempt, WAL_WRITE_RETRIES);
+        this_thread::sleep_for(chrono::milliseconds(WAL_RETRY_DELAY_MS));
+    }
+}
+
+// Enquanto um fdatasync está em andamento, novos commits se acumulam em
+// _pending e vão juntos no próximo lote. A janela _group_commit_us (opcional)
+// segura o lote um pouco mais para juntar ainda mais registros por fsync.
+void TransactionLog::writerLoop() {
+    vector<WalRecord> batch;
+    batch.reserve(WAL_MAX_BATCH);
+
+    while (true) {
+        unique_lock<mutex> lk(_mutex);
+        _work_cv.wait(lk, [&] { return !_pending.empty() || !_running; });
+
+        if (_pending.empty()) break;  // Parando e nada mais a escrever
+
+        if (_group_commit_us > 0 && _running && _pending.size() < WAL_MAX_BATCH) {
+            _work_cv.wait_for(lk, chrono::microseconds(_group_commit_us),
+                              [&] { return _pending.size() >= WAL_MAX_BATCH || !_running; });
+        }
+
+        batch.swap(_pending);
+        lk.unlock();
+
+        writeBatchOrDie(batch);  // Só volta com o lote inteiro em disco
+
+        lk.lock();
+        _durable_lsn = batch.back().lsn;
+        _durable_cv.notify_all();
+        runDurableCallbacks(lk);
+
+        batch.clear();
+    }
+
+    // Parando: ninguém fica esperando para sempre
+    unique_lock<mutex> lk(_mutex);
+    _durable_cv.notify_all();
+    runDurableCallbacks(lk);
+}
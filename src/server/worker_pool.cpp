@@ -0,0 +1,68 @@
+#include "server/worker_pool.h"
+#include "common/utils.h"
+#include "server/batch_io.h"
+
+WorkerPool worker_pool;
+
+WorkerPool::WorkerPool() : _running(false), _rejected(0) {}
+
+WorkerPool::~WorkerPool() { stop(); }
+
+void WorkerPool::start(size_t num_lanes, size_t queue_capacity, PacketHandler handler) {
+    bool expected = false;
+    if (!_running.compare_exchange_strong(expected, true)) return;
+
+    if (num_lanes == 0) num_lanes = 1;
+    size_t lane_capacity = queue_capacity / num_lanes;
+    if (lane_capacity == 0) lane_capacity = 1;
+
+    _handler = handler;
+
+    for (size_t i = 0; i < num_lanes; ++i) {
+        _lanes.push_back(new WorkerLane(lane_capacity));
+    }
+    for (auto* lane : _lanes) {
+        lane->worker = thread(&WorkerPool::laneLoop, this, lane);
+    }
+
+    PIX_LOG_DEBUG(LOG_CAT_PROCESSING, "WorkerPool started with %zu lanes, %zu slots each", num_lanes, lane_capacity);
+}
+
+void WorkerPool::stop() {
+    bool expected = true;
+    if (!_running.compare_exchange_strong(expected, false)) return;
+
+    // Fecha as filas: cada raia termina o que já foi enfileirado e sai
+    for (auto* lane : _lanes) lane->queue.close();
+    for (auto* lane : _lanes) {
+        if (lane->worker.joinable()) lane->worker.join();
+        delete lane;
+    }
+    _lanes.clear();
+}
+
+// Hash multiplicativo (Fibonacci): o último byte do IP varia mais que os
+// outros, então espalhamos os bits antes de escolher a raia.
+size_t WorkerPool::laneFor(uint32_t key) const {
+    uint32_t h = key * 2654435769u;
+    return (h >> 16) % _lanes.size();
+}
+
+bool WorkerPool::trySubmit(uint32_t key, const PacketJob& job) {
+    if (!_running || !_lanes[laneFor(key)]->queue.tryPush(job)) {
+        _rejected++;
+        return false;
+    }
+    return true;
+}
+
+void WorkerPool::laneLoop(WorkerLane* lane) {
+    PacketJob job;
+    while (lane->queue.pop(job)) {
+        // Esvazia a fila antes de dormir; as respostas do trecho saem num sendmmsg
+        OutboxScope outbox;
+        do {
+            _handler(job);
+        } while (lane->queue.tryPop(job));
+    }
+}